@@ -3,11 +3,18 @@
  
  g++ -Wall -I/usr/include/ -c goodwin.cpp &&
  g++ -L/usr/local/lib goodwin.o -lgsl -lgslcblas -lpopt  -lstdc++fs -o goodwin
+
+ --columnar / --dataset need Arrow and Parquet: build with `make ARROW=1`.
+
+ What is only known once the run is over, why it stopped (# stop=) and how
+ Parareal converged (# parareal:), is written as # lines after the data
+ rows, so read the .pd files with pandas.read_csv( path, comment='#' ).
 */
 
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <sstream>
 #include <unistd.h>
 #include <cstring>
 #include <string>
@@ -24,36 +31,46 @@
 #include <sys/stat.h>
 #include <experimental/filesystem>
 
+#include "goodwin.h"
+#include "goodwin_output.h"
+#include "goodwin_arrow.h"
+#include "goodwin_sweep.h"
+#include "goodwin_rk.h"
+#include "goodwin_tune.h"
+#include "goodwin_grid.h"
+#include "goodwin_lod.h"
+#include "goodwin_monitor.h"
+#include "goodwin_replay.h"
+#include "goodwin_parareal.h"
+
 namespace fs = std::experimental::filesystem;
 
 using namespace std;
 
 #define PROGRAM_NAME "goodwin"
 #define VERSION 1
-#define NMAX 1000000000
-
-struct goodwinParams {
-    double r;
-    double c;
-    double a;
-    double b;
-    double w0;
-    double Y0;
-    int Nsteps;
-};
 
-std::string strformat( const string fmt_str,...)
-{
-    va_list ap;
-    char *fp = NULL;
-    va_start(ap, fmt_str);
-    vasprintf(&fp, fmt_str.c_str(), ap);
-    va_end(ap);
-    std::unique_ptr<char[]> formatted(fp);
-    return std::string(formatted.get());
-}
+struct runOptions {
+    double tol;
+    int precision;
+    char * columnar;    // Parquet / Arrow IPC file
+    char * dataset;     // hive-partitioned Parquet dataset directory
+    int rowGroup;
+    char * lod;         // min/max level-of-detail pyramid file
+    char * stepper;
+    double autotune;    // accuracy target, 0 for none
+    int retune;
+    char * tuneFile;
+    gridOptions grid;
+    monitorOptions monitors;
+    int replay;         // integrate one period, then replay it by phase
+    pararealOptions parareal;   // slices 0: integrate serially
+    char * sweep;       // parameter grid: run as sweep coordinator
+    sweepOptions sweepOpts;
+};
 
-static void parseArguments( int argc, const char **argv, goodwinParams* gparams, char ** outfile )
+static void parseArguments( int argc, const char **argv, goodwinParams* gparams,
+                            runOptions* opts, char ** outfile )
 {
     poptContext optCon;
     const struct poptOption optionsTable[] = {
@@ -75,7 +92,59 @@ static void parseArguments( int argc, const char **argv, goodwinParams* gparams,
         { "Y0", 'Y', POPT_ARG_DOUBLE, &gparams->Y0, 0,
             "Set initial output level." },
         { "output", 'o', POPT_ARG_STRING, outfile, 0,
-            "Pandas format CSV file output pathname (max 180 chars)." },
+            "Pandas format CSV file output pathname." },
+        { "t-start", 0, POPT_ARG_DOUBLE, &opts->grid.tStart, 0,
+            "Set start time of the run (default 0)." },
+        { "t-end", 0, POPT_ARG_DOUBLE, &opts->grid.tEnd, 0,
+            "Set end time of the run; with a linear grid this sets the number of outputs." },
+        { "dt", 0, POPT_ARG_DOUBLE, &opts->grid.dt, 0,
+            "Set output spacing (default 0.1); the first output time of a log grid." },
+        { "grid", 0, POPT_ARG_STRING, &opts->grid.spacing, 0,
+            "Set output times: linear (default), log (Nsteps log-spaced to t-end), or final (last state only)." },
+        { "tol", 0, POPT_ARG_DOUBLE, &opts->tol, 0,
+            "Only write the samples needed to linearly interpolate the rest to within tol (default 0: write all)." },
+        { "precision", 'p', POPT_ARG_INT, &opts->precision, 0,
+            "Set decimals written per value (default 6; -1 for shortest exact round-trip)." },
+        { "columnar", 0, POPT_ARG_STRING, &opts->columnar, 0,
+            "Also write the trajectory as Parquet, or Arrow IPC if the name ends in .arrow/.feather." },
+        { "dataset", 0, POPT_ARG_STRING, &opts->dataset, 0,
+            "Also write the trajectory (each point, with --sweep) into a Parquet dataset directory, partitioned by r/c/a/b/w0/Y0." },
+        { "row-group", 0, POPT_ARG_INT, &opts->rowGroup, 0,
+            "Set rows per Parquet row group / Arrow record batch (default 65536)." },
+        { "lod", 0, POPT_ARG_STRING, &opts->lod, 0,
+            "Also write a min/max level-of-detail pyramid of every sample, for scrubbing long runs." },
+        { "stepper", 0, POPT_ARG_STRING, &opts->stepper, 0,
+            "Set ODE stepper: rk8pd (GSL, default), or native bs3, dp5, tsit5, vern6, vern9." },
+        { "autotune", 0, POPT_ARG_DOUBLE, &opts->autotune, 0,
+            "Use the cheapest stepper and tolerance found to keep the relative error within this target." },
+        { "retune", 0, POPT_ARG_NONE, &opts->retune, 0,
+            "Recalibrate --autotune even if the tuning file has a setting for this regime." },
+        { "tune-file", 0, POPT_ARG_STRING, &opts->tuneFile, 0,
+            "Set autotune settings file (default ./sim_data/autotune.pd)." },
+        { "max-norm", 0, POPT_ARG_DOUBLE, &opts->monitors.maxNorm, 0,
+            "Stop the run once |wages| or |output| exceeds this (blow-up)." },
+        { "floor", 0, POPT_ARG_DOUBLE, &opts->monitors.floor, 0,
+            "Stop the run once wages or output falls below this (collapse)." },
+        { "steady-tol", 0, POPT_ARG_DOUBLE, &opts->monitors.steadyTol, 0,
+            "Stop the run once |dy/dt| <= steady-tol (1 + |y|) (steady state)." },
+        { "closure-tol", 0, POPT_ARG_DOUBLE, &opts->monitors.closureTol, 0,
+            "Stop the run once it returns to within this relative distance of (w0, Y0) (orbit closed)." },
+        { "replay", 0, POPT_ARG_NONE, &opts->replay, 0,
+            "Integrate one period of the closed orbit through (w0, Y0), then replay it for the rest of the run." },
+        { "parareal", 0, POPT_ARG_INT, &opts->parareal.slices, 0,
+            "Integrate in parallel in time (Parareal) over this many slices, one per core at a time." },
+        { "parareal-tol", 0, POPT_ARG_DOUBLE, &opts->parareal.tol, 0,
+            "Set Parareal convergence tolerance on the slice starts (default: the solver's epsabs + epsrel |y|)." },
+        { "coarse-dt", 0, POPT_ARG_DOUBLE, &opts->parareal.coarseDt, 0,
+            "Set the step of Parareal's coarse RK4 propagator (default 0.02)." },
+        { "sweep", 0, POPT_ARG_STRING, &opts->sweep, 0,
+            "Run a parameter grid, e.g. \"r=0.5:1.5:11,w0=2:4:3\", in worker processes and merge the results." },
+        { "workers", 0, POPT_ARG_INT, &opts->sweepOpts.workers, 0,
+            "Set sweep worker processes (default: one per CPU)." },
+        { "shards", 0, POPT_ARG_INT, &opts->sweepOpts.shards, 0,
+            "Set shards the sweep grid is cut into (default: 4 per worker)." },
+        { "retries", 0, POPT_ARG_INT, &opts->sweepOpts.retries, 0,
+            "Set reruns allowed for a shard whose worker fails (default 2)." },
         {NULL, 0, 0, NULL, 0, }
     };
     int i;
@@ -114,40 +183,85 @@ static void parseArguments( int argc, const char **argv, goodwinParams* gparams,
     poptFreeContext(optCon);
 }
 
-int func (double t, const double y[], double f[],
-      void *params)
+/*
+ The first option given that --sweep does not support, or NULL.  Sweep
+ points run on rk8pd at the default tolerances, over the whole grid, and
+ are written to the merged files and the --dataset parts only.
+*/
+static const char* sweepUnsupported( const runOptions& opts )
 {
-    (void)(t); /* avoid unused parameter warning */ 
-    struct goodwinParams *p = (struct goodwinParams*)(params); 
-    double r = p->r; 
-    double c = p->c; 
-    double a = p->a; 
-    double b = p->b;
-    f[0] = -c*y[0] + r*y[0]*y[1]; // wages y[0], f[0]=dy[0]/dt
-    f[1] = a*y[1] - b*y[0]*y[1]; // output y[1], f[1]=dy[1]/dt
-    return GSL_SUCCESS;
+    if ( opts.columnar != NULL ) return "--columnar";
+    if ( opts.lod != NULL ) return "--lod";
+    if ( opts.tol > 0.0 ) return "--tol";
+    if ( opts.replay ) return "--replay";
+    if ( opts.parareal.slices > 0 ) return "--parareal";
+    if ( opts.stepper != NULL ) return "--stepper";
+    if ( opts.autotune > 0.0 ) return "--autotune";
+    return NULL;
 }
 
-int
-jac (double t, const double y[], double *dfdy,
-     double dfdt[], void *params)
+/* Coordinator mode: sweep the grid with forked workers, then merge into csvfile and its index. */
+static int runSweepMode( const goodwinParams& params, const timeGrid& times, const runOptions& opts,
+                         const string& csvfile )
 {
-    (void)(t); /* avoid unused parameter warning */
-    struct goodwinParams *p = (struct goodwinParams*)(params); 
-    double r = p->r; 
-    double c = p->c; 
-    double a = p->a; 
-    double b = p->b;
-    gsl_matrix_view dfdy_mat
-    = gsl_matrix_view_array (dfdy, 2, 2);
-    gsl_matrix * m = &dfdy_mat.matrix;
-    gsl_matrix_set (m, 0, 0, -c+r*y[1] );
-    gsl_matrix_set (m, 0, 1, -b*y[1] );
-    gsl_matrix_set (m, 1, 0, r*y[0] );
-    gsl_matrix_set (m, 1, 1, a-b*y[0] );
-    dfdt[0] = 0.0;  // no explicit time dependencies
-    dfdt[1] = 0.0;
-    return GSL_SUCCESS;
+    sweepGrid grid;
+    string err;
+    if ( !parseSweep( opts.sweep, params, &grid, &err ) ) {
+        fprintf(stderr,"\t--sweep: %s\n",err.c_str());
+        exit(-1);
+    }
+    grid.times = times;
+    grid.monitors = opts.monitors;
+    if ( opts.dataset != NULL ) {
+        if ( !columnarAvailable() ) {
+            fprintf(stderr,"\t--dataset: built without Arrow support (rebuild with make ARROW=1)\n");
+            exit(-1);
+        }
+        grid.dataset = opts.dataset;
+        grid.rowGroup = opts.rowGroup;
+        grid.program = PROGRAM_NAME;
+    }
+    sweepResults res;
+    if ( !allocSweepResults( grid.size(), params.Nsteps, &res ) ) {
+        fprintf(stderr,"\tCould not map %ld points x %d steps of shared results: %s\n",
+                grid.size(),params.Nsteps,strerror(errno));
+        exit(-1);
+    }
+    sweepSummary sum;
+    runSweep( grid, opts.sweepOpts, &res, &sum );
+    cout << "Swept " << grid.size() << " points in " << sum.shards << " shards on "
+         << sum.workers << " workers over " << sum.nodes << " NUMA node(s) in "
+         << sum.seconds << " s" << endl;
+    for ( int k=0; k < sum.nodes; k++ ) {
+        cout << "  node " << k << ": " << sum.nodePoints[k] << " points, "
+             << sum.nodePoints[k] / sum.seconds << " points/s" << endl;
+    }
+    if ( sum.retried > 0 ) cout << "Reran " << sum.retried << " shard(s) after worker failures" << endl;
+    if ( !sum.failed.empty() ) {
+        cout << "Gave up on " << sum.failed.size() << " shard(s); their points have status -1" << endl;
+    }
+
+    string indexfile = csvfile;
+    if ( indexfile.size() > 3 && indexfile.compare( indexfile.size()-3, 3, ".pd" ) == 0 ) {
+        indexfile.resize( indexfile.size()-3 );
+    }
+    indexfile += ".index.pd";
+    ostringstream header;
+    header << "# Goodwin model parameter sweep." << endl;
+    header << "# sweep=" << opts.sweep << " , r=" << params.r << " , c=" << params.c
+       << " , a=" << params.a << " , b=" << params.b
+       << " , w0=" << params.w0 << " , Y0=" << params.Y0
+       << " , Nsteps=" << params.Nsteps << endl;
+    if ( !isDefaultGrid( opts.grid ) ) header << gridHeader( times );
+    textFormat fmt = { opts.precision, 12 };
+    if ( !writeSweep( grid, res, fmt, header.str(), csvfile, indexfile, &err ) ) {
+        printf("%s\n",err.c_str());
+    }
+    freeSweepResults( &res );
+    cout << "Done.  See output in " << csvfile << " , index in " << indexfile;
+    if ( opts.dataset != NULL ) cout << " , dataset in " << opts.dataset;
+    cout << endl;
+    return sum.failed.empty() ? 0 : -1;
 }
 
 int main ( int argc, const char *argv[] )
@@ -160,13 +274,29 @@ int main ( int argc, const char *argv[] )
     params.w0 = 3.0;
     params.Y0 = 4.0;
     params.Nsteps = 100;
-    string outfile = "";
-    char * pathname;
-    pathname = (char*)malloc(sizeof(char)*180);
-    //printf("Before parseArgs , pathname = '%s'\n",pathname);
-    parseArguments( argc, argv, &params, &pathname );
-    //printf("After parseArgs , pathname = '%s'\n",pathname);
-    outfile= strformat("%s",pathname);
+    runOptions opts;
+    opts.tol = 0.0;
+    opts.precision = 6;
+    opts.columnar = NULL;
+    opts.dataset = NULL;
+    opts.rowGroup = 65536;
+    opts.lod = NULL;
+    opts.stepper = NULL;
+    opts.autotune = 0.0;
+    opts.retune = 0;
+    opts.tuneFile = NULL;
+    defaultGridOptions( &opts.grid );
+    defaultMonitorOptions( &opts.monitors );
+    opts.replay = 0;
+    defaultPararealOptions( &opts.parareal );
+    opts.sweep = NULL;
+    opts.sweepOpts.workers = 0;
+    opts.sweepOpts.shards = 0;
+    opts.sweepOpts.retries = 2;
+    char * pathname = NULL;    // set by popt when -o is given
+    parseArguments( argc, argv, &params, &opts, &pathname );
+    string outfile = ( pathname != NULL ) ? pathname : "";
+    free( pathname );
     assert( (params.Nsteps > 1 && params.Nsteps < NMAX) );
     assert( params.r > 0.); 
     assert( params.c > 0.); 
@@ -174,6 +304,11 @@ int main ( int argc, const char *argv[] )
     assert( params.b > 0.); 
     assert( params.w0 > 0.);
     assert( params.Y0 > 0.);
+    if ( opts.precision > PRECISION_MAX ) {
+        cout << "precision = "<<opts.precision << " exceeds maximum.  Resetting precision to "
+        << PRECISION_MAX << endl;
+        opts.precision = PRECISION_MAX;
+    }
     if ( params.Nsteps>NMAX ) {
         cout << "Nsteps exceeded maximum.  Resetting Nsteps to  NMAX ="<<NMAX<<endl;
         params.Nsteps = NMAX;
@@ -182,26 +317,95 @@ int main ( int argc, const char *argv[] )
         << "\nResetting Nsteps to default = 100" << endl;
         params.Nsteps = 100;
     }
+    timeGrid grid;
+    string gridErr;
+    if ( !makeTimeGrid( opts.grid, params.Nsteps, &grid, &gridErr ) ) {
+        fprintf(stderr,"\tgrid: %s\n",gridErr.c_str());
+        exit(-1);
+    }
+    if ( grid.size() >= NMAX ) {
+        fprintf(stderr,"\tgrid: %ld outputs exceeds maximum %d\n",grid.size(),NMAX);
+        exit(-1);
+    }
+    params.Nsteps = grid.size();
+    if ( opts.sweep != NULL && sweepUnsupported( opts ) != NULL ) {
+        fprintf(stderr,"\t--sweep and %s cannot be used together\n",sweepUnsupported( opts ));
+        exit(-1);
+    }
     /// ODE solver set-up
-    gsl_odeiv2_system sys = {func, jac, 2, &params };
-
-    gsl_odeiv2_driver * d =
-    gsl_odeiv2_driver_alloc_y_new (&sys, gsl_odeiv2_step_rk8pd,
-                                    1e-6, 1e-6, 0.0);
+    stepperKind stepper;
+    if ( !parseStepper( opts.stepper, &stepper ) ) {
+        fprintf(stderr,"\tstepper: unknown stepper '%s'\n",opts.stepper);
+        exit(-1);
+    }
     int i;
-    double t = 0.0, t1 = 100.0;
+    double t = grid.tStart;
+    double epsabs = 1e-6, epsrel = 0.0;
+    if ( opts.autotune > 0.0 ) {
+        if ( opts.stepper != NULL ) {
+            fprintf(stderr,"\t--stepper and --autotune cannot be used together\n");
+            exit(-1);
+        }
+        // calibrate on the start of this run: up to TUNE_OUTPUTS of its output times
+        auto calibrate = [&params, &grid]( stepperKind kind, double ea, double er, vector<double>* out ) {
+            goodwinIntegrator cal( kind, ea, er );
+            cal.reset( params );
+            double tc = grid.tStart;
+            double yc[2] = { params.w0, params.Y0 };
+            out->clear();
+            for ( long k=1; k <= min( grid.size(), (long)TUNE_OUTPUTS ); k++ ) {
+                if ( cal.apply( &tc, grid.time( k ), yc ) != GSL_SUCCESS ) return false;
+                out->push_back( yc[0] );
+                out->push_back( yc[1] );
+            }
+            return true;
+        };
+        tuneConfig tuned;
+        string err;
+        string tunefile = ( opts.tuneFile != NULL ) ? opts.tuneFile : TUNE_FILE_DEFAULT;
+        if ( !tunedConfig( calibrate, tunefile, PROGRAM_NAME, goodwinRegime( params ), opts.autotune,
+                           opts.retune != 0, &tuned, &err ) ) {
+            fprintf(stderr,"\tautotune: %s\n",err.c_str());
+            exit(-1);
+        }
+        stepper = tuned.stepper;
+        epsabs = tuned.epsabs;
+        epsrel = tuned.epsrel;
+    }
+    goodwinIntegrator solver( stepper, epsabs, epsrel, &threadSolver() );
+    solver.reset( params );
+    if ( opts.replay && opts.parareal.slices > 0 ) {
+        fprintf(stderr,"\t--replay and --parareal cannot be used together\n");
+        exit(-1);
+    }
+    if ( opts.parareal.coarseDt <= 0.0 ) {
+        fprintf(stderr,"\t--coarse-dt must be > 0\n");
+        exit(-1);
+    }
+    cycleReplay cycle;
+    bool replaying = false;
+    if ( opts.replay && opts.sweep == NULL ) {
+        string err;
+        replaying = cycle.record( stepper, params, grid.tStart, grid.time( grid.size() ) - grid.tStart, &err );
+        if ( replaying ) {
+            cout << "Replaying a cycle of period " << setprecision( 10 ) << cycle.period()
+                 << " (" << cycle.size() << " samples, closure " << setprecision( 3 ) << cycle.closure()
+                 << ")" << setprecision( 6 ) << endl;
+        } else {
+            cout << "No cycle to replay (" << err << "); integrating the whole run" << endl;
+        }
+    }
     double y[2] = {  params.w0,  params.Y0 }; // initial conditions: { wages, output }
     
     // File output set-up
-    ofstream pdout;
+    asyncWriter pdout;
     string csvfile;
     
     time_t sysTime;
     struct tm  *tmstruct;
-    char*  chTime;
+    char chTime[80];
     sysTime  = time(0);
     tmstruct = localtime(&sysTime);
-    chTime = (char*)malloc(sizeof(char)*80);
     strftime(chTime,79,"%Y-%m-%d",tmstruct);
     csvfile = strformat("./sim_data/%s_v%d_N%d_%s.pd",PROGRAM_NAME,
             VERSION,params.Nsteps,chTime);
@@ -216,7 +420,7 @@ int main ( int argc, const char *argv[] )
     fs::path emptypath = "";
     fs::path fpath = csvfile;
     fs::path dname = fpath.parent_path();
-    cout << " pathname = " << pathname << "\n dname = " << dname << endl;
+    cout << " pathname = " << csvfile << "\n dname = " << dname << endl;
     const char * thedir = dname.c_str();
     struct stat info;
     if( stat( thedir, &info ) != 0 && dname.compare(emptypath)!=0 ) {
@@ -225,30 +429,153 @@ int main ( int argc, const char *argv[] )
         int status = mkdir(thedir, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
         if ( status == -1 ) printf("Could not mkdir for '%s'\n",thedir);
     }
-    pdout.open(csvfile);
-    pdout << "# Goodwin model data output." << endl;
-    pdout << "# r="<< params.r << " , c=" << params.r 
+    if ( opts.sweep != NULL ) {
+        return runSweepMode( params, grid, opts, csvfile );
+    }
+    if ( !pdout.open(csvfile) ) {
+        printf("Could not open '%s' for writing\n",csvfile.c_str());
+        return -1;
+    }
+    ostringstream header;
+    header << "# Goodwin model data output." << endl;
+    header << "# r="<< params.r << " , c=" << params.c
        << " , a=" << params.a << " , b=" << params.b 
        << " , w0="<< y[0] << " , Y0=" << y[1] 
        << " , Nsteps=" << params.Nsteps << endl;
+    if ( !isDefaultGrid( opts.grid ) ) header << gridHeader( grid );
+    if ( stepper != STEPPER_RK8PD || opts.autotune > 0.0 ) {
+        header << "# stepper=" << stepperName( stepper ) << " , epsabs=" << epsabs
+           << " , epsrel=" << epsrel << endl;
+    }
+    if ( replaying ) {
+        header << strformat( "# replay: period=%.12g , closure=%.3g , cycle_samples=%ld , spacing=%g\n",
+                             cycle.period(), cycle.closure(), (long)cycle.size(), REPLAY_SPACING );
+    }
+    if ( opts.tol > 0.0 ) {
+        header << "# decimated: linear interpolation error <= " << opts.tol << endl;
+    }
+    if ( monitorsActive( opts.monitors ) || opts.parareal.slices > 0 ) {
+        header << "# run summary lines (# stop=, # parareal:) may follow the data: read with comment='#'" << endl;
+    }
     // NB: no whitespace in the column names if we want Pandas dataframe format
-    pdout << "time,wages,output" << endl; 
+    header << "time,wages,output" << endl; 
+    pdout.write( header.str() );
+
+    // columnar copies of the same rows, streamed out a row group at a time
+    columnarWriter colout, dsout;
+    string colfile, dsfile;
+    if ( opts.columnar != NULL ) {
+        colfile = opts.columnar;
+        if ( !colout.open( colfile, params, PROGRAM_NAME, opts.rowGroup ) ) {
+            fprintf(stderr,"\tCould not open '%s': %s\n",colfile.c_str(),colout.error().c_str());
+            exit(-1);
+        }
+    }
+    if ( opts.dataset != NULL ) {
+        dsfile = datasetPartPath( opts.dataset, params );
+        fs::create_directories( fs::path( dsfile ).parent_path() );
+        if ( !dsout.open( dsfile, params, PROGRAM_NAME, opts.rowGroup ) ) {
+            fprintf(stderr,"\tCould not open '%s': %s\n",dsfile.c_str(),dsout.error().c_str());
+            exit(-1);
+        }
+    }
+    lodWriter lodout;
+    if ( opts.lod != NULL && !lodout.open( opts.lod ) ) {
+        fprintf(stderr,"\tCould not open '%s': %s\n",opts.lod,lodout.error().c_str());
+        exit(-1);
+    }
     
-    for (i = 1; i <= params.Nsteps; i++)
+    // rows are formatted straight into the writer's buffers, laid out as setw(12) << fixed did
+    textFormat fmt = { opts.precision, 12 };
+    auto emit = [&pdout, &fmt, &colout, &dsout]( double te, const double ye[2] ) {
+        pdout.commit( formatRow( pdout.reserve( ROW_MAX ), fmt, ",", te, ye ) );
+        colout.append( te, ye );
+        dsout.append( te, ye );
+    };
+    trajectoryDecimator decimator( opts.tol );
+    terminationMonitor monitor( opts.monitors );
+    monitor.start( t, y, params );
+    long outputs = 0;
+    // one output sample; false once a monitor stops the run
+    auto record = [&]( double ts, const double ys[2] ) {
+        lodout.append( ts, ys );
+        if ( opts.tol > 0.0 ) decimator.push( ts, ys, emit );
+        else emit( ts, ys );
+        outputs++;
+        t = ts;
+        return !monitor.check( ts, ys );
+    };
+    pararealReport pr;
+    if ( opts.parareal.slices > 0 ) {
+        string err;
+        if ( !pararealRun( stepper, epsabs, epsrel, params, grid, opts.parareal, &pr, &err, record ) ) {
+            printf ("error, parareal: %s\n", err.c_str());
+            monitor.fail();
+        }
+    } else for (i = 1; i <= grid.size(); i++)
     {
-        double ti =  i * t1 / 1000.0;
-        int status = gsl_odeiv2_driver_apply (d, &t, ti, y);
+        double ti = grid.time( i );
+        if ( replaying ) {
+            cycle.sample( ti, y );
+            t = ti;
+        }
+        int status = replaying ? GSL_SUCCESS : solver.apply (&t, ti, y);
 
         if (status != GSL_SUCCESS)
         {
             printf ("error, return value = %d\n", status);
+            monitor.fail();
             break;
         }
-        pdout << setw(12) << fixed << t << "," << setw(12)
-           <<  y[0] << "," << setw(12) << y[1] << endl;
+        if ( !record( t, y ) ) break;
+    }
+    if ( opts.parareal.slices > 0 && pr.iterations > 0 ) {
+        for ( int k=0; k < pr.iterations; k++ ) {
+            cout << "Parareal iteration " << k+1 << ": largest correction " << pr.correction[k]
+                 << ", " << pr.wall[k] << " s" << endl;
+        }
+        cout << "Parareal " << ( pr.converged ? "converged" : "did not converge" ) << " in "
+             << pr.iterations << " iterations over " << pr.slices << " slices on " << pr.threads
+             << " threads: " << pr.totalSecs << " s against " << pr.fineSecs << " s serial, speedup "
+             << pr.fineSecs / pr.totalSecs << " (bound " << (double)pr.slices / ( pr.iterations + 1 ) << ")" << endl;
+        pdout.write( strformat( "# parareal: slices=%d , iterations=%d , converged=%d , correction=%.3g , coarse_dt=%g\n",
+                                pr.slices, pr.iterations, (int)pr.converged, pr.correction.back(), opts.parareal.coarseDt ) );
+    }
+    if ( opts.tol > 0.0 ) {
+        decimator.finish( emit );
+        cout << "Kept " << decimator.kept() << " of " << decimator.seen()
+             << " samples within tol = " << opts.tol << endl;
+    }
+    // runs that stop early, or could have, end with why
+    if ( monitorsActive( opts.monitors ) || monitor.reason() != STOP_COMPLETE ) {
+        string stop = strformat( "# stop=%s , t_stop=%g , outputs=%ld", stopReasonName( monitor.reason() ), t, outputs );
+        if ( monitor.reason() == STOP_CLOSED ) stop += strformat( " , period=%.10g", monitor.period() );
+        pdout.write( stop + "\n" );
+        cout << "Stopped: " << stop.substr( 2 ) << endl;
+    }
+    if ( !pdout.close() ) {
+        printf("Error writing '%s': %s\n",csvfile.c_str(),strerror(pdout.error()));
+    }
+    if ( !colout.close() ) {
+        printf("Error writing '%s': %s\n",colfile.c_str(),colout.error().c_str());
+    } else if ( !colfile.empty() ) {
+        cout << "Columnar copy in " << colfile << endl;
+    }
+    if ( !dsout.close() ) {
+        printf("Error writing '%s': %s\n",dsfile.c_str(),dsout.error().c_str());
+    } else if ( !dsfile.empty() ) {
+        cout << "Dataset part in " << dsfile << endl;
+    }
+    if ( opts.lod != NULL ) {
+        if ( !lodout.close() ) {
+            printf("Error writing '%s': %s\n",opts.lod,lodout.error().c_str());
+        } else {
+            cout << "Level-of-detail pyramid of " << lodout.samples() << " samples in " << opts.lod << endl;
+        }
+    }
+    if ( pdout.stallSeconds() > 0.0 ) {
+        cout << "Solver waited " << pdout.stallSeconds() << " s on disk writes" << endl;
     }
-    pdout.close();
-    gsl_odeiv2_driver_free (d);
-    cout<< "Done.  See output in "<< outfile <<endl;
+    cout<< "Done.  See output in "<< csvfile <<endl;
     return 0;
 }
@@ -0,0 +1,94 @@
+/*
+ Shared definitions for the Goodwin wage--output model programs.
+
+ The model right hand side func() and its Jacobian jac() are written in the
+ GNU-GSL gsl_odeiv2_system calling convention, so any program in this
+ directory can hand them straight to a gsl_odeiv2_driver.
+*/
+
+#ifndef GOODWIN_H
+#define GOODWIN_H
+
+#include <string>
+#include <memory>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_odeiv2.h>
+
+#define NMAX 1000000000
+
+struct goodwinParams {
+    double r;
+    double c;
+    double a;
+    double b;
+    double w0;
+    double Y0;
+    int Nsteps;
+};
+
+/* Default model parameters, as used by all the goodwin programs. */
+inline void defaultParams( goodwinParams* p )
+{
+    p->r = 1.0;
+    p->c = 1.0;
+    p->a = 1.0;
+    p->b = 1.0;
+    p->w0 = 3.0;
+    p->Y0 = 4.0;
+    p->Nsteps = 100;
+}
+
+inline std::string strformat( const std::string fmt_str,...)
+{
+    va_list ap;
+    char *fp = NULL;
+    va_start(ap, fmt_str);
+    if ( vasprintf(&fp, fmt_str.c_str(), ap) < 0 ) fp = NULL;
+    va_end(ap);
+    if ( fp == NULL ) return std::string();
+    std::string formatted(fp);
+    free(fp);
+    return formatted;
+}
+
+inline int func (double t, const double y[], double f[],
+      void *params)
+{
+    (void)(t); /* avoid unused parameter warning */
+    struct goodwinParams *p = (struct goodwinParams*)(params);
+    double r = p->r;
+    double c = p->c;
+    double a = p->a;
+    double b = p->b;
+    f[0] = -c*y[0] + r*y[0]*y[1]; // wages y[0], f[0]=dy[0]/dt
+    f[1] = a*y[1] - b*y[0]*y[1]; // output y[1], f[1]=dy[1]/dt
+    return GSL_SUCCESS;
+}
+
+inline int
+jac (double t, const double y[], double *dfdy,
+     double dfdt[], void *params)
+{
+    (void)(t); /* avoid unused parameter warning */
+    struct goodwinParams *p = (struct goodwinParams*)(params);
+    double r = p->r;
+    double c = p->c;
+    double a = p->a;
+    double b = p->b;
+    gsl_matrix_view dfdy_mat
+    = gsl_matrix_view_array (dfdy, 2, 2);
+    gsl_matrix * m = &dfdy_mat.matrix;
+    gsl_matrix_set (m, 0, 0, -c+r*y[1] );
+    gsl_matrix_set (m, 0, 1, r*y[0] );
+    gsl_matrix_set (m, 1, 0, -b*y[1] );
+    gsl_matrix_set (m, 1, 1, a-b*y[0] );
+    dfdt[0] = 0.0;  // no explicit time dependencies
+    dfdt[1] = 0.0;
+    return GSL_SUCCESS;
+}
+
+#endif /* GOODWIN_H */
@@ -0,0 +1,397 @@
+/*
+ Phase portrait animation of a goodwin trajectory, rendered natively.
+
+ g++ -Wall -O2 -pthread -I/usr/include/ -c goodwin_anim.cpp &&
+ g++ -pthread goodwin_anim.o -lpopt -o goodwin_anim
+
+ Reads the time,wages,output columns of a goodwin .pd file and draws, for
+ each frame i, the last --tail samples up to i as a wage--output line
+ shaded with the hot2cold colormap of sandbox/anim_trajectories.py (white
+ for the oldest segment through green, blue and purple to red for the
+ newest) with the samples marked as red dots, on the same 0..ceil(max)
+ axes with unit grid lines.  Titles and tick labels are left out.
+
+ Frames are independent, so a batch of them is rasterized and converted
+ to YUV on --threads workers at once, then written in order as YUV4MPEG2
+ (4:2:0, full range) -- to a .y4m file, to stdout with -o -, or straight
+ into an encoder with --pipe, e.g.
+
+   goodwin_anim -i sim_data/run.pd --pipe "ffmpeg -y -i - -c:v libvpx-vp9 anim_wY_trajectories.webm"
+
+ --format rgb writes bare rgb24 frames instead, for encoders that take
+ -f rawvideo -pix_fmt rgb24 -s WxH -r FPS.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+
+#include <popt.h>
+
+#include "goodwin.h"
+
+using namespace std;
+
+#define PROGRAM_NAME "goodwin_anim"
+#define VERSION 1
+
+struct animOptions {
+    char * infile;
+    char * outfile;     // .y4m pathname, or "-" for stdout
+    char * pipe;        // encoder command reading frames on stdin
+    char * format;      // "y4m" (default) or "rgb"
+    int width;
+    int height;
+    int tail;           // samples drawn per frame, the python tbuff
+    int stride;         // samples advanced per frame
+    int fps;
+    int threads;
+    double lineWidth;   // pixels
+};
+
+static void parseArguments( int argc, const char **argv, animOptions* opts )
+{
+    poptContext optCon;
+    const struct poptOption optionsTable[] = {
+        POPT_AUTOHELP
+        { "input", 'i', POPT_ARG_STRING, &opts->infile, 0,
+            "Goodwin .pd trajectory file to animate." },
+        { "output", 'o', POPT_ARG_STRING, &opts->outfile, 0,
+            "Video output pathname, or - for stdout (default anim_wY_trajectories.y4m)." },
+        { "pipe", 0, POPT_ARG_STRING, &opts->pipe, 0,
+            "Write frames to the stdin of this encoder command instead of a file." },
+        { "format", 0, POPT_ARG_STRING, &opts->format, 0,
+            "Set frame format: y4m (default) or rgb (raw rgb24)." },
+        { "width", 'W', POPT_ARG_INT, &opts->width, 0,
+            "Set frame width in pixels (default 640)." },
+        { "height", 'H', POPT_ARG_INT, &opts->height, 0,
+            "Set frame height in pixels (default 640)." },
+        { "tail", 0, POPT_ARG_INT, &opts->tail, 0,
+            "Set samples in the fading tail (default 59)." },
+        { "stride", 0, POPT_ARG_INT, &opts->stride, 0,
+            "Set samples advanced per frame (default 1)." },
+        { "fps", 0, POPT_ARG_INT, &opts->fps, 0,
+            "Set frame rate (default 30)." },
+        { "threads", 'j', POPT_ARG_INT, &opts->threads, 0,
+            "Set rendering threads (default: all CPUs)." },
+        { "line-width", 0, POPT_ARG_DOUBLE, &opts->lineWidth, 0,
+            "Set trajectory line width in pixels (default 3)." },
+        {NULL, 0, 0, NULL, 0, }
+    };
+    optCon = poptGetContext(PROGRAM_NAME, argc, argv, optionsTable, 0);
+    poptReadDefaultConfig(optCon, 0);
+    int err = poptGetNextOpt(optCon);
+    if (err != -1) {
+        fprintf(stderr, "\t%s: %s\n",
+            poptBadOption(optCon, POPT_BADOPTION_NOALIAS),
+            poptStrerror(err));
+        exit(-1);
+    }
+    poptFreeContext(optCon);
+}
+
+/* time, wages and output columns of a .pd file, found by name */
+static bool readTrajectory( const string& path, vector<double>* t, vector<double>* w,
+                            vector<double>* Y, string* err )
+{
+    ifstream in( path );
+    if ( !in ) {
+        *err = "could not open '" + path + "'";
+        return false;
+    }
+    string line;
+    int it = -1, iw = -1, iy = -1, ncol = 0;
+    while ( getline( in, line ) ) {
+        if ( line.empty() || line[0] == '#' ) continue;
+        if ( it < 0 ) {
+            istringstream s( line );
+            string name;
+            for ( ncol=0; getline( s, name, ',' ); ncol++ ) {
+                if ( name == "time" ) it = ncol;
+                else if ( name == "wages" ) iw = ncol;
+                else if ( name == "output" ) iy = ncol;
+            }
+            if ( it < 0 || iw < 0 || iy < 0 ) {
+                *err = "'" + path + "' has no time,wages,output columns";
+                return false;
+            }
+            continue;
+        }
+        vector<double> row( ncol );
+        const char* p = line.c_str();
+        for ( int k=0; k < ncol; k++ ) {
+            char* end;
+            row[k] = strtod( p, &end );
+            if ( end == p ) break;
+            p = ( *end == ',' ) ? end + 1 : end;
+        }
+        t->push_back( row[it] );
+        w->push_back( row[iw] );
+        Y->push_back( row[iy] );
+    }
+    if ( t->size() < 2 ) {
+        *err = "'" + path + "' has fewer than two samples";
+        return false;
+    }
+    return true;
+}
+
+struct rgb { float r, g, b; };
+
+/*
+ hot2cold of anim_trajectories.py: four 64 entry linear ramps,
+ white-green, green-blue, blue-purple and purple-red.
+*/
+static rgb hot2cold( double x )
+{
+    x = min( max( x, 0.0 ), 1.0 );
+    int k = min( (int)( x * 4.0 ), 3 );
+    float u = (float)( x * 4.0 - k );
+    switch ( k ) {
+        case 0: return { 1.0f - u, 1.0f, 1.0f - u };
+        case 1: return { 0.0f, 1.0f - u, u };
+        case 2: return { 0.5f * u, 0.0f, 1.0f - 0.5f * u };
+        default: return { 0.5f + 0.5f * u, 0.0f, 0.5f - 0.5f * u };
+    }
+}
+
+/* Data to pixel mapping: the plot box, centred, equal aspect as in the python. */
+struct frameLayout {
+    int width, height;
+    double x0, y0, scale;   // pixel of data (0,0) and pixels per unit
+    double wmax, Ymax;
+};
+
+static frameLayout makeLayout( int width, int height, double wmax, double Ymax )
+{
+    frameLayout L;
+    L.width = width;
+    L.height = height;
+    L.wmax = wmax;
+    L.Ymax = Ymax;
+    double margin = 0.06 * min( width, height );
+    L.scale = min( ( width - 2*margin ) / wmax, ( height - 2*margin ) / Ymax );
+    L.x0 = 0.5 * ( width - L.scale * wmax );
+    L.y0 = 0.5 * ( height + L.scale * Ymax );
+    return L;
+}
+
+class frameRenderer {
+public:
+    frameRenderer( const frameLayout& L, double lineWidth )
+        : L_( L ), lineWidth_( lineWidth ), pix_( 3 * L.width * L.height )
+    {
+        background();
+        bg_ = pix_;
+    }
+
+    /* Frame with samples [first, last) of the trajectory. */
+    void render( const vector<double>& w, const vector<double>& Y, long first, long last )
+    {
+        pix_ = bg_;
+        long nseg = last - first - 1;
+        for ( long k=0; k < nseg; k++ ) {
+            rgb c = hot2cold( ( nseg > 1 ) ? (double)k / ( nseg - 1 ) : 1.0 );
+            segment( px( w[first+k] ), py( Y[first+k] ), px( w[first+k+1] ), py( Y[first+k+1] ),
+                     0.5 * lineWidth_, c );
+        }
+        rgb red = { 1.0f, 0.0f, 0.0f };
+        for ( long k=first; k < last; k++ ) {
+            double x = px( w[k] ), y = py( Y[k] );
+            segment( x, y, x, y, 1.0, red );
+        }
+    }
+
+    /* 4:2:0 full range (JPEG) YCbCr, planes back to back */
+    void toYuv420( vector<unsigned char>* out ) const
+    {
+        int W = L_.width, H = L_.height;
+        out->resize( W*H + 2 * ( W/2 ) * ( H/2 ) );
+        unsigned char* Yp = out->data();
+        unsigned char* Cb = Yp + W*H;
+        unsigned char* Cr = Cb + ( W/2 ) * ( H/2 );
+        for ( int i=0; i < W*H; i++ ) {
+            const float* p = &pix_[3*i];
+            Yp[i] = byte( 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2] );
+        }
+        for ( int j=0; j < H/2; j++ ) {
+            for ( int i=0; i < W/2; i++ ) {
+                float r = 0, g = 0, b = 0;
+                for ( int dj=0; dj < 2; dj++ ) {
+                    for ( int di=0; di < 2; di++ ) {
+                        const float* p = &pix_[3 * ( ( 2*j + dj ) * W + 2*i + di )];
+                        r += p[0]; g += p[1]; b += p[2];
+                    }
+                }
+                r *= 0.25f; g *= 0.25f; b *= 0.25f;
+                Cb[j * ( W/2 ) + i] = byte( 0.5f - 0.168736f * r - 0.331264f * g + 0.5f * b );
+                Cr[j * ( W/2 ) + i] = byte( 0.5f + 0.5f * r - 0.418688f * g - 0.081312f * b );
+            }
+        }
+    }
+
+    void toRgb24( vector<unsigned char>* out ) const
+    {
+        out->resize( pix_.size() );
+        for ( size_t i=0; i < pix_.size(); i++ ) (*out)[i] = byte( pix_[i] );
+    }
+
+private:
+    frameLayout L_;
+    double lineWidth_;
+    vector<float> pix_;     // rgb, 0..1, rows top to bottom
+    vector<float> bg_;      // the empty plot, drawn once
+
+    static unsigned char byte( float v ) { return (unsigned char)lrintf( 255.0f * min( max( v, 0.0f ), 1.0f ) ); }
+    double px( double w ) const { return L_.x0 + L_.scale * w; }
+    double py( double Y ) const { return L_.y0 - L_.scale * Y; }
+
+    void blend( int i, int j, rgb c, float a )
+    {
+        float* p = &pix_[3 * ( j * L_.width + i )];
+        p[0] += a * ( c.r - p[0] );
+        p[1] += a * ( c.g - p[1] );
+        p[2] += a * ( c.b - p[2] );
+    }
+
+    /* white with the grey unit grid and a black frame round the plot box */
+    void background()
+    {
+        fill( pix_.begin(), pix_.end(), 1.0f );
+        rgb grey = { 0.8f, 0.8f, 0.8f }, black = { 0.0f, 0.0f, 0.0f };
+        double xl = px( 0 ), xr = px( L_.wmax ), yb = py( 0 ), yt = py( L_.Ymax );
+        for ( int k=1; k < L_.wmax; k++ ) segment( px( k ), yb, px( k ), yt, 0.5, grey );
+        for ( int k=1; k < L_.Ymax; k++ ) segment( xl, py( k ), xr, py( k ), 0.5, grey );
+        segment( xl, yb, xr, yb, 0.6, black );
+        segment( xl, yt, xr, yt, 0.6, black );
+        segment( xl, yb, xl, yt, 0.6, black );
+        segment( xr, yb, xr, yt, 0.6, black );
+    }
+
+    /* Antialiased capsule of half width hw round (xa,ya)--(xb,yb): coverage from the distance. */
+    void segment( double xa, double ya, double xb, double yb, double hw, rgb c )
+    {
+        int i0 = max( 0, (int)floor( min( xa, xb ) - hw - 1 ) );
+        int i1 = min( L_.width - 1, (int)ceil( max( xa, xb ) + hw + 1 ) );
+        int j0 = max( 0, (int)floor( min( ya, yb ) - hw - 1 ) );
+        int j1 = min( L_.height - 1, (int)ceil( max( ya, yb ) + hw + 1 ) );
+        double dx = xb - xa, dy = yb - ya, len2 = dx*dx + dy*dy;
+        for ( int j=j0; j <= j1; j++ ) {
+            for ( int i=i0; i <= i1; i++ ) {
+                double qx = i + 0.5 - xa, qy = j + 0.5 - ya;
+                double s = ( len2 > 0.0 ) ? min( max( ( qx*dx + qy*dy ) / len2, 0.0 ), 1.0 ) : 0.0;
+                double ex = qx - s*dx, ey = qy - s*dy;
+                double cover = hw + 0.5 - sqrt( ex*ex + ey*ey );
+                if ( cover > 0.0 ) blend( i, j, c, (float)min( cover, 1.0 ) );
+            }
+        }
+    }
+};
+
+int main ( int argc, const char *argv[] )
+{
+    animOptions opts = { NULL, NULL, NULL, NULL, 640, 640, 59, 1, 30, 0, 3.0 };
+    parseArguments( argc, argv, &opts );
+    if ( opts.infile == NULL ) {
+        fprintf(stderr,"\tno input: give a goodwin .pd file with -i\n");
+        exit(-1);
+    }
+    bool rgbOut = ( opts.format != NULL && strcmp( opts.format, "rgb" ) == 0 );
+    if ( opts.format != NULL && !rgbOut && strcmp( opts.format, "y4m" ) != 0 ) {
+        fprintf(stderr,"\tformat: unknown format '%s' (use y4m or rgb)\n",opts.format);
+        exit(-1);
+    }
+    if ( opts.width < 16 || opts.height < 16 || opts.width % 2 || opts.height % 2 ) {
+        fprintf(stderr,"\twidth and height must be even and at least 16\n");
+        exit(-1);
+    }
+    if ( opts.tail < 1 || opts.stride < 1 || opts.fps < 1 ) {
+        fprintf(stderr,"\ttail, stride and fps must be positive\n");
+        exit(-1);
+    }
+    if ( opts.outfile != NULL && opts.pipe != NULL ) {
+        fprintf(stderr,"\t--output and --pipe are mutually exclusive\n");
+        exit(-1);
+    }
+    int nthreads = ( opts.threads > 0 ) ? opts.threads : max( 1u, thread::hardware_concurrency() );
+
+    vector<double> t, w, Y;
+    string err;
+    if ( !readTrajectory( opts.infile, &t, &w, &Y, &err ) ) {
+        fprintf(stderr,"\t%s\n",err.c_str());
+        exit(-1);
+    }
+    double wmax = ceil( *max_element( w.begin(), w.end() ) );
+    double Ymax = ceil( *max_element( Y.begin(), Y.end() ) );
+    if ( !( wmax > 0.0 ) || !( Ymax > 0.0 ) ) {
+        fprintf(stderr,"\ttrajectory has no positive wages or output to plot\n");
+        exit(-1);
+    }
+    frameLayout L = makeLayout( opts.width, opts.height, wmax, Ymax );
+
+    // frame f shows samples up to last = 1 + f * stride, as animate(i) does with i = last
+    long nsamples = t.size();
+    long nframes = ( nsamples - 1 ) / opts.stride + 1;
+
+    string outfile = ( opts.outfile != NULL ) ? opts.outfile : "anim_wY_trajectories.y4m";
+    FILE * out;
+    bool toStdout = ( opts.pipe == NULL && outfile == "-" );
+    if ( opts.pipe != NULL ) out = popen( opts.pipe, "w" );
+    else if ( toStdout ) out = stdout;
+    else out = fopen( outfile.c_str(), "wb" );
+    if ( out == NULL ) {
+        fprintf(stderr,"\tcould not open '%s' for writing\n",( opts.pipe != NULL ) ? opts.pipe : outfile.c_str());
+        exit(-1);
+    }
+    FILE * log = toStdout ? stderr : stdout;
+    fprintf(log,"Rendering %ld frames of %dx%d from %ld samples of '%s' on %d threads\n",
+            nframes,opts.width,opts.height,nsamples,opts.infile,nthreads);
+    if ( !rgbOut ) {
+        fprintf(out,"YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n",
+                opts.width,opts.height,opts.fps);
+    }
+
+    // each worker renders every nthreads'th frame of a batch; the batch is then written in order
+    long batch = 4 * nthreads;
+    vector< vector<unsigned char> > frames( batch );
+    vector<frameRenderer> renderers( nthreads, frameRenderer( L, opts.lineWidth ) );
+    bool ok = true;
+    for ( long f0=0; f0 < nframes && ok; f0 += batch ) {
+        long nb = min( batch, nframes - f0 );
+        auto work = [&]( int id ) {
+            for ( long k=id; k < nb; k += nthreads ) {
+                long last = 1 + ( f0 + k ) * opts.stride;
+                long first = max( 0L, last - opts.tail );
+                renderers[id].render( w, Y, first, last );
+                if ( rgbOut ) renderers[id].toRgb24( &frames[k] );
+                else renderers[id].toYuv420( &frames[k] );
+            }
+        };
+        vector<thread> workers;
+        for ( int id=1; id < nthreads; id++ ) workers.push_back( thread( work, id ) );
+        work( 0 );
+        for ( thread& th : workers ) th.join();
+        for ( long k=0; k < nb && ok; k++ ) {
+            if ( !rgbOut ) fputs( "FRAME\n", out );
+            ok = ( fwrite( frames[k].data(), 1, frames[k].size(), out ) == frames[k].size() );
+        }
+    }
+    int status = 0;
+    if ( opts.pipe != NULL ) status = pclose( out );
+    else if ( !toStdout ) status = fclose( out );
+    else status = fflush( out );
+    if ( !ok || status != 0 ) {
+        fprintf(stderr,"\twriting frames failed\n");
+        exit(-1);
+    }
+    if ( opts.pipe != NULL ) fprintf(log,"Done.  Frames sent to '%s'\n",opts.pipe);
+    else if ( !toStdout ) fprintf(log,"Done.  See output in %s\n",outfile.c_str());
+    return 0;
+}
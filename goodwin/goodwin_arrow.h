@@ -0,0 +1,193 @@
+/*
+ Columnar trajectory export: Apache Parquet or Arrow IPC (Feather v2).
+
+ columnarWriter buffers (time, wages, output) columns and writes a row group
+ (Parquet) or record batch (Arrow IPC) every rowGroup rows as the run goes,
+ so memory stays bounded and the file is complete when the run ends.  The
+ goodwinParams are stored as schema metadata, and read back by e.g.
+   pyarrow.parquet.read_schema(path).metadata
+ The format is chosen by the extension: .arrow / .feather / .ipc for Arrow
+ IPC, anything else for Parquet.
+
+ Needs the Arrow and Parquet C++ libraries; build with `make ARROW=1`.
+ Without HAVE_ARROW the class is still there but open() reports that the
+ program was built without Arrow support.
+*/
+
+#ifndef GOODWIN_ARROW_H
+#define GOODWIN_ARROW_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <charconv>
+
+#include "goodwin.h"
+
+#ifdef HAVE_ARROW
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <arrow/ipc/writer.h>
+#include <parquet/arrow/writer.h>
+#include <parquet/properties.h>
+#endif
+
+/* shortest text that reads back to x, e.g. 0.1 rather than 0.10000000000000001 */
+inline std::string shortestString( double x )
+{
+    char buf[32];
+    std::to_chars_result r = std::to_chars( buf, buf + sizeof(buf), x );
+    return std::string( buf, r.ptr );
+}
+
+/*
+ Part file for one run inside a hive-partitioned dataset directory,
+   dir/r=1/c=1/a=1/b=1/w0=3/Y0=4/part-0.parquet
+ so a sweep is one dataset keyed by parameters, and filters on the
+ parameters skip whole directories.  Give the keys as float64, since hive
+ type inference reads 1 and 1.5 as strings:
+   keys = pa.schema([(k, pa.float64()) for k in ("r","c","a","b","w0","Y0")])
+   pyarrow.dataset.dataset(dir, partitioning=ds.partitioning(keys, flavor="hive"))
+*/
+inline std::string datasetPartPath( const std::string& dir, const goodwinParams& p )
+{
+    return dir + "/r=" + shortestString( p.r ) + "/c=" + shortestString( p.c )
+        + "/a=" + shortestString( p.a ) + "/b=" + shortestString( p.b )
+        + "/w0=" + shortestString( p.w0 ) + "/Y0=" + shortestString( p.Y0 )
+        + "/part-0.parquet";
+}
+
+/* Whether columnarWriter can write files at all, i.e. the program was built with ARROW=1. */
+inline bool columnarAvailable()
+{
+#ifdef HAVE_ARROW
+    return true;
+#else
+    return false;
+#endif
+}
+
+class columnarWriter {
+public:
+    columnarWriter() : rowGroup_(65536), parquet_(true), open_(false) {}
+    ~columnarWriter() { close(); }
+
+    bool open( const std::string& path, const goodwinParams& p,
+               const std::string& program, long rowGroup = 65536 )
+    {
+#ifdef HAVE_ARROW
+        rowGroup_ = ( rowGroup > 0 ) ? rowGroup : 65536;
+        t_.reserve( rowGroup_ );
+        w_.reserve( rowGroup_ );
+        Y_.reserve( rowGroup_ );
+        std::string ext = path.substr( path.find_last_of( '.' ) + 1 );
+        parquet_ = !( ext == "arrow" || ext == "feather" || ext == "ipc" );
+
+        auto metadata = arrow::key_value_metadata(
+            { "program", "r", "c", "a", "b", "w0", "Y0", "Nsteps" },
+            { program, shortestString( p.r ), shortestString( p.c ),
+              shortestString( p.a ), shortestString( p.b ),
+              shortestString( p.w0 ), shortestString( p.Y0 ),
+              std::to_string( p.Nsteps ) } );
+        schema_ = arrow::schema( { arrow::field( "time", arrow::float64(), false ),
+                                   arrow::field( "wages", arrow::float64(), false ),
+                                   arrow::field( "output", arrow::float64(), false ) },
+                                 metadata );
+
+        auto sink = arrow::io::FileOutputStream::Open( path );
+        if ( !sink.ok() ) return fail( sink.status() );
+        sink_ = *sink;
+        if ( parquet_ ) {
+            auto props = parquet::WriterProperties::Builder()
+                .compression( parquet::Compression::SNAPPY )->build();
+            // store the Arrow schema too, so the metadata round-trips to pandas/Polars
+            auto arrowProps = parquet::ArrowWriterProperties::Builder().store_schema()->build();
+            auto writer = parquet::arrow::FileWriter::Open( *schema_, arrow::default_memory_pool(),
+                                                            sink_, props, arrowProps );
+            if ( !writer.ok() ) return fail( writer.status() );
+            pq_ = std::move( writer ).ValueOrDie();
+        } else {
+            auto writer = arrow::ipc::MakeFileWriter( sink_, schema_ );
+            if ( !writer.ok() ) return fail( writer.status() );
+            ipc_ = *writer;
+        }
+        open_ = true;
+        return true;
+#else
+        (void)(path); (void)(p); (void)(program); (void)(rowGroup);
+        err_ = "built without Arrow support (rebuild with make ARROW=1)";
+        return false;
+#endif
+    }
+
+    void append( double t, const double y[2] )
+    {
+        if ( !open_ ) return;
+        t_.push_back( t );
+        w_.push_back( y[0] );
+        Y_.push_back( y[1] );
+        if ( (long)t_.size() >= rowGroup_ ) flushRowGroup();
+    }
+
+    bool close()
+    {
+        if ( !open_ ) return err_.empty();
+        open_ = false;
+        flushRowGroup();
+#ifdef HAVE_ARROW
+        arrow::Status st = parquet_ ? pq_->Close() : ipc_->Close();
+        if ( !st.ok() ) return fail( st );
+        st = sink_->Close();
+        if ( !st.ok() ) return fail( st );
+#endif
+        return err_.empty();
+    }
+
+    const std::string& error() const { return err_; }
+
+private:
+    void flushRowGroup()
+    {
+        if ( t_.empty() ) return;
+#ifdef HAVE_ARROW
+        int64_t n = (int64_t)t_.size();
+        // the arrays borrow the vectors' memory; it is written out before they are reused
+        auto batch = arrow::RecordBatch::Make( schema_, n,
+            { std::make_shared<arrow::DoubleArray>( n, arrow::Buffer::Wrap( t_ ) ),
+              std::make_shared<arrow::DoubleArray>( n, arrow::Buffer::Wrap( w_ ) ),
+              std::make_shared<arrow::DoubleArray>( n, arrow::Buffer::Wrap( Y_ ) ) } );
+        arrow::Status st;
+        if ( parquet_ ) {
+            auto table = arrow::Table::FromRecordBatches( { batch } );
+            st = table.ok() ? pq_->WriteTable( **table, n ) : table.status();
+        } else {
+            st = ipc_->WriteRecordBatch( *batch );
+        }
+        if ( !st.ok() ) fail( st );
+#endif
+        t_.clear();
+        w_.clear();
+        Y_.clear();
+    }
+
+#ifdef HAVE_ARROW
+    bool fail( const arrow::Status& st )
+    {
+        if ( err_.empty() ) err_ = st.ToString();
+        open_ = false;
+        return false;
+    }
+
+    std::shared_ptr<arrow::Schema> schema_;
+    std::shared_ptr<arrow::io::FileOutputStream> sink_;
+    std::unique_ptr<parquet::arrow::FileWriter> pq_;
+    std::shared_ptr<arrow::ipc::RecordBatchWriter> ipc_;
+#endif
+    long rowGroup_;
+    bool parquet_;
+    bool open_;
+    std::string err_;
+    std::vector<double> t_, w_, Y_;
+};
+
+#endif /* GOODWIN_ARROW_H */
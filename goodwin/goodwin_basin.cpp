@@ -0,0 +1,388 @@
+/*
+ Basin map of the Goodwin model: the fate of every initial condition
+ (w0, Y0) on a grid, with its cycle period and amplitude.
+
+ g++ -Wall -O2 -pthread -I/usr/include/ -c goodwin_basin.cpp &&
+ g++ -pthread -L/usr/local/lib goodwin_basin.o -lgsl -lgslcblas -lpopt -lstdc++fs -o goodwin_basin
+
+ Each grid cell is integrated only until goodwin_fate.h can classify it
+ (converged, periodic or diverged), checking every --dt, rather than for
+ a fixed horizon; --t-max bounds the cells that never settle.  Tiles of
+ --tile x --tile cells are dealt to --threads workers.
+
+ Cells share work through a cache on a coarse grid of --cache-cells
+ squared boxes over the mapped region.  A classified trajectory leaves
+ its fate in every box it passed through, and a later trajectory that
+ enters a marked box takes that fate and stops (and marks the boxes it
+ passed through in turn).  For an attracting fate that is exact up to the
+ box size.  The Goodwin model is conservative, with a family of nested
+ closed orbits, so there a hit means "an orbit within one box": period
+ and amplitude are good to about one box's worth of orbit.  The default
+ of 16 boxes per grid step keeps that to about a third of the change
+ from one grid cell to the next (on 32 x 32 at the default parameters:
+ a third of the integration, amplitudes within 0.1 of 5).  --cache-cells 0
+ turns the cache off and integrates every cell.
+
+ Writes one row per cell, w0,Y0,fate,period,amp_w,amp_Y,t_stop,cached.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+#include <popt.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <experimental/filesystem>
+
+#include "goodwin.h"
+#include "goodwin_rk.h"
+#include "goodwin_fate.h"
+
+namespace fs = std::experimental::filesystem;
+
+using namespace std;
+
+#define PROGRAM_NAME "goodwin_basin"
+#define VERSION 1
+
+struct basinOptions {
+    double wmin, wmax;  // NAN: 0.1 to twice the equilibrium
+    double Ymin, Ymax;
+    int nw, nY;
+    double tmax;
+    double dt;
+    int cacheCells;     // boxes per axis, -1 for 16 per grid step, 0 for none
+    int tile;
+    int threads;
+    char * stepper;
+    fateOptions fate;
+};
+
+static void parseArguments( int argc, const char **argv, goodwinParams* gparams,
+                            basinOptions* opts, char ** outfile )
+{
+    poptContext optCon;
+    const struct poptOption optionsTable[] = {
+        POPT_AUTOHELP
+        { "r", 'r', POPT_ARG_DOUBLE, &gparams->r, 0,
+            "Set wage appreciation parameter." },
+        { "c", 'c', POPT_ARG_DOUBLE, &gparams->c, 0,
+            "Set wage growth decay rate parameter." },
+        { "a", 'a', POPT_ARG_DOUBLE, &gparams->a, 0,
+            "Set output growth rate parameter." },
+        { "b", 'b', POPT_ARG_DOUBLE, &gparams->b, 0,
+            "Set output depreciation parameter." },
+        { "w-min", 0, POPT_ARG_DOUBLE, &opts->wmin, 0,
+            "Set smallest initial wage share (default 0.1)." },
+        { "w-max", 0, POPT_ARG_DOUBLE, &opts->wmax, 0,
+            "Set largest initial wage share (default 2a/b)." },
+        { "Y-min", 0, POPT_ARG_DOUBLE, &opts->Ymin, 0,
+            "Set smallest initial output (default 0.1)." },
+        { "Y-max", 0, POPT_ARG_DOUBLE, &opts->Ymax, 0,
+            "Set largest initial output (default 2c/r)." },
+        { "nw", 0, POPT_ARG_INT, &opts->nw, 0,
+            "Set grid points along w0 (default 64)." },
+        { "nY", 0, POPT_ARG_INT, &opts->nY, 0,
+            "Set grid points along Y0 (default 64)." },
+        { "t-max", 0, POPT_ARG_DOUBLE, &opts->tmax, 0,
+            "Set longest integration of a cell before it is left unresolved (default 1000)." },
+        { "dt", 0, POPT_ARG_DOUBLE, &opts->dt, 0,
+            "Set interval between fate checks (default 0.05)." },
+        { "cycle-tol", 0, POPT_ARG_DOUBLE, &opts->fate.cycleTol, 0,
+            "Set relative tolerance for recognizing a closed orbit (default 1e-5)." },
+        { "steady-tol", 0, POPT_ARG_DOUBLE, &opts->fate.steadyTol, 0,
+            "Set relative |dy/dt| counted as a steady state (default 1e-8)." },
+        { "bound", 0, POPT_ARG_DOUBLE, &opts->fate.bound, 0,
+            "Set |y| counted as diverged (default 1e6)." },
+        { "cache-cells", 0, POPT_ARG_INT, &opts->cacheCells, 0,
+            "Set fate cache boxes per axis (default 16 per grid step, at most 4096; 0 for no cache)." },
+        { "tile", 0, POPT_ARG_INT, &opts->tile, 0,
+            "Set tile side, in cells, handed to a worker at a time (default 8)." },
+        { "threads", 't', POPT_ARG_INT, &opts->threads, 0,
+            "Set number of worker threads (default: all cores)." },
+        { "stepper", 0, POPT_ARG_STRING, &opts->stepper, 0,
+            "Set ODE stepper: rk8pd (GSL, default), or native bs3, dp5, tsit5, vern6, vern9." },
+        { "output", 'o', POPT_ARG_STRING, outfile, 0,
+            "Pandas format CSV file output pathname." },
+        {NULL, 0, 0, NULL, 0, }
+    };
+    optCon = poptGetContext(PROGRAM_NAME, argc, argv, optionsTable, 0);
+    poptReadDefaultConfig(optCon, 0);
+    int err = poptGetNextOpt(optCon);
+    if (err != -1) {
+        fprintf(stderr, "\t%s: %s\n",
+            poptBadOption(optCon, POPT_BADOPTION_NOALIAS),
+            poptStrerror(err));
+        exit(-1);
+    }
+    poptFreeContext(optCon);
+}
+
+struct cellResult {
+    fateKind fate;
+    double period;
+    double amp[2];
+    double tStop;       // simulated time spent on the cell
+    bool cached;
+};
+
+/*
+ Fate cache: box (i, j) of the coarse grid holds the index of the first
+ classified result whose trajectory passed through it, or -1.  A result
+ is written in full before its index is published with release order, so
+ a worker that reads the index with acquire order sees the result.
+*/
+class fateCache {
+public:
+    fateCache( int n, double wmin, double wmax, double Ymin, double Ymax, size_t maxResults )
+        : n_( n ), wmin_( wmin ), Ymin_( Ymin ),
+          sw_( n / ( wmax - wmin ) ), sY_( n / ( Ymax - Ymin ) ),
+          boxes_( (size_t)n * n ), results_( maxResults ), count_( 0 )
+    {
+        for ( atomic<int>& b : boxes_ ) b.store( -1, memory_order_relaxed );
+    }
+
+    /* box of (w, Y), or -1 outside the cached region */
+    long box( double w, double Y ) const
+    {
+        double x = ( w - wmin_ ) * sw_, z = ( Y - Ymin_ ) * sY_;
+        if ( !( x >= 0.0 && x < n_ && z >= 0.0 && z < n_ ) ) return -1;
+        return (long)z * n_ + (long)x;
+    }
+
+    const cellResult* lookup( long b ) const
+    {
+        int k = boxes_[b].load( memory_order_acquire );
+        return ( k < 0 ) ? NULL : &results_[k];
+    }
+
+    int add( const cellResult& r )
+    {
+        int k = count_.fetch_add( 1 );
+        results_[k] = r;
+        return k;
+    }
+
+    /* Mark the boxes with result k where they are still free. */
+    void mark( const vector<long>& boxes, int k )
+    {
+        for ( long b : boxes ) {
+            int empty = -1;
+            boxes_[b].compare_exchange_strong( empty, k, memory_order_release, memory_order_relaxed );
+        }
+    }
+
+private:
+    int n_;
+    double wmin_, Ymin_, sw_, sY_;
+    vector< atomic<int> > boxes_;
+    vector<cellResult> results_;
+    atomic<int> count_;
+};
+
+struct basinShared {
+    goodwinParams p;
+    basinOptions o;
+    stepperKind kind;
+    double hw, hY;
+    fateCache * cache;
+    vector<cellResult> * results;
+    atomic<long> nextTile;
+    long tilesW, tiles;
+};
+
+static void basinWorker( basinShared* sh )
+{
+    goodwinIntegrator solver( sh->kind );
+    fateClassifier cls( sh->o.fate );
+    vector<long> visited;
+    const basinOptions& o = sh->o;
+    long k;
+    while ( ( k = sh->nextTile.fetch_add( 1 ) ) < sh->tiles ) {
+        long i0 = ( k % sh->tilesW ) * o.tile, j0 = ( k / sh->tilesW ) * o.tile;
+        for ( long j=j0; j < min( j0 + o.tile, (long)o.nY ); j++ ) {
+            for ( long i=i0; i < min( i0 + o.tile, (long)o.nw ); i++ ) {
+                goodwinParams p = sh->p;
+                p.w0 = o.wmin + i * sh->hw;
+                p.Y0 = o.Ymin + j * sh->hY;
+                solver.reset( p );
+                double t = 0.0, y[2] = { p.w0, p.Y0 }, f[2];
+                func( t, y, f, &p );
+                cls.start( t, y, f );
+                visited.clear();
+                cellResult res = { FATE_UNRESOLVED, 0.0, { 0.0, 0.0 }, 0.0, false };
+                const cellResult* hit = NULL;
+                for ( long n=1; ; n++ ) {
+                    if ( sh->cache != NULL ) {
+                        long b = sh->cache->box( y[0], y[1] );
+                        if ( b >= 0 ) {
+                            if ( ( hit = sh->cache->lookup( b ) ) != NULL ) break;
+                            if ( visited.empty() || visited.back() != b ) visited.push_back( b );
+                        }
+                    }
+                    if ( t >= o.tmax ) break;
+                    if ( solver.apply( &t, min( n * o.dt, o.tmax ), y ) != GSL_SUCCESS ) {
+                        res.fate = FATE_DIVERGED;
+                        break;
+                    }
+                    func( t, y, f, &p );
+                    if ( cls.push( t, y, f ) ) break;
+                }
+                if ( hit != NULL ) {
+                    res = *hit;
+                    res.cached = true;
+                } else if ( res.fate == FATE_UNRESOLVED ) {
+                    res.fate = cls.fate();
+                    res.period = cls.period();
+                    res.amp[0] = cls.amplitude()[0];
+                    res.amp[1] = cls.amplitude()[1];
+                }
+                res.tStop = t;
+                (*sh->results)[j * o.nw + i] = res;
+                if ( sh->cache != NULL && res.fate != FATE_UNRESOLVED ) {
+                    sh->cache->mark( visited, sh->cache->add( res ) );
+                }
+            }
+        }
+    }
+}
+
+int main ( int argc, const char *argv[] )
+{
+    goodwinParams params;
+    defaultParams( &params );
+    basinOptions opts;
+    opts.wmin = opts.wmax = opts.Ymin = opts.Ymax = NAN;
+    opts.nw = opts.nY = 64;
+    opts.tmax = 1000.0;
+    opts.dt = 0.05;
+    opts.cacheCells = -1;
+    opts.tile = 8;
+    opts.threads = 0;
+    opts.stepper = NULL;
+    defaultFateOptions( &opts.fate );
+    char * pathname = NULL;
+    parseArguments( argc, argv, &params, &opts, &pathname );
+    string outfile = ( pathname != NULL ) ? pathname : "";
+    free( pathname );
+
+    if ( opts.nw < 1 || opts.nY < 1 || opts.tile < 1 ) {
+        fprintf(stderr,"\tnw, nY and tile must be positive\n");
+        exit(-1);
+    }
+    if ( !( opts.dt > 0.0 ) || !( opts.tmax > 0.0 ) ) {
+        fprintf(stderr,"\tdt and t-max must be positive\n");
+        exit(-1);
+    }
+    stepperKind kind = STEPPER_RK8PD;
+    if ( opts.stepper != NULL && !parseStepper( opts.stepper, &kind ) ) {
+        fprintf(stderr,"\tstepper: unknown stepper '%s' (use rk8pd, bs3, dp5, tsit5, vern6 or vern9)\n",opts.stepper);
+        exit(-1);
+    }
+    if ( std::isnan( opts.wmin ) ) opts.wmin = 0.1;
+    if ( std::isnan( opts.Ymin ) ) opts.Ymin = 0.1;
+    if ( std::isnan( opts.wmax ) ) opts.wmax = 2.0 * params.a / params.b;
+    if ( std::isnan( opts.Ymax ) ) opts.Ymax = 2.0 * params.c / params.r;
+    if ( !( opts.wmax >= opts.wmin ) || !( opts.Ymax >= opts.Ymin ) ) {
+        fprintf(stderr,"\tgrid ranges must have max >= min\n");
+        exit(-1);
+    }
+    if ( opts.cacheCells < 0 ) opts.cacheCells = min( 16 * max( opts.nw, opts.nY ), 4096 );    // 64 MB at most
+    int nthreads = ( opts.threads > 0 ) ? opts.threads : max( 1u, thread::hardware_concurrency() );
+
+    basinShared sh;
+    sh.p = params;
+    sh.o = opts;
+    sh.kind = kind;
+    sh.hw = ( opts.nw > 1 ) ? ( opts.wmax - opts.wmin ) / ( opts.nw - 1 ) : 0.0;
+    sh.hY = ( opts.nY > 1 ) ? ( opts.Ymax - opts.Ymin ) / ( opts.nY - 1 ) : 0.0;
+    size_t ncells = (size_t)opts.nw * opts.nY;
+    vector<cellResult> results( ncells );
+    sh.results = &results;
+    // the boxes cover the grid plus half a grid step all round
+    unique_ptr<fateCache> cache;
+    if ( opts.cacheCells > 0 ) {
+        double ew = ( sh.hw > 0.0 ) ? 0.5 * sh.hw : 0.5, eY = ( sh.hY > 0.0 ) ? 0.5 * sh.hY : 0.5;
+        cache.reset( new fateCache( opts.cacheCells, opts.wmin - ew, opts.wmax + ew,
+                                    opts.Ymin - eY, opts.Ymax + eY, ncells ) );
+    }
+    sh.cache = cache.get();
+    sh.tilesW = ( opts.nw + opts.tile - 1 ) / opts.tile;
+    sh.tiles = sh.tilesW * ( ( opts.nY + opts.tile - 1 ) / opts.tile );
+    sh.nextTile = 0;
+
+    cout << "Mapping " << opts.nw << " x " << opts.nY << " initial conditions on " << nthreads
+         << " threads, " << stepperName( kind ) << ", t-max " << opts.tmax;
+    if ( sh.cache != NULL ) cout << ", fate cache " << opts.cacheCells << "^2";
+    cout << endl;
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for ( int id=0; id < nthreads; id++ ) workers.push_back( thread( basinWorker, &sh ) );
+    for ( thread& th : workers ) th.join();
+    double secs = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+
+    long count[4] = { 0, 0, 0, 0 }, cached = 0;
+    double simulated = 0.0;
+    for ( const cellResult& r : results ) {
+        count[r.fate]++;
+        cached += r.cached;
+        simulated += r.tStop;
+    }
+    cout << "Done in " << secs << " s: " << count[FATE_PERIODIC] << " periodic, "
+         << count[FATE_CONVERGED] << " converged, " << count[FATE_DIVERGED] << " diverged, "
+         << count[FATE_UNRESOLVED] << " unresolved; " << cached << " from the cache" << endl;
+    cout << "Integrated " << simulated << " time units, " << setprecision(3)
+         << 100.0 * simulated / ( ncells * opts.tmax ) << "% of running every cell to t-max" << endl;
+
+    time_t sysTime = time(0);
+    char chTime[80];
+    strftime(chTime,79,"%Y-%m-%d",localtime(&sysTime));
+    string csvfile = strformat("./sim_data/%s_v%d_%s.pd",PROGRAM_NAME,VERSION,chTime);
+    if ( outfile.empty() ) {
+        cout<<"Using default output pathname: '"<< csvfile <<"'"<< endl;
+    } else {
+        csvfile = outfile;
+        cout << "Using outfile pathname set by user: '"<< csvfile <<"'" <<endl;
+    }
+    fs::path dname = fs::path( csvfile ).parent_path();
+    struct stat info;
+    if ( !dname.empty() && stat( dname.c_str(), &info ) != 0 ) {
+        printf(" dir path '%s' does not exist, so\n",dname.c_str());
+        printf(" we will now create this directory for you.\n");
+        int status = mkdir(dname.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+        if ( status == -1 ) printf("Could not mkdir for '%s'\n",dname.c_str());
+    }
+    ofstream pdout( csvfile );
+    if ( !pdout ) {
+        printf("Could not open '%s' for writing\n",csvfile.c_str());
+        return -1;
+    }
+    pdout << "# Goodwin model basin map." << endl;
+    pdout << "# r="<< params.r << " , c=" << params.c
+       << " , a=" << params.a << " , b=" << params.b << endl;
+    pdout << "# w0=" << opts.wmin << ":" << opts.wmax << ":" << opts.nw
+       << " , Y0=" << opts.Ymin << ":" << opts.Ymax << ":" << opts.nY
+       << " , t_max=" << opts.tmax << " , dt=" << opts.dt << " , stepper=" << stepperName( kind )
+       << " , cycle_tol=" << opts.fate.cycleTol << " , cache_cells=" << opts.cacheCells << endl;
+    pdout << "w0,Y0,fate,period,amp_w,amp_Y,t_stop,cached" << endl;
+    pdout << setprecision(8);
+    for ( long j=0; j < opts.nY; j++ ) {
+        for ( long i=0; i < opts.nw; i++ ) {
+            const cellResult& r = results[j * opts.nw + i];
+            pdout << opts.wmin + i * sh.hw << "," << opts.Ymin + j * sh.hY << "," << fateName( r.fate ) << ","
+                  << r.period << "," << r.amp[0] << "," << r.amp[1] << "," << r.tStop << "," << r.cached << "\n";
+        }
+    }
+    pdout.close();
+    cout<< "Done.  See output in "<< csvfile <<endl;
+    return 0;
+}
@@ -0,0 +1,200 @@
+/*
+ Continuation of Goodwin equilibria and periodic orbits in one parameter
+ (goodwin_cont.h), instead of a sweep of independent long integrations.
+
+ g++ -Wall -O2 -I/usr/include/ -c goodwin_cont.cpp &&
+ g++ -L/usr/local/lib goodwin_cont.o -lgsl -lgslcblas -lpopt -lstdc++fs -o goodwin_cont
+
+ --param r|c|a|b is continued from its command line value to --to.  The
+ orbit branch starts from the orbit through (w0, Y0), found by shooting,
+ and since the model is conservative follows the orbit through that
+ point; the equilibrium branch starts from (a/b, c/r).  One row per
+ branch point goes to the .pd file, and events (folds, Hopf points,
+ stability changes) are printed as they are found.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <popt.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <experimental/filesystem>
+
+#include "goodwin.h"
+#include "goodwin_orbit.h"
+#include "goodwin_cont.h"
+
+namespace fs = std::experimental::filesystem;
+
+using namespace std;
+
+#define PROGRAM_NAME "goodwin_cont"
+#define VERSION 1
+
+struct contRunOptions {
+    char * param;       // r, c, a or b
+    double to;
+    char * branch;      // "orbit" (default) or "equilibrium"
+    double ds;
+    double dsMax;
+    int maxSteps;
+};
+
+static void parseArguments( int argc, const char **argv, goodwinParams* gparams,
+                            contRunOptions* opts, char ** outfile )
+{
+    poptContext optCon;
+    const struct poptOption optionsTable[] = {
+        POPT_AUTOHELP
+        { "r", 'r', POPT_ARG_DOUBLE, &gparams->r, 0,
+            "Set wage appreciation parameter." },
+        { "c", 'c', POPT_ARG_DOUBLE, &gparams->c, 0,
+            "Set wage growth decay rate parameter." },
+        { "a", 'a', POPT_ARG_DOUBLE, &gparams->a, 0,
+            "Set output growth rate parameter." },
+        { "b", 'b', POPT_ARG_DOUBLE, &gparams->b, 0,
+            "Set output depreciation parameter." },
+        { "w0", 'w', POPT_ARG_DOUBLE, &gparams->w0, 0,
+            "Set initial wage share (the starting orbit passes through it)." },
+        { "Y0", 'y', POPT_ARG_DOUBLE, &gparams->Y0, 0,
+            "Set initial output level (the starting orbit passes through it)." },
+        { "Y0", 'Y', POPT_ARG_DOUBLE, &gparams->Y0, 0,
+            "Set initial output level (the starting orbit passes through it)." },
+        { "param", 'P', POPT_ARG_STRING, &opts->param, 0,
+            "Set continuation parameter: r (default), c, a or b." },
+        { "to", 0, POPT_ARG_DOUBLE, &opts->to, 0,
+            "Set parameter value to continue to (default: twice the start)." },
+        { "branch", 0, POPT_ARG_STRING, &opts->branch, 0,
+            "Set branch to follow: orbit (default) or equilibrium." },
+        { "ds", 0, POPT_ARG_DOUBLE, &opts->ds, 0,
+            "Set first arclength step (default 0.01)." },
+        { "ds-max", 0, POPT_ARG_DOUBLE, &opts->dsMax, 0,
+            "Set largest arclength step (default 0.1)." },
+        { "max-steps", 0, POPT_ARG_INT, &opts->maxSteps, 0,
+            "Set most branch points (default 1000)." },
+        { "output", 'o', POPT_ARG_STRING, outfile, 0,
+            "Pandas format CSV file output pathname." },
+        {NULL, 0, 0, NULL, 0, }
+    };
+    optCon = poptGetContext(PROGRAM_NAME, argc, argv, optionsTable, 0);
+    poptReadDefaultConfig(optCon, 0);
+    int err = poptGetNextOpt(optCon);
+    if (err != -1) {
+        fprintf(stderr, "\t%s: %s\n",
+            poptBadOption(optCon, POPT_BADOPTION_NOALIAS),
+            poptStrerror(err));
+        exit(-1);
+    }
+    poptFreeContext(optCon);
+}
+
+int main ( int argc, const char *argv[] )
+{
+    goodwinParams params;
+    defaultParams( &params );
+    contRunOptions opts;
+    opts.param = NULL;
+    opts.to = NAN;
+    opts.branch = NULL;
+    opts.ds = 0.01;
+    opts.dsMax = 0.1;
+    opts.maxSteps = 1000;
+    char * pathname = NULL;
+    parseArguments( argc, argv, &params, &opts, &pathname );
+    string outfile = ( pathname != NULL ) ? pathname : "";
+    free( pathname );
+
+    string pname = ( opts.param != NULL ) ? opts.param : "r";
+    double * lambda = NULL;
+    if ( pname == "r" ) lambda = &params.r;
+    else if ( pname == "c" ) lambda = &params.c;
+    else if ( pname == "a" ) lambda = &params.a;
+    else if ( pname == "b" ) lambda = &params.b;
+    else {
+        fprintf(stderr,"\tparam: unknown parameter '%s' (use r, c, a or b)\n",pname.c_str());
+        exit(-1);
+    }
+    bool orbits = ( opts.branch == NULL || strcmp( opts.branch, "orbit" ) == 0 );
+    if ( !orbits && strcmp( opts.branch, "equilibrium" ) != 0 ) {
+        fprintf(stderr,"\tbranch: unknown branch '%s' (use orbit or equilibrium)\n",opts.branch);
+        exit(-1);
+    }
+    contOptions co;
+    defaultContOptions( &co, std::isnan( opts.to ) ? 2.0 * *lambda : opts.to );
+    co.ds = opts.ds;
+    co.dsMax = opts.dsMax;
+    co.maxSteps = opts.maxSteps;
+    co.pinStart = true;    // conservative: follow the orbit through (w0, Y0)
+
+    gsl_odeiv2_system sys = { func, jac, 2, &params };
+    gsl_set_error_handler_off();
+    vector<contPoint> branch;
+    string err;
+    bool ok;
+    if ( orbits ) {
+        double x[2] = { params.w0, params.Y0 };
+        double T;
+        periodicOrbit orbit;
+        if ( !estimatePeriod( &sys, x, 0.0, 1e4, 0.01, &T, &err )
+             || !findPeriodicOrbit( &sys, x, T, co.shoot, &orbit, &err ) ) {
+            fprintf(stderr,"\tstarting orbit: %s\n",err.c_str());
+            exit(-1);
+        }
+        ok = continueOrbits( &sys, lambda, orbit, co, &branch, &err );
+    } else {
+        double x[2] = { params.a / params.b, params.c / params.r };
+        ok = continueEquilibria( &sys, lambda, x, co, &branch, &err );
+    }
+    if ( !ok ) cout << "Continuation stopped: " << err << endl;
+    cout << "Continued " << ( orbits ? "orbits" : "equilibria" ) << " in " << pname << " from "
+         << *lambda << " to " << ( branch.empty() ? *lambda : branch.back().lambda ) << " in "
+         << branch.size() << " points" << endl;
+    for ( const contPoint& pt : branch ) {
+        if ( !pt.event.empty() ) cout << "  " << pt.event << " near " << pname << "=" << pt.eventLambda << endl;
+    }
+
+    time_t sysTime = time(0);
+    char chTime[80];
+    strftime(chTime,79,"%Y-%m-%d",localtime(&sysTime));
+    string csvfile = strformat("./sim_data/%s_v%d_%s_%s.pd",PROGRAM_NAME,VERSION,pname.c_str(),chTime);
+    if ( outfile.empty() ) {
+        cout<<"Using default output pathname: '"<< csvfile <<"'"<< endl;
+    } else {
+        csvfile = outfile;
+        cout << "Using outfile pathname set by user: '"<< csvfile <<"'" <<endl;
+    }
+    fs::path dname = fs::path( csvfile ).parent_path();
+    struct stat info;
+    if ( !dname.empty() && stat( dname.c_str(), &info ) != 0 ) {
+        printf(" dir path '%s' does not exist, so\n",dname.c_str());
+        printf(" we will now create this directory for you.\n");
+        int status = mkdir(dname.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+        if ( status == -1 ) printf("Could not mkdir for '%s'\n",dname.c_str());
+    }
+    ofstream pdout( csvfile );
+    if ( !pdout ) {
+        printf("Could not open '%s' for writing\n",csvfile.c_str());
+        return -1;
+    }
+    pdout << "# Goodwin model " << ( orbits ? "periodic orbit" : "equilibrium" ) << " continuation in "
+       << pname << "." << endl;
+    pdout << "# r="<< params.r << " , c=" << params.c
+       << " , a=" << params.a << " , b=" << params.b
+       << " , w0="<< params.w0 << " , Y0=" << params.Y0 << endl;
+    // NB: no whitespace in the column names if we want Pandas dataframe format
+    pdout << pname << ",period,wages,output,unstable,event" << endl;
+    pdout << setprecision(10);
+    for ( const contPoint& pt : branch ) {
+        pdout << pt.lambda << "," << pt.period << "," << pt.x[0] << "," << pt.x[1] << ","
+              << pt.unstable << "," << pt.event << endl;
+    }
+    pdout.close();
+    cout<< "Done.  See output in "<< csvfile <<endl;
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,343 @@
+/*
+ Pseudo-arclength continuation of equilibria and periodic orbits in one
+ parameter, replacing sweeps of independent long integrations.
+
+ The parameter lambda is a double inside the system's params (&params.r,
+ &mu, ...); the continuation writes it before every evaluation and puts
+ the original value back when it returns.
+
+ A branch is a curve u(s) in (state, lambda) space:
+   equilibria   u = (x, lambda)        f(x; lambda) = 0
+   orbits       u = (x0, T, lambda)    phi(T, x0; lambda) - x0 = 0 and
+                                       f(xp) . (x0 - xp) = 0, with xp the
+                                       previous point on the branch
+ Each step predicts u + ds tangent and corrects by Newton on the branch
+ equations plus the arclength condition tangent . (u - upredicted) = 0,
+ so the corrector warm-starts from the last solution and a fold, where
+ lambda turns back, is passed like any other point.  The Jacobians are
+ the model's jac() (and the monodromy matrix for orbits, as in
+ goodwin_orbit.h) with d/dlambda by central differences.  ds grows after
+ quick convergence and is halved on failure, so the cost of a branch
+ grows linearly with its length.
+
+ Events are reported at the first point past them, with lambda located by
+ linear interpolation of the test function:
+   fold              d lambda / ds changes sign
+   hopf              (equilibria) the real part of a complex pair of
+                     eigenvalues changes sign: a periodic orbit is born
+   period-doubling,  (orbits) a nontrivial Floquet multiplier leaves or
+   torus             enters the unit circle through -1, or as a complex pair
+ Conservative models such as Goodwin's have a family of orbits at every
+ lambda; contOptions.pinStart then also holds x0[0] fixed, so the branch
+ follows the orbit through the starting point.  Their multipliers sit
+ at 1 to within about sqrt(epsabs), which is why stability changes need
+ to clear CONT_MULT_BAND.
+*/
+
+#ifndef GOODWIN_CONT_H
+#define GOODWIN_CONT_H
+
+#include <cmath>
+#include <complex>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "goodwin_orbit.h"
+
+static const double CONT_REAL_BAND = 1e-9;    // |Re| below this counts as 0
+static const double CONT_MULT_BAND = 1e-4;    // ||mu| - 1| below this counts as 0
+
+struct contOptions {
+    double lambdaEnd;   // stop once lambda leaves [start, end]
+    double ds;          // first step
+    double dsMin;
+    double dsMax;
+    int maxSteps;
+    double tol;         // corrector residual
+    int maxIter;        // corrector Newton steps
+    bool pinStart;      // orbits of conservative models: hold x0[0]
+    shootingOptions shoot;
+};
+
+inline void defaultContOptions( contOptions* o, double lambdaEnd )
+{
+    o->lambdaEnd = lambdaEnd;
+    o->ds = 0.01;
+    o->dsMin = 1e-6;
+    o->dsMax = 0.1;
+    o->maxSteps = 1000;
+    o->tol = 1e-9;
+    o->maxIter = 8;
+    o->pinStart = false;
+    defaultShootingOptions( &o->shoot );
+}
+
+struct contPoint {
+    double lambda;
+    std::vector<double> x;          // equilibrium, or the orbit's x0
+    double period;                  // 0 for equilibria
+    std::vector< std::complex<double> > eig;  // eigenvalues / Floquet multipliers
+    int unstable;                   // eigenvalues with Re > 0 / nontrivial multipliers with |mu| > 1
+    std::string event;              // "", or the events found since the previous point
+    double eventLambda;
+    int iterations;                 // corrector Newton steps
+};
+
+/* [J; tref'] t = [0; 1], normalized: the tangent continuing in the direction of tref. */
+inline bool contTangent( const std::vector<double>& J, size_t m, size_t nu, const std::vector<double>& tref,
+                         std::vector<double>* t )
+{
+    std::vector<double> A( J.begin(), J.begin() + m*nu ), b( m+1, 0.0 );
+    A.insert( A.end(), tref.begin(), tref.end() );
+    b[m] = 1.0;
+    if ( !svdSolve( A, b, m+1, nu, t ) ) return false;
+    double norm = 0.0;
+    for ( double v : *t ) norm += v*v;
+    norm = sqrt( norm );
+    if ( !( norm > 0.0 ) ) return false;
+    for ( double& v : *t ) v /= norm;
+    return true;
+}
+
+/*
+ Follow the branch through u0 (lambda last) in the direction of increasing
+ lambda if dir > 0.  eval(u, &F, &J) gives the m branch equations and their
+ m x nu Jacobian; accept(u, tangent, iterations) is called at every point,
+ u0 included, and returns false to stop.
+*/
+template <class Eval, class Accept>
+bool followBranch( Eval eval, size_t m, const std::vector<double>& u0, double dir, const contOptions& o,
+                   Accept accept, std::string* err )
+{
+    size_t nu = u0.size();
+    double lo = std::min( u0.back(), o.lambdaEnd ), hi = std::max( u0.back(), o.lambdaEnd );
+    std::vector<double> u( u0 ), F, J, tau, tref( nu, 0.0 ), v, dv, A, r;
+    tref[nu-1] = ( dir > 0 ) ? 1.0 : -1.0;
+    if ( !eval( u, &F, &J ) || !contTangent( J, m, nu, tref, &tau ) ) {
+        *err = "no tangent at the starting point";
+        return false;
+    }
+    if ( !accept( u, tau, 0 ) ) return true;
+    double ds = o.ds;
+    for ( int step=1; step <= o.maxSteps; step++ ) {
+        bool converged = false;
+        int it = 0;
+        while ( !converged ) {
+            v = u;
+            for ( size_t i=0; i < nu; i++ ) v[i] += ds * tau[i];
+            std::vector<double> upred( v );
+            for ( it=1; it <= o.maxIter; it++ ) {
+                if ( !eval( v, &F, &J ) ) break;
+                double arc = 0.0;
+                for ( size_t i=0; i < nu; i++ ) arc += tau[i] * ( v[i] - upred[i] );
+                double res = fabs( arc );
+                for ( double f : F ) res = std::max( res, fabs( f ) );
+                if ( res < o.tol ) {
+                    converged = true;
+                    break;
+                }
+                A.assign( J.begin(), J.begin() + m*nu );
+                A.insert( A.end(), tau.begin(), tau.end() );
+                r.resize( m+1 );
+                for ( size_t i=0; i < m; i++ ) r[i] = -F[i];
+                r[m] = -arc;
+                if ( !svdSolve( A, r, m+1, nu, &dv ) ) break;
+                for ( size_t i=0; i < nu; i++ ) v[i] += dv[i];
+            }
+            if ( !converged ) {
+                ds *= 0.5;
+                if ( ds < o.dsMin ) {
+                    *err = strformat( "corrector failed at lambda = %g with ds below %g", u.back(), o.dsMin );
+                    return false;
+                }
+            }
+        }
+        std::vector<double> tnew;
+        if ( !contTangent( J, m, nu, tau, &tnew ) ) {
+            *err = strformat( "no tangent at lambda = %g", v.back() );
+            return false;
+        }
+        u = v;
+        tau = tnew;
+        if ( !accept( u, tau, it ) ) return true;
+        if ( u.back() < lo || u.back() > hi ) return true;
+        if ( it <= 3 ) ds = std::min( 1.5 * ds, o.dsMax );
+    }
+    return true;
+}
+
+/* lambda where a test function going from (l0, g0) to (l1, g1) crosses 0 */
+inline double contCrossing( double l0, double g0, double l1, double g1 )
+{
+    return ( g1 != g0 ) ? l0 + ( l1 - l0 ) * g0 / ( g0 - g1 ) : l1;
+}
+
+inline int bandSign( double x, double band )
+{
+    return ( x > band ) ? 1 : ( x < -band ) ? -1 : 0;
+}
+
+/* Continue the equilibrium near x0 at the current *lambda. */
+inline bool continueEquilibria( const gsl_odeiv2_system* sys, double* lambda, const double* x0,
+                                const contOptions& o, std::vector<contPoint>* branch, std::string* err )
+{
+    size_t n = sys->dimension;
+    double lambda0 = *lambda;
+    std::vector<double> x( x0, x0 + n ), J( n*n ), dfdt( n ), fp( n ), fm( n );
+    std::vector< std::complex<double> > ev;
+    if ( !findEquilibrium( sys, x.data(), &ev, err ) ) return false;
+
+    auto eval = [&]( const std::vector<double>& u, std::vector<double>* F, std::vector<double>* Ju ) {
+        double h = 1e-7 * ( 1.0 + fabs( u[n] ) );
+        *lambda = u[n] + h;
+        sys->function( 0.0, u.data(), fp.data(), sys->params );
+        *lambda = u[n] - h;
+        sys->function( 0.0, u.data(), fm.data(), sys->params );
+        *lambda = u[n];
+        F->resize( n );
+        sys->function( 0.0, u.data(), F->data(), sys->params );
+        sys->jacobian( 0.0, u.data(), J.data(), dfdt.data(), sys->params );
+        Ju->resize( n * ( n+1 ) );
+        for ( size_t i=0; i < n; i++ ) {
+            for ( size_t j=0; j < n; j++ ) (*Ju)[i*(n+1)+j] = J[i*n+j];
+            (*Ju)[i*(n+1)+n] = ( fp[i] - fm[i] ) / ( 2*h );
+        }
+        for ( double f : *F ) if ( !std::isfinite( f ) ) return false;
+        return true;
+    };
+    double prevTau = 0.0, prevHopf = NAN;
+    auto accept = [&]( const std::vector<double>& u, const std::vector<double>& tau, int it ) {
+        contPoint pt;
+        pt.lambda = u[n];
+        pt.x.assign( u.begin(), u.begin() + n );
+        pt.period = 0.0;
+        pt.iterations = it;
+        pt.eventLambda = NAN;
+        *lambda = u[n];
+        sys->jacobian( 0.0, u.data(), J.data(), dfdt.data(), sys->params );
+        eigenvalues( J, n, &pt.eig );
+        pt.unstable = 0;
+        double hopf = NAN;
+        for ( const std::complex<double>& z : pt.eig ) {
+            if ( z.real() > CONT_REAL_BAND ) pt.unstable++;
+            if ( fabs( z.imag() ) > CONT_REAL_BAND && !( z.real() <= hopf ) ) hopf = z.real();
+        }
+        if ( !branch->empty() ) {
+            const contPoint& prev = branch->back();
+            if ( prevTau * tau[n] < 0.0 ) {
+                // lambda turns back at the fold: the nearer estimate is the outer point
+                pt.event = "fold";
+                pt.eventLambda = ( tau[n] < 0 ) ? std::max( prev.lambda, pt.lambda ) : std::min( prev.lambda, pt.lambda );
+            }
+            if ( bandSign( hopf, CONT_REAL_BAND ) * bandSign( prevHopf, CONT_REAL_BAND ) < 0 ) {
+                pt.event += pt.event.empty() ? "hopf" : ",hopf";
+                pt.eventLambda = contCrossing( prev.lambda, prevHopf, pt.lambda, hopf );
+            }
+        }
+        prevTau = tau[n];
+        prevHopf = hopf;
+        branch->push_back( pt );
+        return true;
+    };
+    std::vector<double> u( x );
+    u.push_back( lambda0 );
+    bool ok = followBranch( eval, n, u, ( o.lambdaEnd >= lambda0 ) ? 1.0 : -1.0, o, accept, err );
+    *lambda = lambda0;
+    return ok;
+}
+
+/* Continue a periodic orbit found at the current *lambda. */
+inline bool continueOrbits( const gsl_odeiv2_system* sys, double* lambda, const periodicOrbit& start,
+                            const contOptions& o, std::vector<contPoint>* branch, std::string* err )
+{
+    size_t n = sys->dimension;
+    double lambda0 = *lambda;
+    size_t m = o.pinStart ? n+2 : n+1;
+    size_t nu = n+2;
+    double pin = start.x0[0];
+    std::vector<double> xref( start.x0 ), fref( n ), xT( n ), fT( n ), M( n*n ), xp( n ), xm( n );
+    *lambda = lambda0;
+    sys->function( 0.0, xref.data(), fref.data(), sys->params );
+
+    auto eval = [&]( const std::vector<double>& u, std::vector<double>* F, std::vector<double>* Ju ) {
+        double T = u[n], h = 1e-6 * ( 1.0 + fabs( u[n+1] ) );
+        if ( !( T > 0.0 ) ) return false;
+        *lambda = u[n+1] + h;
+        if ( flowMap( sys, u.data(), T, xp.data(), NULL, o.shoot.epsabs, o.shoot.epsrel ) != GSL_SUCCESS ) return false;
+        *lambda = u[n+1] - h;
+        if ( flowMap( sys, u.data(), T, xm.data(), NULL, o.shoot.epsabs, o.shoot.epsrel ) != GSL_SUCCESS ) return false;
+        *lambda = u[n+1];
+        if ( flowMap( sys, u.data(), T, xT.data(), M.data(), o.shoot.epsabs, o.shoot.epsrel ) != GSL_SUCCESS ) return false;
+        sys->function( 0.0, xT.data(), fT.data(), sys->params );
+        F->assign( m, 0.0 );
+        Ju->assign( m * nu, 0.0 );
+        for ( size_t i=0; i < n; i++ ) {
+            (*F)[i] = xT[i] - u[i];
+            for ( size_t j=0; j < n; j++ ) (*Ju)[i*nu+j] = M[i*n+j] - ( i == j ? 1.0 : 0.0 );
+            (*Ju)[i*nu+n] = fT[i];
+            (*Ju)[i*nu+n+1] = ( xp[i] - xm[i] ) / ( 2*h );
+            (*F)[n] += fref[i] * ( u[i] - xref[i] );
+            (*Ju)[n*nu+i] = fref[i];
+        }
+        if ( o.pinStart ) {
+            (*F)[n+1] = u[0] - pin;
+            (*Ju)[(n+1)*nu] = 1.0;
+        }
+        return true;
+    };
+    double prevTau = 0.0, prevMod = NAN;
+    auto accept = [&]( const std::vector<double>& u, const std::vector<double>& tau, int it ) {
+        contPoint pt;
+        pt.lambda = u[n+1];
+        pt.x.assign( u.begin(), u.begin() + n );
+        pt.period = u[n];
+        pt.iterations = it;
+        pt.eventLambda = NAN;
+        eigenvalues( M, n, &pt.eig );   // M is from the last, converged, evaluation
+        // drop the trivial multiplier, the one nearest 1
+        std::vector< std::complex<double> > rest( pt.eig );
+        size_t triv = 0;
+        for ( size_t k=1; k < rest.size(); k++ ) {
+            if ( std::abs( rest[k] - 1.0 ) < std::abs( rest[triv] - 1.0 ) ) triv = k;
+        }
+        if ( !rest.empty() ) rest.erase( rest.begin() + triv );
+        pt.unstable = 0;
+        double mod = NAN;
+        std::complex<double> crossing( 0.0, 0.0 );
+        for ( const std::complex<double>& z : rest ) {
+            if ( std::abs( z ) > 1.0 + CONT_MULT_BAND ) pt.unstable++;
+            if ( !( std::abs( z ) - 1.0 <= mod ) ) {
+                mod = std::abs( z ) - 1.0;
+                crossing = z;
+            }
+        }
+        if ( !branch->empty() ) {
+            const contPoint& prev = branch->back();
+            if ( prevTau * tau[n+1] < 0.0 ) {
+                pt.event = "fold";
+                pt.eventLambda = ( tau[n+1] < 0 ) ? std::max( prev.lambda, pt.lambda ) : std::min( prev.lambda, pt.lambda );
+            } else if ( bandSign( mod, CONT_MULT_BAND ) * bandSign( prevMod, CONT_MULT_BAND ) < 0 ) {
+                pt.event = ( fabs( crossing.imag() ) > CONT_MULT_BAND ) ? "torus"
+                         : ( crossing.real() < 0.0 ) ? "period-doubling" : "fold";
+                pt.eventLambda = contCrossing( prev.lambda, prevMod, pt.lambda, mod );
+            }
+        }
+        prevTau = tau[n+1];
+        prevMod = mod;
+        branch->push_back( pt );
+        // the next phase condition is relative to this orbit
+        xref = pt.x;
+        *lambda = pt.lambda;
+        sys->function( 0.0, xref.data(), fref.data(), sys->params );
+        return true;
+    };
+    std::vector<double> u( start.x0 );
+    u.push_back( start.period );
+    u.push_back( lambda0 );
+    bool ok = followBranch( eval, m, u, ( o.lambdaEnd >= lambda0 ) ? 1.0 : -1.0, o, accept, err );
+    *lambda = lambda0;
+    return ok;
+}
+
+#endif /* GOODWIN_CONT_H */
@@ -0,0 +1,365 @@
+/*
+ Delay-differential Goodwin wage--output model.
+
+ Wage bargaining responds to output with a lag tau,
+
+   dw/dt = -c w(t) + r w(t) Y(t-tau)
+   dY/dt =  a Y(t) - b w(t) Y(t)
+
+ with constant initial history w(t)=w0, Y(t)=Y0 for t <= t_start.  This cannot be
+ posed as a gsl_odeiv2_system, so it is integrated here by the method of
+ steps with a classical RK4 step of size h <= tau.  Past states live in a
+ ring buffer of (t, y, dy/dt) nodes, and delayed values are read from it
+ by cubic Hermite (dense output) interpolation, so memory is bounded by
+ tau/h no matter how long the run.
+
+ The jump in dy/dt at t_start propagates to t_start + tau, + 2tau, ...,
+ becoming one derivative smoother each time.  Steps are shortened to land
+ exactly on these breakpoints until the jump is beyond the order of the
+ method, so no step ever straddles one.
+
+ g++ -Wall -O2 -I/usr/include/ -c goodwin_dde.cpp &&
+ g++ -L/usr/local/lib goodwin_dde.o -lgsl -lgslcblas -lpopt -lstdc++fs -o goodwin_dde
+*/
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <unistd.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <cmath>
+
+#include <popt.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <experimental/filesystem>
+
+#include "goodwin.h"
+#include "goodwin_grid.h"
+
+namespace fs = std::experimental::filesystem;
+
+using namespace std;
+
+#define PROGRAM_NAME "goodwin_dde"
+#define VERSION 1
+/* order of the RK step: breakpoints beyond this many delays are ignored */
+#define DDE_ORDER 4
+
+struct ddeParams {
+    goodwinParams p;
+    double tau;
+    double h;
+};
+
+static void parseArguments( int argc, const char **argv, ddeParams* dparams, gridOptions* grid,
+                            char ** outfile )
+{
+    goodwinParams* gparams = &dparams->p;
+    poptContext optCon;
+    const struct poptOption optionsTable[] = {
+        POPT_AUTOHELP
+        { "nsteps", 'n', POPT_ARG_INT, &gparams->Nsteps, 0,
+            "Set number of time steps." },
+        { "tau", 'd', POPT_ARG_DOUBLE, &dparams->tau, 0,
+            "Set wage response delay to output." },
+        { "h", 0, POPT_ARG_DOUBLE, &dparams->h, 0,
+            "Set integration step (reduced to tau if larger)." },
+        { "t-start", 0, POPT_ARG_DOUBLE, &grid->tStart, 0,
+            "Set start time of the run (default 0)." },
+        { "t-end", 0, POPT_ARG_DOUBLE, &grid->tEnd, 0,
+            "Set end time of the run; with a linear grid this sets the number of outputs." },
+        { "dt", 0, POPT_ARG_DOUBLE, &grid->dt, 0,
+            "Set output spacing (default 0.1); the first output time of a log grid." },
+        { "grid", 0, POPT_ARG_STRING, &grid->spacing, 0,
+            "Set output times: linear (default), log (Nsteps log-spaced to t-end), or final (last state only)." },
+        { "r", 'r', POPT_ARG_DOUBLE, &gparams->r, 0,
+            "Set wage appreciation parameter." },
+        { "c", 'c', POPT_ARG_DOUBLE, &gparams->c, 0,
+            "Set wage growth decay rate parameter." },
+        { "a", 'a', POPT_ARG_DOUBLE, &gparams->a, 0,
+            "Set output growth rate parameter." },
+        { "b", 'b', POPT_ARG_DOUBLE, &gparams->b, 0,
+            "Set output depreciation parameter." },
+        { "w0", 'w', POPT_ARG_DOUBLE, &gparams->w0, 0,
+            "Set initial wage share." },
+        { "Y0", 'y', POPT_ARG_DOUBLE, &gparams->Y0, 0,
+            "Set initial output level." },
+        { "Y0", 'Y', POPT_ARG_DOUBLE, &gparams->Y0, 0,
+            "Set initial output level." },
+        { "output", 'o', POPT_ARG_STRING, outfile, 0,
+            "Pandas format CSV file output pathname." },
+        {NULL, 0, 0, NULL, 0, }
+    };
+    int err;
+    const char *arg = NULL;
+    int argcnt = 0;
+
+    optCon = poptGetContext(PROGRAM_NAME, argc, argv, optionsTable, 0);
+    poptReadDefaultConfig(optCon, 0);
+
+    err = poptGetNextOpt(optCon);
+    if (err != -1) {
+        fprintf(stderr, "\t%s: %s\n",
+            poptBadOption(optCon, POPT_BADOPTION_NOALIAS),
+            poptStrerror(err));
+        exit(-1);
+    }
+
+    /* Parse arguments that do not begin with '-' (leftovers) */
+    arg = poptGetArg(optCon);
+    while (arg != NULL) {
+        printf("arg %2d   = %s\n", ++argcnt, arg);
+        arg = poptGetArg(optCon);
+    }
+    poptFreeContext(optCon);
+}
+
+/* Right hand side with the delayed state ylag = y(t-tau). */
+static void ddeFunc( const goodwinParams* p, const double y[], const double ylag[], double f[] )
+{
+    f[0] = -p->c*y[0] + p->r*y[0]*ylag[1];
+    f[1] = p->a*y[1] - p->b*y[0]*y[1];
+}
+
+struct historyNode {
+    double t;
+    double y[2];
+    double f[2];
+};
+
+/* Cubic Hermite interpolation between two nodes at time t. */
+static void hermite( const historyNode& n0, const historyNode& n1, double t, double y[] )
+{
+    double h = n1.t - n0.t;
+    double s = ( t - n0.t ) / h;
+    double s2 = s*s, s3 = s2*s;
+    double h00 = 2*s3 - 3*s2 + 1;
+    double h10 = s3 - 2*s2 + s;
+    double h01 = -2*s3 + 3*s2;
+    double h11 = s3 - s2;
+    for ( int k=0; k < 2; k++ ) {
+        y[k] = h00*n0.y[k] + h10*h*n0.f[k] + h01*n1.y[k] + h11*h*n1.f[k];
+    }
+}
+
+/*
+ Fixed capacity ring buffer of solution nodes, oldest first.  Nodes older
+ than the one needed to interpolate at t-tau are dropped as new ones
+ arrive, so the buffer never holds more than about tau/h + breakpoints.
+*/
+class historyBuffer {
+public:
+    historyBuffer( size_t capacity, const double phi[2] )
+        : nodes_(capacity), head_(0), size_(0)
+    {
+        phi_[0] = phi[0];
+        phi_[1] = phi[1];
+    }
+
+    size_t capacity() const { return nodes_.size(); }
+    size_t size() const { return size_; }
+    const historyNode& back() const { return at( size_-1 ); }
+
+    /* Append a node, evicting nodes that can no longer be reached from tmin. */
+    bool push( const historyNode& n, double tmin )
+    {
+        while ( size_ >= 2 && at(1).t <= tmin ) pop();
+        if ( size_ == nodes_.size() ) return false;
+        nodes_[( head_ + size_ ) % nodes_.size()] = n;
+        size_++;
+        return true;
+    }
+
+    /* State at time t <= back().t; the initial history before the first node. */
+    void eval( double t, double y[] ) const
+    {
+        if ( size_ == 0 || t <= at(0).t ) {
+            if ( size_ > 0 && t == at(0).t ) {
+                y[0] = at(0).y[0];
+                y[1] = at(0).y[1];
+            } else {
+                y[0] = phi_[0];
+                y[1] = phi_[1];
+            }
+            return;
+        }
+        // binary search for the last node with node.t <= t
+        size_t lo = 0, hi = size_-1;
+        while ( hi - lo > 1 ) {
+            size_t mid = ( lo + hi ) / 2;
+            if ( at(mid).t <= t ) lo = mid;
+            else hi = mid;
+        }
+        hermite( at(lo), at(hi), t, y );
+    }
+
+private:
+    const historyNode& at( size_t i ) const { return nodes_[( head_ + i ) % nodes_.size()]; }
+    void pop() { head_ = ( head_ + 1 ) % nodes_.size(); size_--; }
+
+    vector<historyNode> nodes_;
+    size_t head_;
+    size_t size_;
+    double phi_[2];
+};
+
+/* One RK4 step of size h from node n, reading delayed values from hist. */
+static void rk4Step( const ddeParams* dp, const historyBuffer& hist,
+                     const historyNode& n, double h, historyNode* out )
+{
+    const goodwinParams* p = &dp->p;
+    double k2[2], k3[2], k4[2], ytmp[2], ylag[2];
+    double t = n.t;
+
+    for ( int k=0; k < 2; k++ ) ytmp[k] = n.y[k] + 0.5*h*n.f[k];
+    hist.eval( t + 0.5*h - dp->tau, ylag );
+    ddeFunc( p, ytmp, ylag, k2 );
+
+    for ( int k=0; k < 2; k++ ) ytmp[k] = n.y[k] + 0.5*h*k2[k];
+    ddeFunc( p, ytmp, ylag, k3 );
+
+    for ( int k=0; k < 2; k++ ) ytmp[k] = n.y[k] + h*k3[k];
+    hist.eval( t + h - dp->tau, ylag );
+    ddeFunc( p, ytmp, ylag, k4 );
+
+    out->t = t + h;
+    for ( int k=0; k < 2; k++ ) {
+        out->y[k] = n.y[k] + h/6.0*( n.f[k] + 2*k2[k] + 2*k3[k] + k4[k] );
+    }
+    // dy/dt at the new node, FSAL style, for the next step and the interpolant
+    hist.eval( out->t - dp->tau, ylag );
+    ddeFunc( p, out->y, ylag, out->f );
+}
+
+int main ( int argc, const char *argv[] )
+{
+    ddeParams dparams;
+    goodwinParams& params = dparams.p;
+    defaultParams( &params );
+    dparams.tau = 0.5;
+    dparams.h = 1e-3;
+    gridOptions gridOpts;
+    defaultGridOptions( &gridOpts );
+    char * pathname = NULL;
+    parseArguments( argc, argv, &dparams, &gridOpts, &pathname );
+    string outfile = ( pathname != NULL ) ? pathname : "";
+
+    if ( params.Nsteps>NMAX ) {
+        cout << "Nsteps exceeded maximum.  Resetting Nsteps to  NMAX ="<<NMAX<<endl;
+        params.Nsteps = NMAX;
+    } else if (params.Nsteps<1 ) {
+        cout << "Nsteps = "<<params.Nsteps << " less than minimum."
+        << "\nResetting Nsteps to default = 100" << endl;
+        params.Nsteps = 100;
+    }
+    timeGrid grid;
+    string gridErr;
+    if ( !makeTimeGrid( gridOpts, params.Nsteps, &grid, &gridErr ) ) {
+        fprintf(stderr,"\tgrid: %s\n",gridErr.c_str());
+        exit(-1);
+    }
+    if ( grid.size() >= NMAX ) {
+        fprintf(stderr,"\tgrid: %ld outputs exceeds maximum %d\n",grid.size(),NMAX);
+        exit(-1);
+    }
+    params.Nsteps = grid.size();
+    if ( !( dparams.tau > 0.0 ) || !( dparams.h > 0.0 ) ) {
+        fprintf(stderr, "\ttau and h must both be positive\n");
+        exit(-1);
+    }
+    if ( dparams.h > dparams.tau ) {
+        cout << "h = " << dparams.h << " exceeds tau.  Resetting h to tau = " << dparams.tau << endl;
+        dparams.h = dparams.tau;
+    }
+
+    double t0 = grid.tStart;
+    double tend = grid.end();
+    // breakpoints t0 + k*tau still visible to a method of order DDE_ORDER
+    vector<double> breaks;
+    for ( int k=1; k <= DDE_ORDER && t0 + k*dparams.tau < tend; k++ ) breaks.push_back( t0 + k*dparams.tau );
+
+    // each delay interval holds tau/h nodes, plus one per shortened step
+    size_t capacity = (size_t)ceil( dparams.tau / dparams.h ) + DDE_ORDER + 4;
+    double phi[2] = { params.w0, params.Y0 };
+    historyBuffer hist( capacity, phi );
+    historyNode node;
+    node.t = t0;
+    node.y[0] = params.w0;
+    node.y[1] = params.Y0;
+    ddeFunc( &params, node.y, phi, node.f );
+    hist.push( node, t0 - dparams.tau );
+
+    // File output set-up
+    time_t sysTime = time(0);
+    char chTime[80];
+    strftime(chTime,79,"%Y-%m-%d",localtime(&sysTime));
+    string csvfile = strformat("./sim_data/%s_v%d_N%d_%s.pd",PROGRAM_NAME,
+            VERSION,params.Nsteps,chTime);
+    if ( outfile.empty() ) {
+        cout<<"Using default output pathname: '"<< csvfile <<"'"<< endl;
+    } else {
+        csvfile = outfile;
+        cout << "Using outfile pathname set by user: '"<< csvfile <<"'" <<endl;
+    }
+    fs::path dname = fs::path( csvfile ).parent_path();
+    struct stat info;
+    if ( !dname.empty() && stat( dname.c_str(), &info ) != 0 ) {
+        printf(" dir path '%s' does not exist, so\n",dname.c_str());
+        printf(" we will now create this directory for you.\n");
+        int status = mkdir(dname.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+        if ( status == -1 ) printf("Could not mkdir for '%s'\n",dname.c_str());
+    }
+    ofstream pdout;
+    pdout.open(csvfile);
+    pdout << "# Goodwin model delay-differential data output." << endl;
+    pdout << "# r="<< params.r << " , c=" << params.c
+       << " , a=" << params.a << " , b=" << params.b
+       << " , w0="<< params.w0 << " , Y0=" << params.Y0
+       << " , tau=" << dparams.tau << " , h=" << dparams.h
+       << " , Nsteps=" << params.Nsteps << endl;
+    if ( !isDefaultGrid( gridOpts ) ) pdout << gridHeader( grid );
+    // NB: no whitespace in the column names if we want Pandas dataframe format
+    pdout << "time,wages,output" << endl;
+
+    size_t ibreak = 0;
+    int i = 1;
+    long nsteps = 0;
+    while ( i <= params.Nsteps ) {
+        double h = dparams.h;
+        if ( ibreak < breaks.size() && node.t + h >= breaks[ibreak] - 1e-12*h ) {
+            h = breaks[ibreak] - node.t;
+            ibreak++;
+        }
+        historyNode next;
+        rk4Step( &dparams, hist, node, h, &next );
+        if ( !isfinite( next.y[0] ) || !isfinite( next.y[1] ) ) {
+            printf ("error, solution diverged at t = %g\n", next.t);
+            break;
+        }
+        // samples falling in [node.t, next.t] come from the step's interpolant
+        double ti = grid.time( i );
+        while ( i <= params.Nsteps && ti <= next.t ) {
+            double y[2];
+            hermite( node, next, ti, y );
+            pdout << setw(12) << fixed << ti << "," << setw(12)
+               <<  y[0] << "," << setw(12) << y[1] << endl;
+            i++;
+            ti = grid.time( i );
+        }
+        if ( !hist.push( next, next.t - dparams.tau ) ) {
+            printf ("error, history buffer overflow at t = %g\n", next.t);
+            break;
+        }
+        node = next;
+        nsteps++;
+    }
+    pdout.close();
+    cout << "Took " << nsteps << " steps, history buffer of " << hist.capacity()
+         << " nodes (" << hist.capacity() * sizeof(historyNode) << " bytes)" << endl;
+    cout<< "Done.  See output in "<< csvfile <<endl;
+    return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ Mixed precision ensemble integration: a batch of goodwin trajectories
+ stepped in lockstep in float, with a float64 shadow to say which ones
+ can be trusted.
+
+ laneEnsemble holds the batch as structure of arrays, one lane per
+ trajectory, and takes fixed RK4 steps of ENSEMBLE_DT in float across all
+ lanes at once: the lane loops have no branches, so the compiler
+ vectorises them, and a float vector holds twice the lanes of a double
+ one.  Every shadowEvery steps the step is shadowed in double: from the
+ same states, promoted, two RK4 half steps.  Their difference from the
+ float step is the float step's rounding plus its truncation error, and
+ shadowEvery times it is added to the lane's running error estimate, in
+ units of 1 + |y| per component.  Lanes whose estimate passes tol, or
+ whose state stops being finite, are marked suspect; goodwin_mc reruns
+ them with the float64 solver.
+
+ A local error does not stay its own size: it moves the lane to a
+ neighbouring closed orbit of a slightly different period, and the phase
+ difference grows along the run.  So an error made at t_j counts
+ 1 + (t - t_j) / tau times at t, with tau = 2 pi / sqrt(ac) the period of
+ the small oscillations.  Against float64 runs at a hundredth of the
+ step, over t = 100 from w0 = 1.2 .. 3.3, this overestimates the largest
+ error by 5 to 70 times, where the plain sum of the local errors fell
+ short by up to 2 times.
+*/
+
+#ifndef GOODWIN_ENSEMBLE_H
+#define GOODWIN_ENSEMBLE_H
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "goodwin.h"
+
+static const double ENSEMBLE_DT = 0.01;    // fixed step of the float lanes
+
+/* One RK4 step of h for lanes [0, n) of the model, in Real. */
+template <class Real>
+inline void rk4Lanes( int n, Real h, Real* __restrict w, Real* __restrict Y,
+                      const Real* __restrict r, const Real* __restrict c,
+                      const Real* __restrict a, const Real* __restrict b )
+{
+    const Real half = h / 2, sixth = h / 6;
+    for ( int k=0; k < n; k++ ) {
+        Real w0 = w[k], Y0 = Y[k];
+        Real fw1 = w0*( r[k]*Y0 - c[k] ), fY1 = Y0*( a[k] - b[k]*w0 );
+        Real w1 = w0 + half*fw1, Y1 = Y0 + half*fY1;
+        Real fw2 = w1*( r[k]*Y1 - c[k] ), fY2 = Y1*( a[k] - b[k]*w1 );
+        Real w2 = w0 + half*fw2, Y2 = Y0 + half*fY2;
+        Real fw3 = w2*( r[k]*Y2 - c[k] ), fY3 = Y2*( a[k] - b[k]*w2 );
+        Real w3 = w0 + h*fw3, Y3 = Y0 + h*fY3;
+        Real fw4 = w3*( r[k]*Y3 - c[k] ), fY4 = Y3*( a[k] - b[k]*w3 );
+        w[k] = w0 + sixth*( fw1 + 2*fw2 + 2*fw3 + fw4 );
+        Y[k] = Y0 + sixth*( fY1 + 2*fY2 + 2*fY3 + fY4 );
+    }
+}
+
+class laneEnsemble {
+public:
+    laneEnsemble( double tol, int shadowEvery ) : tol_( tol ), shadowEvery_( std::max( 1, shadowEvery ) ) {}
+
+    /*
+     Integrate lanes p[0 .. n) from their initial states through Nt
+     outputs every outDt, into traj[k*Nt*2 + 2*(i-1) + {0,1}] as
+     goodwin_mc lays them out, and set suspect[k] for the lanes to rerun.
+     The model is autonomous, so where the grid starts does not matter.
+    */
+    void run( const goodwinParams* p, int n, int Nt, double outDt, double* traj, char* suspect )
+    {
+        resize( n );
+        for ( int k=0; k < n; k++ ) {
+            w_[k] = (float)p[k].w0;
+            Y_[k] = (float)p[k].Y0;
+            r_[k] = (float)p[k].r;
+            c_[k] = (float)p[k].c;
+            a_[k] = (float)p[k].a;
+            b_[k] = (float)p[k].b;
+            rd_[k] = p[k].r;
+            cd_[k] = p[k].c;
+            ad_[k] = p[k].a;
+            bd_[k] = p[k].b;
+            err_[k] = 0.0;
+            errT_[k] = 0.0;
+        }
+        int sub = std::max( 1, (int)ceil( outDt / ENSEMBLE_DT - 1e-9 ) );
+        float h = (float)( outDt / sub );
+        long step = 0;
+        for ( int i=1; i <= Nt; i++ ) {
+            for ( int s=0; s < sub; s++, step++ ) {
+                if ( step % shadowEvery_ == 0 ) shadowStep( n, (double)h, step * (double)h );
+                else rk4Lanes<float>( n, h, w_.data(), Y_.data(), r_.data(), c_.data(), a_.data(), b_.data() );
+            }
+            for ( int k=0; k < n; k++ ) {
+                double* row = &traj[(size_t)k * Nt * 2];
+                row[2*(i-1)] = w_[k];
+                row[2*(i-1)+1] = Y_[k];
+            }
+        }
+        suspects_ = 0;
+        double tEnd = Nt * outDt;
+        for ( int k=0; k < n; k++ ) {
+            // an error made at t_j has sheared along the orbit for tEnd - t_j
+            double tau = 2.0*M_PI / sqrt( ad_[k] * cd_[k] );
+            err_[k] = err_[k] * ( 1.0 + tEnd / tau ) - errT_[k] / tau;
+            suspect[k] = !( err_[k] <= tol_ ) || !std::isfinite( w_[k] + Y_[k] );
+            suspects_ += suspect[k];
+        }
+    }
+
+    int suspects() const { return suspects_; }
+    /* the error estimate of lane k after run() */
+    double error( int k ) const { return err_[k]; }
+
+private:
+    double tol_;
+    int shadowEvery_;
+    int suspects_;
+    std::vector<float> w_, Y_, r_, c_, a_, b_;
+    std::vector<double> wd_, Yd_, rd_, cd_, ad_, bd_, err_, errT_;
+
+    void resize( int n )
+    {
+        for ( auto v : { &w_, &Y_, &r_, &c_, &a_, &b_ } ) v->resize( n );
+        for ( auto v : { &wd_, &Yd_, &rd_, &cd_, &ad_, &bd_, &err_, &errT_ } ) v->resize( n );
+    }
+
+    /* the float step, checked against two double half steps from the same states */
+    void shadowStep( int n, double h, double t )
+    {
+        for ( int k=0; k < n; k++ ) {
+            wd_[k] = w_[k];
+            Yd_[k] = Y_[k];
+        }
+        rk4Lanes<float>( n, (float)h, w_.data(), Y_.data(), r_.data(), c_.data(), a_.data(), b_.data() );
+        for ( int half=0; half < 2; half++ ) {
+            rk4Lanes<double>( n, h / 2, wd_.data(), Yd_.data(), rd_.data(), cd_.data(), ad_.data(), bd_.data() );
+        }
+        for ( int k=0; k < n; k++ ) {
+            double e = std::max( fabs( w_[k] - wd_[k] ) / ( 1.0 + fabs( wd_[k] ) ),
+                                 fabs( Y_[k] - Yd_[k] ) / ( 1.0 + fabs( Yd_[k] ) ) );
+            err_[k] += shadowEvery_ * e;
+            errT_[k] += shadowEvery_ * e * t;
+        }
+    }
+};
+
+#endif /* GOODWIN_ENSEMBLE_H */
@@ -0,0 +1,186 @@
+/*
+ Trajectory fate classification, for stopping a run as soon as its
+ long-time behaviour is known.
+
+ fateClassifier is fed the state y and slope f = y' at each sample of a
+ trajectory and decides between
+   converged   |f| <= steadyTol (1 + |y|): a steady state
+   periodic    two successive returns to the section "w at a maximum"
+               agree to cycleTol (1 + |y|): a closed orbit or limit cycle
+   diverged    a non-finite state, or |y| > bound
+ and unresolved otherwise.  The section crossing and the extrema of each
+ component are placed between samples by cubic Hermite interpolation of
+ (y, f) at the two ends, so they are good to O(dt^4) and the samples can
+ be far coarser than the solver's steps.  Once periodic, period() is the
+ time between the last two returns and amplitude() the max - min of each
+ component over that cycle.
+*/
+
+#ifndef GOODWIN_FATE_H
+#define GOODWIN_FATE_H
+
+#include <cmath>
+#include <algorithm>
+
+enum fateKind { FATE_UNRESOLVED, FATE_CONVERGED, FATE_PERIODIC, FATE_DIVERGED };
+
+inline const char* fateName( fateKind f )
+{
+    switch ( f ) {
+        case FATE_CONVERGED: return "converged";
+        case FATE_PERIODIC: return "periodic";
+        case FATE_DIVERGED: return "diverged";
+        default: return "unresolved";
+    }
+}
+
+struct fateOptions {
+    double bound;       // |y| beyond this has diverged
+    double steadyTol;   // |f| below this, relative, has converged
+    double cycleTol;    // section returns closer than this, relative, are periodic
+};
+
+inline void defaultFateOptions( fateOptions* o )
+{
+    o->bound = 1e6;
+    o->steadyTol = 1e-8;
+    o->cycleTol = 1e-5;
+}
+
+/*
+ Where the cubic Hermite interpolant of (y0, f0) at s = 0 and (y1, f1) at
+ s = 1, over a step of h, has zero slope: the root in [0, 1] of its
+ derivative, which f0 and f1 of opposite sign guarantee.
+*/
+inline double hermiteExtremum( double y0, double f0, double y1, double f1, double h )
+{
+    double A = 6.0*( y0 - y1 ) + 3.0*h*( f0 + f1 );
+    double B = 6.0*( y1 - y0 ) - h*( 4.0*f0 + 2.0*f1 );
+    double C = h*f0;
+    double s = f0 / ( f0 - f1 );    // linear fallback
+    if ( fabs( A ) > 1e-14 * ( fabs( B ) + fabs( C ) ) ) {
+        double d = B*B - 4.0*A*C;
+        if ( d >= 0.0 ) {
+            double q = -0.5 * ( B + copysign( sqrt( d ), B ) );
+            double r1 = q / A, r2 = ( q != 0.0 ) ? C / q : r1;
+            if ( r1 >= 0.0 && r1 <= 1.0 ) s = r1;
+            else if ( r2 >= 0.0 && r2 <= 1.0 ) s = r2;
+        }
+    } else if ( B != 0.0 ) {
+        double r = -C / B;
+        if ( r >= 0.0 && r <= 1.0 ) s = r;
+    }
+    return s;
+}
+
+inline double hermiteValue( double y0, double f0, double y1, double f1, double h, double s )
+{
+    double s2 = s*s, s3 = s2*s;
+    return ( 2*s3 - 3*s2 + 1 )*y0 + ( s3 - 2*s2 + s )*h*f0 + ( -2*s3 + 3*s2 )*y1 + ( s3 - s2 )*h*f1;
+}
+
+class fateClassifier {
+public:
+    explicit fateClassifier( const fateOptions& o ) : o_( o ) {}
+
+    void start( double t, const double y[2], const double f[2] )
+    {
+        fate_ = FATE_UNRESOLVED;
+        returns_ = 0;
+        period_ = 0.0;
+        for ( int k=0; k < 2; k++ ) {
+            lo_[k] = hi_[k] = y[k];
+            amp_[k] = 0.0;
+        }
+        save( t, y, f );
+    }
+
+    /* Add the next sample; true once the fate is decided. */
+    bool push( double t, const double y[2], const double f[2] )
+    {
+        if ( fate_ != FATE_UNRESOLVED ) return true;
+        double ynorm = std::max( fabs( y[0] ), fabs( y[1] ) );
+        if ( !std::isfinite( y[0] ) || !std::isfinite( y[1] ) || ynorm > o_.bound ) {
+            fate_ = FATE_DIVERGED;
+            return true;
+        }
+        if ( std::max( fabs( f[0] ), fabs( f[1] ) ) <= o_.steadyTol * ( 1.0 + ynorm ) ) {
+            fate_ = FATE_CONVERGED;
+            return true;
+        }
+        double h = t - t_;
+        double ws = 0.0, Ys = 0.0, ts = 0.0;
+        bool section = false;
+        for ( int k=0; k < 2; k++ ) {
+            lo_[k] = std::min( lo_[k], y[k] );
+            hi_[k] = std::max( hi_[k], y[k] );
+            if ( ( f_[k] > 0.0 ) == ( f[k] > 0.0 ) ) continue;
+            double s = hermiteExtremum( y_[k], f_[k], y[k], f[k], h );
+            double e = hermiteValue( y_[k], f_[k], y[k], f[k], h, s );
+            lo_[k] = std::min( lo_[k], e );
+            hi_[k] = std::max( hi_[k], e );
+            if ( k == 0 && f_[0] > 0.0 ) {
+                section = true;
+                ts = t_ + s*h;
+                ws = e;
+                Ys = hermiteValue( y_[1], f_[1], y[1], f[1], h, s );
+            }
+        }
+        if ( section ) {
+            crossSection( ts, ws, Ys );
+            for ( int k=0; k < 2; k++ ) {
+                lo_[k] = std::min( lo_[k], y[k] );
+                hi_[k] = std::max( hi_[k], y[k] );
+            }
+        }
+        save( t, y, f );
+        return fate_ != FATE_UNRESOLVED;
+    }
+
+    fateKind fate() const { return fate_; }
+    double period() const { return period_; }
+    const double* amplitude() const { return amp_; }
+    /* the state at the last return to the section, and when */
+    double sectionTime() const { return tsec_; }
+    const double* sectionState() const { return ysec_; }
+
+private:
+    fateOptions o_;
+    fateKind fate_;
+    double t_, y_[2], f_[2];    // previous sample
+    double lo_[2], hi_[2];      // extrema since the last return
+    int returns_;
+    double tsec_, ysec_[2];     // last return
+    double period_, amp_[2];
+
+    void save( double t, const double y[2], const double f[2] )
+    {
+        t_ = t;
+        for ( int k=0; k < 2; k++ ) {
+            y_[k] = y[k];
+            f_[k] = f[k];
+        }
+    }
+
+    void crossSection( double ts, double ws, double Ys )
+    {
+        if ( returns_ > 0 ) {
+            period_ = ts - tsec_;
+            amp_[0] = hi_[0] - lo_[0];
+            amp_[1] = hi_[1] - lo_[1];
+            if ( fabs( ws - ysec_[0] ) <= o_.cycleTol * ( 1.0 + fabs( ws ) )
+                 && fabs( Ys - ysec_[1] ) <= o_.cycleTol * ( 1.0 + fabs( Ys ) ) ) {
+                fate_ = FATE_PERIODIC;
+            }
+        }
+        returns_++;
+        tsec_ = ts;
+        ysec_[0] = ws;
+        ysec_[1] = Ys;
+        // the next cycle's extrema start from this one's maximum of w
+        lo_[0] = hi_[0] = ws;
+        lo_[1] = hi_[1] = Ys;
+    }
+};
+
+#endif /* GOODWIN_FATE_H */
@@ -0,0 +1,381 @@
+/*
+ Goodwin vector field and nullclines on a (w, Y) grid, for phase portraits.
+
+ g++ -Wall -O3 -pthread -I/usr/include/ -c goodwin_field.cpp &&
+ g++ -pthread goodwin_field.o -lpopt -lstdc++fs -o goodwin_field
+
+ Evaluates the right hand side of func() at every point of an nw x nY grid
+ over [w-min, w-max] x [Y-min, Y-max], and with --eigen the eigenvalues of
+ the Jacobian jac() there.  Rows of the grid are dealt to --threads
+ workers, and each row is one branch-free loop over w with the model
+ written inline, as in goodwin_sde's stepBlock, so it vectorizes at -O3.
+
+ Writes, for output prefix P, numpy arrays of shape (nY, nw), row j at
+ Y-min + j dY (imshow(..., origin='lower') puts them the right way up):
+   P_dw.npy    float32  dw/dt
+   P_dY.npy    float32  dY/dt
+   P_eig.npy   complex64, shape (nY, nw, 2), larger real part first
+ and P_nullclines.pd, the zero contours of dw/dt and dY/dt traced by
+ marching squares and joined into polylines: one row per vertex, with
+ columns field (w or Y), line and the point, and the grid in the header.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <unordered_map>
+
+#include <popt.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <experimental/filesystem>
+
+#include "goodwin.h"
+
+namespace fs = std::experimental::filesystem;
+
+using namespace std;
+
+#define PROGRAM_NAME "goodwin_field"
+#define VERSION 1
+
+static const int FIELD_ROWS_PER_TASK = 16;
+
+struct fieldOptions {
+    double wmin, wmax;  // NAN: 0 and twice the equilibrium
+    double Ymin, Ymax;
+    int nw, nY;
+    int eigen;
+    int threads;
+};
+
+static void parseArguments( int argc, const char **argv, goodwinParams* gparams,
+                            fieldOptions* opts, char ** outfile )
+{
+    poptContext optCon;
+    const struct poptOption optionsTable[] = {
+        POPT_AUTOHELP
+        { "r", 'r', POPT_ARG_DOUBLE, &gparams->r, 0,
+            "Set wage appreciation parameter." },
+        { "c", 'c', POPT_ARG_DOUBLE, &gparams->c, 0,
+            "Set wage growth decay rate parameter." },
+        { "a", 'a', POPT_ARG_DOUBLE, &gparams->a, 0,
+            "Set output growth rate parameter." },
+        { "b", 'b', POPT_ARG_DOUBLE, &gparams->b, 0,
+            "Set output depreciation parameter." },
+        { "w-min", 0, POPT_ARG_DOUBLE, &opts->wmin, 0,
+            "Set smallest wage share on the grid (default 0)." },
+        { "w-max", 0, POPT_ARG_DOUBLE, &opts->wmax, 0,
+            "Set largest wage share on the grid (default 2a/b)." },
+        { "Y-min", 0, POPT_ARG_DOUBLE, &opts->Ymin, 0,
+            "Set smallest output on the grid (default 0)." },
+        { "Y-max", 0, POPT_ARG_DOUBLE, &opts->Ymax, 0,
+            "Set largest output on the grid (default 2c/r)." },
+        { "nw", 0, POPT_ARG_INT, &opts->nw, 0,
+            "Set grid points along w (default 1024)." },
+        { "nY", 0, POPT_ARG_INT, &opts->nY, 0,
+            "Set grid points along Y (default 1024)." },
+        { "eigen", 'e', POPT_ARG_NONE, &opts->eigen, 0,
+            "Also write the Jacobian eigenvalues at each grid point." },
+        { "threads", 't', POPT_ARG_INT, &opts->threads, 0,
+            "Set number of worker threads (default: all cores)." },
+        { "output", 'o', POPT_ARG_STRING, outfile, 0,
+            "Output pathname prefix for the .npy arrays and nullcline .pd file." },
+        {NULL, 0, 0, NULL, 0, }
+    };
+    optCon = poptGetContext(PROGRAM_NAME, argc, argv, optionsTable, 0);
+    poptReadDefaultConfig(optCon, 0);
+    int err = poptGetNextOpt(optCon);
+    if (err != -1) {
+        fprintf(stderr, "\t%s: %s\n",
+            poptBadOption(optCon, POPT_BADOPTION_NOALIAS),
+            poptStrerror(err));
+        exit(-1);
+    }
+    poptFreeContext(optCon);
+}
+
+struct fieldGrid {
+    goodwinParams p;
+    double wmin, Ymin, hw, hY;   // point (i, j) is ( wmin + i hw, Ymin + j hY )
+    long nw, nY;
+};
+
+/*
+ Row j of the field: f of func() and, if eig is not NULL, the eigenvalues
+ of jac()'s matrix [[ -c + rY, rw ], [ -bY, a - bw ]] as (re, im) pairs.
+*/
+static void fieldRow( const fieldGrid& g, long j, float* __restrict fw, float* __restrict fY,
+                      float* __restrict eig )
+{
+    const double r = g.p.r, c = g.p.c, a = g.p.a, b = g.p.b;
+    const double Y = g.Ymin + j * g.hY;
+    const long n = g.nw;
+    for ( long i=0; i < n; i++ ) {
+        double w = g.wmin + i * g.hw;
+        fw[i] = (float)( -c*w + r*w*Y );
+        fY[i] = (float)( a*Y - b*w*Y );
+    }
+    if ( eig == NULL ) return;
+    for ( long i=0; i < n; i++ ) {
+        double w = g.wmin + i * g.hw;
+        double j00 = -c + r*Y, j01 = r*w, j10 = -b*Y, j11 = a - b*w;
+        double h = 0.5 * ( j00 + j11 );
+        double disc = h*h - ( j00*j11 - j01*j10 );
+        double s = sqrt( fabs( disc ) );
+        double re = ( disc >= 0.0 ) ? s : 0.0;
+        double im = ( disc >= 0.0 ) ? 0.0 : s;
+        eig[4*i] = (float)( h + re );
+        eig[4*i+1] = (float)im;
+        eig[4*i+2] = (float)( h - re );
+        eig[4*i+3] = (float)( -im );
+    }
+}
+
+/* numpy .npy (format 1.0) of a C-ordered array */
+static bool writeNpy( const string& path, const char* descr, const vector<long>& shape,
+                      const void* data, size_t bytes )
+{
+    string dims;
+    for ( long d : shape ) dims += strformat( "%ld, ", d );
+    if ( shape.size() > 1 ) dims.resize( dims.size() - 2 );
+    string h = strformat( "{'descr': '%s', 'fortran_order': False, 'shape': (%s), }", descr, dims.c_str() );
+    size_t total = ( ( 10 + h.size() + 1 + 63 ) / 64 ) * 64;
+    h.append( total - 10 - h.size() - 1, ' ' );
+    h += '\n';
+    FILE * f = fopen( path.c_str(), "wb" );
+    if ( f == NULL ) return false;
+    unsigned char pre[10] = { 0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0,
+                              (unsigned char)( h.size() & 0xff ), (unsigned char)( h.size() >> 8 ) };
+    bool ok = fwrite( pre, 1, 10, f ) == 10 && fwrite( h.data(), 1, h.size(), f ) == h.size()
+              && fwrite( data, 1, bytes, f ) == bytes;
+    return ( fclose( f ) == 0 ) && ok;
+}
+
+/*
+ Zero contour of v (nY x nw) by marching squares.  Crossing points live on
+ grid edges, numbered 2 (j nw + i) for the edge from (i, j) to (i+1, j) and
+ 2 (j nw + i) + 1 for the one to (i, j+1); a contour segment joins two of
+ them.  Cells are scanned in parallel, then the segments are chained into
+ polylines through their shared edges.  A point counts as inside when
+ v > 0, so contours along rows or columns of exact zeros are traced on
+ their positive side.
+*/
+typedef pair<long,long> edgeSegment;
+
+static void contourRows( const float* v, long nw, long j0, long j1, vector<edgeSegment>* segs )
+{
+    for ( long j=j0; j < j1; j++ ) {
+        const float* lo = v + j * nw;
+        const float* hi = lo + nw;
+        for ( long i=0; i + 1 < nw; i++ ) {
+            int cs = ( lo[i] > 0 ) | ( ( lo[i+1] > 0 ) << 1 ) | ( ( hi[i+1] > 0 ) << 2 ) | ( ( hi[i] > 0 ) << 3 );
+            if ( cs == 0 || cs == 15 ) continue;
+            long bottom = 2 * ( j * nw + i ), top = 2 * ( ( j+1 ) * nw + i );
+            long left = bottom + 1, right = 2 * ( j * nw + i + 1 ) + 1;
+            switch ( cs ) {
+                case 1: case 14: segs->push_back( edgeSegment( left, bottom ) ); break;
+                case 2: case 13: segs->push_back( edgeSegment( bottom, right ) ); break;
+                case 3: case 12: segs->push_back( edgeSegment( left, right ) ); break;
+                case 4: case 11: segs->push_back( edgeSegment( right, top ) ); break;
+                case 6: case 9: segs->push_back( edgeSegment( bottom, top ) ); break;
+                case 7: case 8: segs->push_back( edgeSegment( left, top ) ); break;
+                case 5:     // saddle: resolve by the cell centre
+                case 10: {
+                    bool centre = ( lo[i] + lo[i+1] + hi[i] + hi[i+1] > 0 ) == ( cs == 5 );
+                    if ( centre ) {
+                        segs->push_back( edgeSegment( left, top ) );
+                        segs->push_back( edgeSegment( bottom, right ) );
+                    } else {
+                        segs->push_back( edgeSegment( left, bottom ) );
+                        segs->push_back( edgeSegment( right, top ) );
+                    }
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/* Chain segments into polylines of edge ids; open lines first, then closed loops. */
+static void chainSegments( const vector<edgeSegment>& segs, vector< vector<long> >* lines )
+{
+    unordered_map< long, vector<long> > adj;
+    adj.reserve( 2 * segs.size() );
+    for ( const edgeSegment& s : segs ) {
+        adj[s.first].push_back( s.second );
+        adj[s.second].push_back( s.first );
+    }
+    unordered_map<long,bool> used;
+    auto walk = [&]( long start ) {
+        vector<long> line( 1, start );
+        used[start] = true;
+        long cur = start;
+        for ( ;; ) {
+            long next = -1;
+            for ( long nb : adj[cur] ) if ( !used[nb] ) { next = nb; break; }
+            if ( next < 0 ) break;
+            used[next] = true;
+            line.push_back( next );
+            cur = next;
+        }
+        // close loops
+        if ( line.size() > 2 && adj[start].size() == 2 && adj[cur].size() == 2 ) {
+            for ( long nb : adj[cur] ) if ( nb == start ) line.push_back( start );
+        }
+        lines->push_back( line );
+    };
+    for ( auto& kv : adj ) if ( kv.second.size() == 1 && !used[kv.first] ) walk( kv.first );
+    for ( auto& kv : adj ) if ( !used[kv.first] ) walk( kv.first );
+}
+
+/* (w, Y) of the zero crossing on edge e, by linear interpolation of v */
+static void edgePoint( const fieldGrid& g, const float* v, long e, double* w, double* Y )
+{
+    long k = e / 2, i = k % g.nw, j = k / g.nw;
+    long k2 = ( e % 2 == 0 ) ? k + 1 : k + g.nw;
+    double v0 = v[k], v1 = v[k2];
+    double s = ( v0 != v1 ) ? v0 / ( v0 - v1 ) : 0.5;
+    *w = g.wmin + ( i + ( e % 2 == 0 ? s : 0.0 ) ) * g.hw;
+    *Y = g.Ymin + ( j + ( e % 2 == 0 ? 0.0 : s ) ) * g.hY;
+}
+
+int main ( int argc, const char *argv[] )
+{
+    goodwinParams params;
+    defaultParams( &params );
+    fieldOptions opts = { NAN, NAN, NAN, NAN, 1024, 1024, 0, 0 };
+    char * pathname = NULL;
+    parseArguments( argc, argv, &params, &opts, &pathname );
+    string outfile = ( pathname != NULL ) ? pathname : "";
+    free( pathname );
+    if ( opts.nw < 2 || opts.nY < 2 ) {
+        fprintf(stderr,"\tnw and nY must be at least 2\n");
+        exit(-1);
+    }
+    fieldGrid g;
+    g.p = params;
+    g.nw = opts.nw;
+    g.nY = opts.nY;
+    double wmax = std::isnan( opts.wmax ) ? 2.0 * params.a / params.b : opts.wmax;
+    double Ymax = std::isnan( opts.Ymax ) ? 2.0 * params.c / params.r : opts.Ymax;
+    g.wmin = std::isnan( opts.wmin ) ? 0.0 : opts.wmin;
+    g.Ymin = std::isnan( opts.Ymin ) ? 0.0 : opts.Ymin;
+    if ( !( wmax > g.wmin ) || !( Ymax > g.Ymin ) ) {
+        fprintf(stderr,"\tgrid ranges must have max > min\n");
+        exit(-1);
+    }
+    g.hw = ( wmax - g.wmin ) / ( g.nw - 1 );
+    g.hY = ( Ymax - g.Ymin ) / ( g.nY - 1 );
+    int nthreads = ( opts.threads > 0 ) ? opts.threads : max( 1u, thread::hardware_concurrency() );
+
+    size_t npts = (size_t)g.nw * g.nY;
+    vector<float> fw( npts ), fY( npts ), eig( opts.eigen ? 4 * npts : 0 );
+    vector< vector<edgeSegment> > segW( nthreads ), segY( nthreads );
+    auto start = chrono::steady_clock::now();
+    // rows go out in tasks of FIELD_ROWS_PER_TASK; contours need the row above, so they run after
+    atomic<long> nextRow( 0 );
+    auto evalWorker = [&]() {
+        long j0;
+        while ( ( j0 = nextRow.fetch_add( FIELD_ROWS_PER_TASK ) ) < g.nY ) {
+            long j1 = min( j0 + FIELD_ROWS_PER_TASK, g.nY );
+            for ( long j=j0; j < j1; j++ ) {
+                fieldRow( g, j, &fw[j * g.nw], &fY[j * g.nw], opts.eigen ? &eig[4 * j * g.nw] : NULL );
+            }
+        }
+    };
+    atomic<long> nextCell( 0 );
+    auto contourWorker = [&]( int id ) {
+        long j0;
+        while ( ( j0 = nextCell.fetch_add( FIELD_ROWS_PER_TASK ) ) < g.nY - 1 ) {
+            long j1 = min( j0 + FIELD_ROWS_PER_TASK, g.nY - 1 );
+            contourRows( fw.data(), g.nw, j0, j1, &segW[id] );
+            contourRows( fY.data(), g.nw, j0, j1, &segY[id] );
+        }
+    };
+    vector<thread> workers;
+    for ( int id=0; id < nthreads; id++ ) workers.push_back( thread( evalWorker ) );
+    for ( thread& th : workers ) th.join();
+    double evalSecs = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+    workers.clear();
+    for ( int id=0; id < nthreads; id++ ) workers.push_back( thread( contourWorker, id ) );
+    for ( thread& th : workers ) th.join();
+    vector<edgeSegment> allW, allY;
+    for ( int id=0; id < nthreads; id++ ) {
+        allW.insert( allW.end(), segW[id].begin(), segW[id].end() );
+        allY.insert( allY.end(), segY[id].begin(), segY[id].end() );
+    }
+    vector< vector<long> > linesW, linesY;
+    chainSegments( allW, &linesW );
+    chainSegments( allY, &linesY );
+    double secs = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+    cout << "Evaluated " << g.nw << " x " << g.nY << " grid" << ( opts.eigen ? " with eigenvalues" : "" )
+         << " in " << evalSecs << " s on " << nthreads << " threads, nullclines in "
+         << secs - evalSecs << " s (" << linesW.size() << " w and " << linesY.size() << " Y lines)" << endl;
+
+    time_t sysTime = time(0);
+    char chTime[80];
+    strftime(chTime,79,"%Y-%m-%d",localtime(&sysTime));
+    string prefix = strformat("./sim_data/%s_v%d_%s",PROGRAM_NAME,VERSION,chTime);
+    if ( outfile.empty() ) {
+        cout<<"Using default output prefix: '"<< prefix <<"'"<< endl;
+    } else {
+        prefix = outfile;
+        cout << "Using output prefix set by user: '"<< prefix <<"'" <<endl;
+    }
+    fs::path dname = fs::path( prefix ).parent_path();
+    struct stat info;
+    if ( !dname.empty() && stat( dname.c_str(), &info ) != 0 ) {
+        printf(" dir path '%s' does not exist, so\n",dname.c_str());
+        printf(" we will now create this directory for you.\n");
+        int status = mkdir(dname.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+        if ( status == -1 ) printf("Could not mkdir for '%s'\n",dname.c_str());
+    }
+    vector<long> shape = { g.nY, g.nw };
+    bool ok = writeNpy( prefix + "_dw.npy", "<f4", shape, fw.data(), npts * sizeof(float) )
+              && writeNpy( prefix + "_dY.npy", "<f4", shape, fY.data(), npts * sizeof(float) );
+    if ( ok && opts.eigen ) {
+        ok = writeNpy( prefix + "_eig.npy", "<c8", { g.nY, g.nw, 2 }, eig.data(), eig.size() * sizeof(float) );
+    }
+    if ( !ok ) {
+        printf("Could not write arrays to '%s_*.npy'\n",prefix.c_str());
+        return -1;
+    }
+
+    string ncfile = prefix + "_nullclines.pd";
+    ofstream pdout( ncfile );
+    if ( !pdout ) {
+        printf("Could not open '%s' for writing\n",ncfile.c_str());
+        return -1;
+    }
+    pdout << "# Goodwin model nullclines: zero contours of dw/dt (field w) and dY/dt (field Y)." << endl;
+    pdout << "# r="<< params.r << " , c=" << params.c
+       << " , a=" << params.a << " , b=" << params.b << endl;
+    pdout << "# w=" << g.wmin << ":" << wmax << ":" << g.nw
+       << " , Y=" << g.Ymin << ":" << Ymax << ":" << g.nY << endl;
+    pdout << "field,line,wages,output" << endl;
+    pdout << setprecision(8);
+    const char* names[2] = { "w", "Y" };
+    const vector< vector<long> >* lines[2] = { &linesW, &linesY };
+    const float* fields[2] = { fw.data(), fY.data() };
+    for ( int f=0; f < 2; f++ ) {
+        for ( size_t l=0; l < lines[f]->size(); l++ ) {
+            for ( long e : (*lines[f])[l] ) {
+                double w, Y;
+                edgePoint( g, fields[f], e, &w, &Y );
+                pdout << names[f] << "," << l << "," << w << "," << Y << "\n";
+            }
+        }
+    }
+    pdout.close();
+    cout<< "Done.  See output in "<< prefix <<"_*"<<endl;
+    return 0;
+}
@@ -0,0 +1,210 @@
+/*
+ A goodwin run as a lazily pulled range of (t, state) samples.
+
+ goodwinRun() is a C++20 coroutine: each step of a range-for over it
+ resumes the integration just far enough to reach the next output time
+ and hands over that one sample.  Nothing is buffered, and a consumer that
+ stops pulling (breaks out of the loop, or lets the range go) stops the
+ integration there too.  Stages are coroutines of the same kind that pull
+ from one range and yield another, so they compose with no intermediate
+ storage:
+
+     auto run = goodwinRun( STEPPER_RK8PD, 1e-6, 0.0, params, grid );
+     for ( const trajSample& s : decimated( monitored( std::move( run ), mo, params, grid.tStart ), 1e-4 ) )
+         sink( s );
+
+   decimated( in, tol )            the samples trajectoryDecimator keeps
+   monitored( in, o, p, t0, why )  up to and including the sample where a
+                                   terminationMonitor stops the run
+   takeWhile( in, pred )           until pred( sample ) is false
+
+ generator<T> is a minimal single pass std::generator (C++23, not in the
+ libstdc++ we build with): a move only view whose iterator dereferences
+ to the value last yielded.  It is a std::ranges::input_range, so the
+ standard adaptors compose with it too:
+
+     for ( const trajSample& s : goodwinRun( ... ) | std::views::take( 100 ) ) ...
+
+ Coroutine arguments are copied into the coroutine's frame, so the stages
+ take their parameters by value and a range may outlive the variables it
+ was made from.  Each goodwinRun has its own solver, so any number of
+ runs may be suspended at once on one thread.
+
+ Needs -std=c++20.
+*/
+
+#ifndef GOODWIN_GENERATOR_H
+#define GOODWIN_GENERATOR_H
+
+#if __cplusplus < 202002L
+#error "goodwin_generator.h needs C++20 coroutines: build with -std=c++20"
+#endif
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <ranges>
+#include <utility>
+
+#include "goodwin.h"
+#include "goodwin_rk.h"
+#include "goodwin_grid.h"
+#include "goodwin_output.h"
+#include "goodwin_monitor.h"
+
+struct trajSample {
+    double t;
+    double y[2];
+};
+
+template <class T>
+class generator : public std::ranges::view_base {
+public:
+    struct promise_type {
+        const T* value;
+        std::exception_ptr error;
+
+        generator get_return_object() { return generator( handle::from_promise( *this ) ); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        // the value lives in the suspended coroutine's frame until the next resume
+        std::suspend_always yield_value( const T& v ) noexcept
+        {
+            value = &v;
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+    using handle = std::coroutine_handle<promise_type>;
+
+    class iterator {
+    public:
+        using iterator_concept = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        explicit iterator( handle h ) : h_( h ) {}
+        const T& operator*() const { return *h_.promise().value; }
+        const T* operator->() const { return h_.promise().value; }
+        iterator& operator++()
+        {
+            resume( h_ );
+            return *this;
+        }
+        void operator++( int ) { ++*this; }
+        bool operator==( std::default_sentinel_t ) const { return h_.done(); }
+    private:
+        handle h_ = nullptr;
+    };
+
+    generator( generator&& o ) noexcept : h_( std::exchange( o.h_, nullptr ) ) {}
+    generator& operator=( generator&& o ) noexcept
+    {
+        if ( this != &o ) {
+            if ( h_ ) h_.destroy();
+            h_ = std::exchange( o.h_, nullptr );
+        }
+        return *this;
+    }
+    generator( const generator& ) = delete;
+    generator& operator=( const generator& ) = delete;
+    ~generator() { if ( h_ ) h_.destroy(); }
+
+    /* runs the coroutine to its first value; a range is walked once */
+    iterator begin()
+    {
+        resume( h_ );
+        return iterator( h_ );
+    }
+    std::default_sentinel_t end() const { return std::default_sentinel; }
+
+private:
+    explicit generator( handle h ) : h_( h ) {}
+
+    static void resume( handle h )
+    {
+        h.resume();
+        if ( h.promise().error ) std::rethrow_exception( h.promise().error );
+    }
+
+    handle h_;
+};
+
+static_assert( std::ranges::input_range< generator<trajSample> > );
+static_assert( std::ranges::view< generator<trajSample> > );
+
+/*
+ The run of goodwin.cpp: from (p.w0, p.Y0) at grid.tStart, one sample per
+ output time.  It ends early if the solver fails, with the GSL status in
+ *status when status is given.
+*/
+inline generator<trajSample> goodwinRun( stepperKind kind, double epsabs, double epsrel,
+                                         goodwinParams p, timeGrid grid, int* status = nullptr )
+{
+    goodwinIntegrator solver( kind, epsabs, epsrel );
+    solver.reset( p );
+    trajSample s = { grid.tStart, { p.w0, p.Y0 } };
+    if ( status != nullptr ) *status = GSL_SUCCESS;
+    for ( long i=1; i <= grid.size(); i++ ) {
+        int st = solver.apply( &s.t, grid.time( i ), s.y );
+        if ( st != GSL_SUCCESS ) {
+            if ( status != nullptr ) *status = st;
+            co_return;
+        }
+        co_yield s;
+    }
+}
+
+inline generator<trajSample> decimated( generator<trajSample> in, double tol )
+{
+    trajectoryDecimator decimator( tol );
+    trajSample kept;
+    bool have = false;
+    auto keep = [&kept, &have]( double t, const double y[2] ) {
+        kept = { t, { y[0], y[1] } };
+        have = true;
+    };
+    for ( const trajSample& s : in ) {
+        decimator.push( s.t, s.y, keep );
+        if ( have ) {
+            have = false;
+            co_yield kept;
+        }
+    }
+    decimator.finish( keep );
+    if ( have ) co_yield kept;
+}
+
+/*
+ The run in started from (p.w0, p.Y0) at t0.  why, when given, gets the
+ monitor's verdict once the range is done.
+*/
+inline generator<trajSample> monitored( generator<trajSample> in, monitorOptions o, goodwinParams p,
+                                        double t0, stopReason* why = nullptr )
+{
+    terminationMonitor monitor( o );
+    double y0[2] = { p.w0, p.Y0 };
+    monitor.start( t0, y0, p );
+    if ( why != nullptr ) *why = STOP_COMPLETE;
+    for ( const trajSample& s : in ) {
+        co_yield s;
+        if ( monitor.check( s.t, s.y ) ) {
+            if ( why != nullptr ) *why = monitor.reason();
+            co_return;
+        }
+    }
+}
+
+template <class Pred>
+generator<trajSample> takeWhile( generator<trajSample> in, Pred pred )
+{
+    for ( const trajSample& s : in ) {
+        if ( !pred( s ) ) co_return;
+        co_yield s;
+    }
+}
+
+#endif /* GOODWIN_GENERATOR_H */
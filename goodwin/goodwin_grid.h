@@ -0,0 +1,156 @@
+/*
+ Output time grids for the goodwin programs.
+
+ The programs used to write sample i at t = i * t1 / 1000 with t1 = 100,
+ so outputs were always 0.1 apart and the horizon was tied to the sample
+ count: reaching t = 1e5 meant writing a million rows.  timeGrid makes
+ the horizon, the spacing and the number of outputs independent:
+
+   linear  outputs every dt from t_start, Nsteps of them, or up to t_end
+           when that is given (Nsteps is then (t_end - t_start) / dt,
+           which must be a whole number)
+   log     Nsteps outputs spaced evenly in log(t - t_start), from
+           t_start + dt to t_end, for long asymptotic runs
+   final   only the state at t_end (or t_start + Nsteps dt); the solver
+           steps straight there without stopping at any output time
+
+ The run starts from (w0, Y0) at t_start.  Linear grids are computed as
+ t_start + i * span / intervals, so the default grid (span 100 over 1000
+ intervals) gives exactly the times the old loops did.
+*/
+
+#ifndef GOODWIN_GRID_H
+#define GOODWIN_GRID_H
+
+#include <cmath>
+#include <cstring>
+#include <string>
+
+#include "goodwin.h"
+
+enum gridSpacing { GRID_LINEAR, GRID_LOG, GRID_FINAL };
+
+struct timeGrid {
+    gridSpacing spacing;
+    double tStart;
+    double span;        // linear: outputs every span / intervals
+    long intervals;
+    double first;       // log: first output at tStart + first
+    double tEnd;        // log and final: last output time
+    long n;             // outputs
+
+    long size() const { return n; }
+
+    /* output time i = 1 .. size() */
+    double time( long i ) const
+    {
+        if ( spacing == GRID_LINEAR ) return tStart + i * span / intervals;
+        if ( spacing == GRID_FINAL || i >= n ) return tEnd;
+        return tStart + first * pow( ( tEnd - tStart ) / first, ( i - 1.0 ) / ( n - 1.0 ) );
+    }
+
+    double end() const { return time( n ); }
+};
+
+/* goodwin's original grid: nsteps outputs every 0.1 from t = 0 */
+inline timeGrid defaultGrid( long nsteps )
+{
+    timeGrid g = { GRID_LINEAR, 0.0, 100.0, 1000, 0.1, nsteps * 100.0 / 1000.0, nsteps };
+    return g;
+}
+
+/* Command line settings for makeTimeGrid; NAN / 0 / NULL when not given. */
+struct gridOptions {
+    double tStart;
+    double tEnd;
+    double dt;
+    char * spacing;     // "linear", "log" or "final"
+};
+
+inline void defaultGridOptions( gridOptions* o )
+{
+    o->tStart = NAN;
+    o->tEnd = NAN;
+    o->dt = 0.0;
+    o->spacing = NULL;
+}
+
+inline bool isDefaultGrid( const gridOptions& o )
+{
+    return std::isnan( o.tStart ) && std::isnan( o.tEnd ) && o.dt == 0.0 && o.spacing == NULL;
+}
+
+inline const char* gridSpacingName( gridSpacing s )
+{
+    return ( s == GRID_LOG ) ? "log" : ( s == GRID_FINAL ) ? "final" : "linear";
+}
+
+/* Build the grid for o with nsteps outputs where o does not fix the count. */
+inline bool makeTimeGrid( const gridOptions& o, long nsteps, timeGrid* g, std::string* err )
+{
+    *g = defaultGrid( nsteps );
+    if ( o.spacing == NULL || strcmp( o.spacing, "linear" ) == 0 ) g->spacing = GRID_LINEAR;
+    else if ( strcmp( o.spacing, "log" ) == 0 ) g->spacing = GRID_LOG;
+    else if ( strcmp( o.spacing, "final" ) == 0 ) g->spacing = GRID_FINAL;
+    else {
+        *err = strformat( "unknown grid '%s' (linear, log or final)", o.spacing );
+        return false;
+    }
+    if ( o.dt < 0.0 ) {
+        *err = "dt must be positive";
+        return false;
+    }
+    if ( !std::isnan( o.tStart ) ) g->tStart = o.tStart;
+    if ( o.dt > 0.0 ) {
+        g->span = o.dt;
+        g->intervals = 1;
+        g->first = o.dt;
+    }
+    bool haveEnd = !std::isnan( o.tEnd );
+    if ( haveEnd && !( o.tEnd > g->tStart ) ) {
+        *err = strformat( "t_end %g is not after t_start %g", o.tEnd, g->tStart );
+        return false;
+    }
+    switch ( g->spacing ) {
+        case GRID_LINEAR:
+            if ( haveEnd ) {
+                double dt = g->span / g->intervals, span = o.tEnd - g->tStart;
+                long n = lround( span / dt );
+                if ( n < 1 || fabs( n * dt - span ) > 1e-9 * span ) {
+                    *err = strformat( "t_end - t_start = %g is not a whole number of dt = %g", span, dt );
+                    return false;
+                }
+                g->n = n;
+                g->span = span;
+                g->intervals = n;
+            }
+            g->tEnd = g->time( g->n );
+            break;
+        case GRID_LOG:
+            if ( !haveEnd ) {
+                *err = "a log grid needs t_end";
+                return false;
+            }
+            if ( !( o.tEnd - g->tStart > g->first ) || nsteps < 2 ) {
+                *err = "a log grid needs t_end - t_start > dt and at least 2 outputs";
+                return false;
+            }
+            g->tEnd = o.tEnd;
+            break;
+        case GRID_FINAL:
+            g->tEnd = haveEnd ? o.tEnd : g->tStart + nsteps * g->span / g->intervals;
+            g->n = 1;
+            break;
+    }
+    return true;
+}
+
+/* "# grid=log , t_start=0 , t_end=1e+06 , dt=0.1 , outputs=500" */
+inline std::string gridHeader( const timeGrid& g )
+{
+    return strformat( "# grid=%s , t_start=%g , t_end=%g , dt=%g , outputs=%ld\n",
+                      gridSpacingName( g.spacing ), g.tStart, g.tEnd,
+                      ( g.spacing == GRID_LINEAR ) ? g.span / g.intervals : g.first, g.n );
+}
+
+#endif /* GOODWIN_GRID_H */
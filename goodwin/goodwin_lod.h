@@ -0,0 +1,206 @@
+/*
+ Level-of-detail min/max pyramid of a trajectory, for viewers that scrub
+ through runs far too long to redraw sample by sample.
+
+ lodWriter is fed every (t, w, Y) sample as the solver produces it and
+ keeps, per level, bins of the time range and the min and max of wages and
+ output they cover.  Level 0 bins summarize LOD_BASE samples, and each
+ level above merges LOD_FANOUT bins of the one below, up to a single bin
+ for the whole run.  A viewer drawing a window of P pixels takes the
+ coarsest level with at least P bins in the window and reads those bins
+ only: O(P + log N) work for N samples, instead of O(N).
+
+ The pyramid is built in the one pass: each sample updates one open bin
+ per level, and a closed level 0 bin goes straight to the file, so only
+ the levels above (a third of the bins) stay in memory until close().
+
+ File layout, native byte order (little-endian on anything we run on):
+   lodHeader     magic "GWLOD01\n", base, fanout, samples, levels, and
+                 per level the byte offset and number of bins
+   lodBin[]      level 0, in time order, then level 1, ...
+ A bin is { double t0, t1; float wmin, wmax, Ymin, Ymax } with the float
+ minima rounded down and maxima rounded up, so the envelope still holds.
+ sandbox/goodwin_lod.py reads it with numpy.
+*/
+
+#ifndef GOODWIN_LOD_H
+#define GOODWIN_LOD_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+static const uint32_t LOD_BASE = 16;     // samples per level 0 bin
+static const uint32_t LOD_FANOUT = 4;    // bins merged per level
+static const int LOD_MAX_LEVELS = 32;    // 16 * 4^31 samples is plenty
+
+struct lodBin {
+    double t0, t1;
+    float wmin, wmax, Ymin, Ymax;
+};
+
+struct lodHeader {
+    char magic[8];
+    uint32_t base;
+    uint32_t fanout;
+    uint64_t samples;
+    uint32_t levels;
+    uint32_t reserved;
+    uint64_t offset[LOD_MAX_LEVELS];
+    uint64_t count[LOD_MAX_LEVELS];
+};
+
+class lodWriter {
+public:
+    lodWriter() : f_( NULL ), samples_( 0 ) {}
+    ~lodWriter() { close(); }
+
+    bool open( const std::string& path )
+    {
+        f_ = fopen( path.c_str(), "wb" );
+        if ( f_ == NULL ) {
+            err_ = strerror( errno );
+            return false;
+        }
+        path_ = path;
+        samples_ = 0;
+        open_.assign( 1, emptyBin() );
+        fill_.assign( 1, 0 );
+        upper_.assign( 1, std::vector<lodBin>() );
+        level0_ = 0;
+        lodHeader h = header();
+        return fwrite( &h, sizeof(h), 1, f_ ) == 1 || fail();
+    }
+
+    bool isOpen() const { return f_ != NULL; }
+
+    void append( double t, const double y[2] )
+    {
+        if ( f_ == NULL ) return;
+        lodBin b = { t, t, down( y[0] ), up( y[0] ), down( y[1] ), up( y[1] ) };
+        samples_++;
+        add( 0, b, LOD_BASE );
+    }
+
+    /* Close the open bins, write the upper levels and the header. */
+    bool close()
+    {
+        if ( f_ == NULL ) return err_.empty();
+        // partial bins close bottom up, which may start one more level
+        for ( size_t k=0; k < open_.size(); k++ ) {
+            if ( fill_[k] == 0 ) continue;
+            lodBin b = open_[k];
+            open_[k] = emptyBin();
+            fill_[k] = 0;
+            emit( k, b );
+        }
+        lodHeader h = header();
+        uint64_t pos = sizeof(lodHeader) + level0_ * sizeof(lodBin);
+        bool ok = err_.empty();
+        for ( size_t k=1; ok && k < upper_.size(); k++ ) {
+            h.offset[k] = pos;
+            h.count[k] = upper_[k].size();
+            ok = fwrite( upper_[k].data(), sizeof(lodBin), upper_[k].size(), f_ ) == upper_[k].size();
+            pos += upper_[k].size() * sizeof(lodBin);
+        }
+        ok = ok && fseek( f_, 0, SEEK_SET ) == 0 && fwrite( &h, sizeof(h), 1, f_ ) == 1;
+        if ( !ok ) fail();
+        if ( fclose( f_ ) != 0 ) fail();
+        f_ = NULL;
+        upper_.clear();
+        return err_.empty();
+    }
+
+    const std::string& error() const { return err_; }
+    const std::string& path() const { return path_; }
+    uint64_t samples() const { return samples_; }
+
+private:
+    FILE * f_;
+    std::string path_;
+    std::string err_;
+    uint64_t samples_;
+    std::vector<lodBin> open_;                  // bin being filled, per level
+    std::vector<uint32_t> fill_;                // samples or bins in it
+    std::vector< std::vector<lodBin> > upper_;  // closed bins of levels 1 and up
+    uint64_t level0_;                           // closed level 0 bins, already on disk
+    lodBin first0_;                             // the first of them, for starting level 1
+
+    static lodBin emptyBin() { return { INFINITY, -INFINITY, INFINITY, -INFINITY, INFINITY, -INFINITY }; }
+    static float down( double x ) { float f = (float)x; return ( f > x ) ? nextafterf( f, -INFINITY ) : f; }
+    static float up( double x ) { float f = (float)x; return ( f < x ) ? nextafterf( f, INFINITY ) : f; }
+
+    static void merge( lodBin* a, const lodBin& b )
+    {
+        a->t0 = std::min( a->t0, b.t0 );
+        a->t1 = std::max( a->t1, b.t1 );
+        a->wmin = std::min( a->wmin, b.wmin );
+        a->wmax = std::max( a->wmax, b.wmax );
+        a->Ymin = std::min( a->Ymin, b.Ymin );
+        a->Ymax = std::max( a->Ymax, b.Ymax );
+    }
+
+    uint64_t levelCount( size_t k ) const { return ( k == 0 ) ? level0_ : upper_[k].size(); }
+
+    /* Merge b into level k's open bin, closing it once it holds per items. */
+    void add( size_t k, const lodBin& b, uint32_t per )
+    {
+        merge( &open_[k], b );
+        if ( ++fill_[k] < per ) return;
+        lodBin done = open_[k];
+        open_[k] = emptyBin();
+        fill_[k] = 0;
+        emit( k, done );
+    }
+
+    /*
+     Store a closed level k bin and pass it up to level k + 1.  A level
+     with one bin is the top, so level k + 1 starts at level k's second bin.
+    */
+    void emit( size_t k, const lodBin& b )
+    {
+        if ( k == 0 ) {
+            if ( err_.empty() && fwrite( &b, sizeof(b), 1, f_ ) != 1 ) fail();
+            if ( level0_ == 0 ) first0_ = b;
+            level0_++;
+        } else {
+            upper_[k].push_back( b );
+        }
+        if ( k + 1 == open_.size() ) {
+            if ( levelCount( k ) < 2 || (int)open_.size() == LOD_MAX_LEVELS ) return;
+            open_.push_back( emptyBin() );
+            fill_.push_back( 0 );
+            upper_.push_back( std::vector<lodBin>() );
+            lodBin first = ( k == 0 ) ? first0_ : upper_[k][0];
+            add( k + 1, first, LOD_FANOUT );
+        }
+        add( k + 1, b, LOD_FANOUT );
+    }
+
+    lodHeader header() const
+    {
+        lodHeader h;
+        memset( &h, 0, sizeof(h) );
+        memcpy( h.magic, "GWLOD01\n", 8 );
+        h.base = LOD_BASE;
+        h.fanout = LOD_FANOUT;
+        h.samples = samples_;
+        h.levels = open_.size();
+        h.offset[0] = sizeof(lodHeader);
+        h.count[0] = level0_;
+        return h;
+    }
+
+    bool fail()
+    {
+        if ( err_.empty() ) err_ = strerror( errno );
+        return false;
+    }
+};
+
+#endif /* GOODWIN_LOD_H */
@@ -0,0 +1,577 @@
+/*
+ Monte Carlo uncertainty propagation for the Goodwin wage--output model.
+
+ Samples goodwinParams from user specified distributions (pseudo-random, or
+ a quasi-random Sobol sequence), integrates the samples in parallel batches,
+ and aggregates the mean, standard deviation and quantiles of w(t) and Y(t)
+ with streaming estimators, so memory does not grow with the sample count.
+ --float32 integrates each batch in float lanes (goodwin_ensemble.h) for
+ screening, and reruns in float64 only the samples its shadow check rejects.
+
+ Each batch draws from its own random stream, keyed by the batch number,
+ and each sample is integrated on its own from a reset solver, so a
+ sample's trajectory depends only on its goodwinParams: goodwin run with
+ the same parameters reproduces it.  The statistics also depend on the
+ order batches reach them; --deterministic fixes that order to the batch
+ numbers, so the output file is the same bit for bit on any number of
+ threads, and --verify-determinism checks it.  Build with
+ -ffp-contract=off, as the makefile does, so that no fused multiply-adds
+ make the float32 lanes' vector and scalar paths differ.
+
+ g++ -Wall -O3 -ffp-contract=off -pthread -I/usr/include/ -c goodwin_mc.cpp &&
+ g++ -pthread -L/usr/local/lib goodwin_mc.o -lgsl -lgslcblas -lpopt -lstdc++fs -o goodwin_mc
+
+ Distribution specs are "kind:p1:p2", e.g.
+   --r-dist normal:1.0:0.1      mean, standard deviation
+   --a-dist uniform:0.8:1.2     low, high
+   --b-dist lognormal:0.0:0.2   mean and sd of log(b)
+   --w0-dist fixed:3.0          (or just 3.0)
+*/
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <unistd.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <gsl/gsl_rng.h>
+#include <gsl/gsl_qrng.h>
+#include <gsl/gsl_cdf.h>
+
+#include <popt.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <experimental/filesystem>
+
+#include "goodwin.h"
+#include "goodwin_stats.h"
+#include "goodwin_numa.h"
+#include "goodwin_solver.h"
+#include "goodwin_grid.h"
+#include "goodwin_ensemble.h"
+
+namespace fs = std::experimental::filesystem;
+
+using namespace std;
+
+#define PROGRAM_NAME "goodwin_mc"
+#define VERSION 1
+#define NPARAMS 6
+/* cap on the per-thread trajectory buffer, in doubles */
+#define BATCH_BUFFER_MAX (8*1024*1024)
+
+enum distKind { DIST_FIXED, DIST_UNIFORM, DIST_NORMAL, DIST_LOGNORMAL };
+
+struct paramDist {
+    distKind kind;
+    double p1;
+    double p2;
+};
+
+struct mcOptions {
+    long Nsamples;
+    int threads;
+    int batch;
+    long seed;
+    int sobol;
+    char * quantiles;
+    char * pin;
+    char * dists[NPARAMS];
+    int float32;        // float lanes with a float64 shadow, rerunning suspect ones
+    double f32Tol;
+    int shadowEvery;
+    int deterministic;  // statistics independent of thread count and scheduling
+    int verify;
+    gridOptions grid;
+};
+
+static const char * paramNames[NPARAMS] = { "r", "c", "a", "b", "w0", "Y0" };
+
+static double * paramField( goodwinParams* p, int k )
+{
+    switch ( k ) {
+        case 0: return &p->r;
+        case 1: return &p->c;
+        case 2: return &p->a;
+        case 3: return &p->b;
+        case 4: return &p->w0;
+        default: return &p->Y0;
+    }
+}
+
+static void parseArguments( int argc, const char **argv, goodwinParams* gparams,
+                            mcOptions* mc, char ** outfile )
+{
+    poptContext optCon;
+    const struct poptOption optionsTable[] = {
+        POPT_AUTOHELP
+        { "nsteps", 'n', POPT_ARG_INT, &gparams->Nsteps, 0,
+            "Set number of time steps." },
+        { "samples", 'N', POPT_ARG_LONG, &mc->Nsamples, 0,
+            "Set number of Monte Carlo samples." },
+        { "t-start", 0, POPT_ARG_DOUBLE, &mc->grid.tStart, 0,
+            "Set start time of the run (default 0)." },
+        { "t-end", 0, POPT_ARG_DOUBLE, &mc->grid.tEnd, 0,
+            "Set end time of the run; with a linear grid this sets the number of outputs." },
+        { "dt", 0, POPT_ARG_DOUBLE, &mc->grid.dt, 0,
+            "Set output spacing (default 0.1); the first output time of a log grid." },
+        { "grid", 0, POPT_ARG_STRING, &mc->grid.spacing, 0,
+            "Set output times: linear (default), log (Nsteps log-spaced to t-end), or final (last state only)." },
+        { "threads", 't', POPT_ARG_INT, &mc->threads, 0,
+            "Set number of worker threads (default: all cores)." },
+        { "pin", 0, POPT_ARG_STRING, &mc->pin, 0,
+            "Pin worker threads to a core, a NUMA node, or none (default core)." },
+        { "batch", 'B', POPT_ARG_INT, &mc->batch, 0,
+            "Set number of samples integrated per batch." },
+        { "seed", 's', POPT_ARG_LONG, &mc->seed, 0,
+            "Set random seed." },
+        { "sobol", 'S', POPT_ARG_NONE, &mc->sobol, 0,
+            "Draw samples from a quasi-random Sobol sequence." },
+        { "float32", 0, POPT_ARG_NONE, &mc->float32, 0,
+            "Screen in float: integrate batches in float32 lanes, rerunning in float64 those the shadow check rejects." },
+        { "f32-tol", 0, POPT_ARG_DOUBLE, &mc->f32Tol, 0,
+            "Set the --float32 error estimate, relative to 1 + |y|, above which a sample is rerun (default 1e-2)." },
+        { "shadow-every", 0, POPT_ARG_INT, &mc->shadowEvery, 0,
+            "Shadow every this many --float32 steps with a float64 step (default 16)." },
+        { "deterministic", 'D', POPT_ARG_NONE, &mc->deterministic, 0,
+            "Reduce batches in batch order, so the output is bit for bit the same on any number of threads." },
+        { "verify-determinism", 0, POPT_ARG_NONE, &mc->verify, 0,
+            "Run deterministically on 1 and on --threads threads, check the statistics are bit for bit equal, and time it against a free-running run." },
+        { "quantiles", 'q', POPT_ARG_STRING, &mc->quantiles, 0,
+            "Comma separated quantiles to track (default 0.05,0.25,0.5,0.75,0.95)." },
+        { "r-dist", 0, POPT_ARG_STRING, &mc->dists[0], 0,
+            "Distribution of wage appreciation parameter r." },
+        { "c-dist", 0, POPT_ARG_STRING, &mc->dists[1], 0,
+            "Distribution of wage growth decay rate parameter c." },
+        { "a-dist", 0, POPT_ARG_STRING, &mc->dists[2], 0,
+            "Distribution of output growth rate parameter a." },
+        { "b-dist", 0, POPT_ARG_STRING, &mc->dists[3], 0,
+            "Distribution of output depreciation parameter b." },
+        { "w0-dist", 0, POPT_ARG_STRING, &mc->dists[4], 0,
+            "Distribution of initial wage share w0." },
+        { "Y0-dist", 0, POPT_ARG_STRING, &mc->dists[5], 0,
+            "Distribution of initial output level Y0." },
+        { "output", 'o', POPT_ARG_STRING, outfile, 0,
+            "Pandas format CSV file output pathname." },
+        {NULL, 0, 0, NULL, 0, }
+    };
+    int err;
+    const char *arg = NULL;
+    int argcnt = 0;
+
+    optCon = poptGetContext(PROGRAM_NAME, argc, argv, optionsTable, 0);
+    poptReadDefaultConfig(optCon, 0);
+
+    err = poptGetNextOpt(optCon);
+    if (err != -1) {
+        fprintf(stderr, "\t%s: %s\n",
+            poptBadOption(optCon, POPT_BADOPTION_NOALIAS),
+            poptStrerror(err));
+        exit(-1);
+    }
+
+    /* Parse arguments that do not begin with '-' (leftovers) */
+    arg = poptGetArg(optCon);
+    while (arg != NULL) {
+        printf("arg %2d   = %s\n", ++argcnt, arg);
+        arg = poptGetArg(optCon);
+    }
+    poptFreeContext(optCon);
+}
+
+/*
+ Parse a "kind:p1:p2" distribution spec.  A bare number is a fixed value,
+ and a NULL spec leaves the parameter fixed at its default.
+*/
+static bool parseDist( const char * spec, double fallback, paramDist* d )
+{
+    d->kind = DIST_FIXED;
+    d->p1 = fallback;
+    d->p2 = 0.0;
+    if ( spec == NULL ) return true;
+    char kind[32];
+    double p1, p2;
+    int nread = sscanf( spec, "%31[a-z]:%lf:%lf", kind, &p1, &p2 );
+    if ( nread <= 0 ) {
+        char * end;
+        d->p1 = strtod( spec, &end );
+        return ( end != spec && *end == '\0' );
+    }
+    if ( strcmp( kind, "fixed" )==0 && nread >= 2 ) {
+        d->p1 = p1;
+        return true;
+    }
+    if ( nread != 3 ) return false;
+    d->p1 = p1;
+    d->p2 = p2;
+    if ( strcmp( kind, "uniform" )==0 ) d->kind = DIST_UNIFORM;
+    else if ( strcmp( kind, "normal" )==0 ) d->kind = DIST_NORMAL;
+    else if ( strcmp( kind, "lognormal" )==0 ) d->kind = DIST_LOGNORMAL;
+    else return false;
+    return true;
+}
+
+static string distString( const paramDist& d )
+{
+    switch ( d.kind ) {
+        case DIST_UNIFORM: return strformat("uniform:%g:%g", d.p1, d.p2);
+        case DIST_NORMAL: return strformat("normal:%g:%g", d.p1, d.p2);
+        case DIST_LOGNORMAL: return strformat("lognormal:%g:%g", d.p1, d.p2);
+        default: return strformat("fixed:%g", d.p1);
+    }
+}
+
+/* Map a uniform deviate u in (0,1) onto the distribution by inverse CDF. */
+static double sampleDist( const paramDist& d, double u )
+{
+    switch ( d.kind ) {
+        case DIST_UNIFORM: return d.p1 + ( d.p2 - d.p1 ) * u;
+        case DIST_NORMAL: return d.p1 + d.p2 * gsl_cdf_ugaussian_Pinv( u );
+        case DIST_LOGNORMAL: return exp( d.p1 + d.p2 * gsl_cdf_ugaussian_Pinv( u ) );
+        default: return d.p1;
+    }
+}
+
+/* splitmix64 finaliser, used to derive independent per-batch seeds. */
+static unsigned long mixSeed( unsigned long x )
+{
+    x += 0x9e3779b97f4a7c15UL;
+    x = ( x ^ ( x >> 30 ) ) * 0xbf58476d1ce4e5b9UL;
+    x = ( x ^ ( x >> 27 ) ) * 0x94d049bb133111ebUL;
+    return x ^ ( x >> 31 );
+}
+
+struct mcShared {
+    goodwinParams base;
+    timeGrid grid;
+    paramDist dists[NPARAMS];
+    int uncertain[NPARAMS];   // indices of the non-fixed parameters
+    int ndim;
+    long Nsamples;
+    int batch;
+    unsigned long seed;
+    gsl_qrng * qrng;          // NULL unless drawing from a Sobol sequence
+    mutex samplerLock;
+    long nextBatch;
+    atomic<long> completed;
+    atomic<long> rejected;
+    atomic<long> failed;
+    int float32;
+    double f32Tol;
+    int shadowEvery;
+    atomic<long> fallback;    // float32 samples rerun in float64
+    int deterministic;
+    ensembleAccumulator * acc;
+    vector<numaNode> nodes;
+    pinMode pin;
+    nodeTally * tally;
+};
+
+static void mcWorker( int id, mcShared* sh )
+{
+    // pin first, so the driver and buffers below are first touched on this worker's node
+    int node = pinWorker( sh->nodes, id, sh->pin );
+    goodwinParams p = sh->base;
+    solverContext& solver = threadSolver();
+    gsl_rng * rng = gsl_rng_alloc( gsl_rng_mt19937 );
+    int Nt = p.Nsteps;
+    int B = sh->batch;
+    int ndim = sh->ndim;
+    vector<double> u( (size_t)B * ( ndim > 0 ? ndim : 1 ) );
+    vector<double> traj( (size_t)B * Nt * 2 );
+    vector<char> ok( B );
+    vector<goodwinParams> lanes( B );
+    vector<char> suspect( B );
+    laneEnsemble ensemble( sh->f32Tol, sh->shadowEvery );
+    long done = 0;
+    // sample k in float64, into its row of traj
+    auto integrate = [&]( int k ) {
+        const goodwinParams& pk = lanes[k];
+        double t = sh->grid.tStart;
+        double y[2] = { pk.w0, pk.Y0 };
+        double * row = &traj[(size_t)k * Nt * 2];
+        solver.reset( pk );
+        int status = GSL_SUCCESS;
+        for ( int i = 1; i <= Nt; i++ ) {
+            status = solver.apply( &t, sh->grid.time( i ), y );
+            if ( status != GSL_SUCCESS ) break;
+            row[2*(i-1)] = y[0];
+            row[2*(i-1)+1] = y[1];
+        }
+        return status;
+    };
+
+    while ( true ) {
+        long b;
+        int nb;
+        {
+            lock_guard<mutex> guard( sh->samplerLock );
+            b = sh->nextBatch++;
+            if ( b * B >= sh->Nsamples ) break;
+            nb = (int)min( (long)B, sh->Nsamples - b * B );
+            // Sobol points are sequential, so draw them under the lock
+            if ( sh->qrng != NULL ) {
+                for ( int k=0; k < nb; k++ ) gsl_qrng_get( sh->qrng, &u[(size_t)k*ndim] );
+            }
+        }
+        if ( sh->qrng == NULL ) {
+            // each batch has its own stream, whichever thread runs it
+            gsl_rng_set( rng, mixSeed( sh->seed ^ mixSeed( (unsigned long)b ) ) );
+            for ( size_t j=0; j < (size_t)nb * ndim; j++ ) u[j] = gsl_rng_uniform_pos( rng );
+        }
+
+        for ( int k=0; k < nb; k++ ) {
+            ok[k] = 0;
+            bool valid = true;
+            for ( int j=0; j < ndim; j++ ) {
+                int ip = sh->uncertain[j];
+                double x = sampleDist( sh->dists[ip], u[(size_t)k*ndim + j] );
+                *paramField( &p, ip ) = x;
+                if ( !( x > 0.0 ) ) valid = false;
+            }
+            lanes[k] = p;
+            if ( !valid ) {
+                sh->rejected++;
+                continue;
+            }
+            ok[k] = 1;
+        }
+        if ( sh->float32 ) {
+            // rejected samples ride along in their lanes and are dropped after
+            ensemble.run( lanes.data(), nb, Nt, sh->grid.span / sh->grid.intervals, traj.data(), suspect.data() );
+        }
+        for ( int k=0; k < nb; k++ ) {
+            if ( !ok[k] || ( sh->float32 && !suspect[k] ) ) continue;
+            if ( sh->float32 ) sh->fallback++;
+            if ( integrate( k ) != GSL_SUCCESS ) {
+                sh->failed++;
+                ok[k] = 0;
+            }
+        }
+        if ( sh->deterministic ) sh->acc->addInOrder( traj.data(), ok.data(), nb, id, b );
+        else sh->acc->add( traj.data(), ok.data(), nb, id );
+        long nok = 0;
+        for ( int k=0; k < nb; k++ ) nok += ok[k];
+        sh->completed += nok;
+        done += nok;
+    }
+    sh->tally->add( node, done );
+    gsl_rng_free( rng );
+}
+
+/* Run the whole ensemble into sh->acc on nthreads workers; the elapsed seconds. */
+static double runEnsemble( mcShared* sh, int nthreads )
+{
+    sh->nextBatch = 0;
+    sh->completed = 0;
+    sh->rejected = 0;
+    sh->failed = 0;
+    sh->fallback = 0;
+    if ( sh->qrng != NULL ) gsl_qrng_init( sh->qrng );
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for ( int id=0; id < nthreads; id++ ) workers.push_back( thread( mcWorker, id, sh ) );
+    for ( auto& w : workers ) w.join();
+    return chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+}
+
+int main ( int argc, const char *argv[] )
+{
+    goodwinParams params;
+    defaultParams( &params );
+    mcOptions mc;
+    mc.Nsamples = 1000;
+    mc.threads = 0;
+    mc.batch = 64;
+    mc.seed = 1;
+    mc.sobol = 0;
+    mc.quantiles = NULL;
+    mc.pin = NULL;
+    mc.float32 = 0;
+    mc.f32Tol = 1e-2;
+    mc.shadowEvery = 16;
+    mc.deterministic = 0;
+    mc.verify = 0;
+    defaultGridOptions( &mc.grid );
+    for ( int k=0; k < NPARAMS; k++ ) mc.dists[k] = NULL;
+    char * pathname = NULL;
+    parseArguments( argc, argv, &params, &mc, &pathname );
+    string outfile = ( pathname != NULL ) ? pathname : "";
+
+    if ( params.Nsteps>NMAX ) {
+        cout << "Nsteps exceeded maximum.  Resetting Nsteps to  NMAX ="<<NMAX<<endl;
+        params.Nsteps = NMAX;
+    } else if (params.Nsteps<1 ) {
+        cout << "Nsteps = "<<params.Nsteps << " less than minimum."
+        << "\nResetting Nsteps to default = 100" << endl;
+        params.Nsteps = 100;
+    }
+    timeGrid grid;
+    string gridErr;
+    if ( !makeTimeGrid( mc.grid, params.Nsteps, &grid, &gridErr ) ) {
+        fprintf(stderr,"\tgrid: %s\n",gridErr.c_str());
+        exit(-1);
+    }
+    if ( grid.size() >= NMAX ) {
+        fprintf(stderr,"\tgrid: %ld outputs exceeds maximum %d\n",grid.size(),NMAX);
+        exit(-1);
+    }
+    params.Nsteps = grid.size();
+    // the float lanes step through equally spaced outputs
+    if ( mc.float32 && grid.spacing != GRID_LINEAR ) {
+        fprintf(stderr,"\tfloat32: needs a linear grid, not %s\n",gridSpacingName( grid.spacing ));
+        exit(-1);
+    }
+    if ( mc.Nsamples < 1 ) {
+        fprintf(stderr, "\tsamples: must be at least 1\n");
+        exit(-1);
+    }
+    vector<double> probs;
+    if ( !parseQuantiles( mc.quantiles, &probs ) ) {
+        fprintf(stderr, "\tquantiles: could not parse '%s'\n", mc.quantiles);
+        exit(-1);
+    }
+    vector<numaNode> nodes = numaTopology();
+    if ( mc.threads < 1 ) mc.threads = numaCpuCount( nodes );
+    pinMode pin;
+    if ( !parsePinMode( mc.pin, mc.threads, numaCpuCount( nodes ), &pin ) ) {
+        fprintf(stderr, "\tpin: unknown mode '%s' (use core, node or none)\n", mc.pin);
+        exit(-1);
+    }
+    if ( mc.batch < 1 ) mc.batch = 1;
+    // keep each worker's trajectory buffer bounded for long runs
+    long maxBatch = max( 1L, (long)BATCH_BUFFER_MAX / ( 2L * params.Nsteps ) );
+    if ( mc.batch > maxBatch ) mc.batch = (int)maxBatch;
+
+    mcShared sh;
+    sh.base = params;
+    sh.grid = grid;
+    sh.ndim = 0;
+    for ( int k=0; k < NPARAMS; k++ ) {
+        if ( !parseDist( mc.dists[k], *paramField( &params, k ), &sh.dists[k] ) ) {
+            fprintf(stderr, "\t%s-dist: could not parse '%s'\n", paramNames[k], mc.dists[k]);
+            exit(-1);
+        }
+        if ( sh.dists[k].kind != DIST_FIXED ) sh.uncertain[sh.ndim++] = k;
+        else *paramField( &sh.base, k ) = sh.dists[k].p1;
+    }
+    sh.Nsamples = mc.Nsamples;
+    sh.batch = mc.batch;
+    sh.seed = (unsigned long)mc.seed;
+    sh.qrng = ( mc.sobol && sh.ndim > 0 ) ? gsl_qrng_alloc( gsl_qrng_sobol, sh.ndim ) : NULL;
+    sh.float32 = mc.float32;
+    sh.f32Tol = mc.f32Tol;
+    sh.shadowEvery = mc.shadowEvery;
+    sh.deterministic = mc.deterministic || mc.verify;
+    sh.nodes = nodes;
+    sh.pin = pin;
+    // --verify-determinism: the same ensemble free running, then in order on one thread
+    unique_ptr<ensembleAccumulator> serialAcc;
+    double freeSecs = 0.0, serialSecs = 0.0;
+    bool freeMatches = false;
+    if ( mc.verify ) {
+        ensembleAccumulator freeAcc( params.Nsteps, probs, mc.threads );
+        serialAcc.reset( new ensembleAccumulator( params.Nsteps, probs, 1 ) );
+        nodeTally scratch( nodes.size() );
+        sh.tally = &scratch;
+        sh.acc = &freeAcc;
+        sh.deterministic = 0;
+        freeSecs = runEnsemble( &sh, mc.threads );
+        sh.acc = serialAcc.get();
+        sh.deterministic = 1;
+        serialSecs = runEnsemble( &sh, 1 );
+        freeMatches = freeAcc.identical( *serialAcc );
+    }
+    ensembleAccumulator acc( params.Nsteps, probs, mc.threads );
+    sh.acc = &acc;
+    nodeTally tally( nodes.size() );
+    sh.tally = &tally;
+
+    cout << "Integrating " << mc.Nsamples << " samples on " << mc.threads
+         << " threads (pinned: " << pinModeName( pin ) << ", " << nodes.size()
+         << " NUMA node(s)), batches of " << mc.batch
+         << ( sh.deterministic ? ", in batch order" : "" ) << endl;
+    double elapsed = runEnsemble( &sh, mc.threads );
+    if ( sh.qrng != NULL ) gsl_qrng_free( sh.qrng );
+    cout << "Completed " << sh.completed << " samples (" << sh.rejected << " rejected, "
+         << sh.failed << " failed) in " << elapsed << " s, "
+         << sh.completed / elapsed << " samples/s" << endl;
+    if ( mc.float32 ) {
+        cout << "float32: " << sh.fallback << " samples rerun in float64 (error estimate above "
+             << mc.f32Tol << ")" << endl;
+    }
+    if ( pin != PIN_NONE ) printNodeThroughput( nodes, tally, elapsed, "samples" );
+    bool verified = true;
+    if ( mc.verify ) {
+        verified = acc.identical( *serialAcc );
+        cout << "Determinism: " << mc.threads << " threads in order " << ( verified ? "match" : "DIFFER from" )
+             << " 1 thread bit for bit (" << elapsed << " s against " << serialSecs << " s on 1 thread); "
+             << "free running took " << freeSecs << " s, so ordering costs "
+             << 100.0 * ( elapsed / freeSecs - 1.0 ) << "%, and "
+             << ( freeMatches ? "happened to match" : "did not match" ) << endl;
+    }
+
+    // File output set-up
+    time_t sysTime = time(0);
+    char chTime[80];
+    strftime(chTime,79,"%Y-%m-%d",localtime(&sysTime));
+    string csvfile = strformat("./sim_data/%s_v%d_N%d_S%ld_%s.pd",PROGRAM_NAME,
+            VERSION,params.Nsteps,mc.Nsamples,chTime);
+    if ( outfile.empty() ) {
+        cout<<"Using default output pathname: '"<< csvfile <<"'"<< endl;
+    } else {
+        csvfile = outfile;
+        cout << "Using outfile pathname set by user: '"<< csvfile <<"'" <<endl;
+    }
+    fs::path dname = fs::path( csvfile ).parent_path();
+    struct stat info;
+    if ( !dname.empty() && stat( dname.c_str(), &info ) != 0 ) {
+        printf(" dir path '%s' does not exist, so\n",dname.c_str());
+        printf(" we will now create this directory for you.\n");
+        int status = mkdir(dname.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+        if ( status == -1 ) printf("Could not mkdir for '%s'\n",dname.c_str());
+    }
+
+    ofstream pdout;
+    pdout.open(csvfile);
+    pdout << "# Goodwin model Monte Carlo output." << endl;
+    pdout << "# samples=" << mc.Nsamples << " , completed=" << sh.completed
+       << " , rejected=" << sh.rejected << " , failed=" << sh.failed
+       << " , sampler=" << ( mc.sobol ? "sobol" : "mt19937" )
+       << " , seed=" << mc.seed << " , Nsteps=" << params.Nsteps
+       << ( sh.deterministic ? " , deterministic=1" : "" ) << endl;
+    if ( mc.float32 ) {
+        pdout << "# float32: f32_tol=" << mc.f32Tol << " , shadow_every=" << mc.shadowEvery
+           << " , dt=" << ENSEMBLE_DT << " , fallback=" << sh.fallback << endl;
+    }
+    pdout << "#";
+    for ( int k=0; k < NPARAMS; k++ ) {
+        pdout << ( k ? " , " : " " ) << paramNames[k] << "=" << distString( sh.dists[k] );
+    }
+    pdout << endl;
+    if ( !isDefaultGrid( mc.grid ) ) pdout << gridHeader( grid );
+    // NB: no whitespace in the column names if we want Pandas dataframe format
+    pdout << "time";
+    acc.writeHeader( pdout );
+    pdout << endl;
+    for ( int i = 0; i < params.Nsteps; i++ ) {
+        pdout << setw(12) << fixed << grid.time( i+1 );
+        acc.writeRow( pdout, i );
+        pdout << endl;
+    }
+    pdout.close();
+    cout<< "Done.  See output in "<< csvfile <<endl;
+    if ( !verified ) {
+        fprintf(stderr,"\tverify-determinism: %d thread statistics differ from 1 thread\n",mc.threads);
+        return -1;
+    }
+    return 0;
+}
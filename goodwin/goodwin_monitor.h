@@ -0,0 +1,176 @@
+/*
+ Termination monitors: stop a goodwin run once going on is wasted work,
+ and say why it stopped.
+
+ terminationMonitor checks each output sample against the monitors that
+ are switched on (a zero setting is off):
+   blow-up     a non-finite state, or |y| > maxNorm
+   collapse    wages or output below floor, heading for the w = 0 or
+               Y = 0 axis the model can only approach
+   steady      |dy/dt| <= steadyTol (1 + |y|), from func()
+   closed      the trajectory has come back to within closureTol of its
+               initial point, relative to 1 + |y0| per component, after
+               first getting 100 closureTol away: one full period
+ Closure is looked for between samples too, along the cubic Hermite
+ interpolant of (y, dy/dt) at the interval's ends (goodwin_fate.h), so
+ it is found even when the output spacing is far coarser than the
+ tolerance; period() is then the time of the closest approach.
+
+ A run that reaches its last output stops with STOP_COMPLETE, and one
+ whose solver fails with STOP_SOLVER_ERROR.
+*/
+
+#ifndef GOODWIN_MONITOR_H
+#define GOODWIN_MONITOR_H
+
+#include <cmath>
+#include <algorithm>
+
+#include "goodwin.h"
+#include "goodwin_fate.h"
+
+enum stopReason { STOP_COMPLETE, STOP_SOLVER_ERROR, STOP_BLOWUP, STOP_COLLAPSE, STOP_STEADY, STOP_CLOSED };
+
+inline const char* stopReasonName( stopReason r )
+{
+    switch ( r ) {
+        case STOP_SOLVER_ERROR: return "solver-error";
+        case STOP_BLOWUP: return "blow-up";
+        case STOP_COLLAPSE: return "collapse";
+        case STOP_STEADY: return "steady";
+        case STOP_CLOSED: return "closed";
+        default: return "complete";
+    }
+}
+
+struct monitorOptions {
+    double maxNorm;
+    double floor;
+    double steadyTol;
+    double closureTol;
+};
+
+inline void defaultMonitorOptions( monitorOptions* o )
+{
+    o->maxNorm = 0.0;
+    o->floor = 0.0;
+    o->steadyTol = 0.0;
+    o->closureTol = 0.0;
+}
+
+inline bool monitorsActive( const monitorOptions& o )
+{
+    return o.maxNorm > 0.0 || o.floor > 0.0 || o.steadyTol > 0.0 || o.closureTol > 0.0;
+}
+
+class terminationMonitor {
+public:
+    explicit terminationMonitor( const monitorOptions& o ) : o_( o ), active_( monitorsActive( o ) ) {}
+
+    void start( double t, const double y[2], const goodwinParams& p )
+    {
+        p_ = p;
+        reason_ = STOP_COMPLETE;
+        armed_ = false;
+        period_ = 0.0;
+        t0_ = t;
+        y0_[0] = y[0];
+        y0_[1] = y[1];
+        save( t, y );
+    }
+
+    /* Check the sample at t; true if the run should stop here. */
+    bool check( double t, const double y[2] )
+    {
+        if ( !active_ ) return false;
+        double ynorm = std::max( fabs( y[0] ), fabs( y[1] ) );
+        if ( !std::isfinite( y[0] ) || !std::isfinite( y[1] ) || ( o_.maxNorm > 0.0 && ynorm > o_.maxNorm ) ) {
+            reason_ = STOP_BLOWUP;
+            return true;
+        }
+        if ( o_.floor > 0.0 && std::min( y[0], y[1] ) < o_.floor ) {
+            reason_ = STOP_COLLAPSE;
+            return true;
+        }
+        double f[2];
+        func( t, y, f, &p_ );
+        if ( o_.steadyTol > 0.0 && std::max( fabs( f[0] ), fabs( f[1] ) ) <= o_.steadyTol * ( 1.0 + ynorm ) ) {
+            reason_ = STOP_STEADY;
+            return true;
+        }
+        if ( o_.closureTol > 0.0 ) {
+            double d = distance( y );
+            if ( armed_ && closes( t, y, f, d ) ) {
+                reason_ = STOP_CLOSED;
+                return true;
+            }
+            if ( d > 100.0 * o_.closureTol ) armed_ = true;
+        }
+        save( t, y, f );
+        return false;
+    }
+
+    void fail() { reason_ = STOP_SOLVER_ERROR; }
+    stopReason reason() const { return reason_; }
+    double period() const { return period_; }
+
+private:
+    monitorOptions o_;
+    bool active_;
+    goodwinParams p_;
+    stopReason reason_;
+    bool armed_;
+    double t0_, y0_[2];
+    double t_, y_[2], f_[2];    // previous sample
+    double period_;
+
+    double distance( const double y[2] ) const
+    {
+        return std::max( fabs( y[0] - y0_[0] ) / ( 1.0 + fabs( y0_[0] ) ),
+                         fabs( y[1] - y0_[1] ) / ( 1.0 + fabs( y0_[1] ) ) );
+    }
+
+    void save( double t, const double y[2] )
+    {
+        double f[2];
+        func( t, y, f, &p_ );
+        save( t, y, f );
+    }
+
+    void save( double t, const double y[2], const double f[2] )
+    {
+        t_ = t;
+        for ( int k=0; k < 2; k++ ) {
+            y_[k] = y[k];
+            f_[k] = f[k];
+        }
+    }
+
+    /* closest approach to y0 over the interval from the previous sample, if within closureTol */
+    bool closes( double t, const double y[2], const double f[2], double d )
+    {
+        double h = t - t_;
+        double reach = h * std::max( std::max( fabs( f_[0] ), fabs( f[0] ) ) / ( 1.0 + fabs( y0_[0] ) ),
+                                     std::max( fabs( f_[1] ), fabs( f[1] ) ) / ( 1.0 + fabs( y0_[1] ) ) );
+        double dlo = std::min( distance( y_ ), d );
+        if ( dlo - reach > o_.closureTol ) return false;
+        // golden section search for the closest point of the interpolant
+        auto dist = [&]( double s ) {
+            double ys[2] = { hermiteValue( y_[0], f_[0], y[0], f[0], h, s ),
+                             hermiteValue( y_[1], f_[1], y[1], f[1], h, s ) };
+            return distance( ys );
+        };
+        const double g = 0.5 * ( sqrt( 5.0 ) - 1.0 );
+        double a = 0.0, b = 1.0, c = b - g, e = g, dc = dist( c ), de = dist( e );
+        for ( int k=0; k < 40; k++ ) {
+            if ( dc < de ) { b = e; e = c; de = dc; c = b - g*( b - a ); dc = dist( c ); }
+            else { a = c; c = e; dc = de; e = a + g*( b - a ); de = dist( e ); }
+        }
+        double s = 0.5 * ( a + b );
+        if ( dist( s ) > o_.closureTol ) return false;
+        period_ = t_ + s*h - t0_;
+        return true;
+    }
+};
+
+#endif /* GOODWIN_MONITOR_H */
@@ -0,0 +1,190 @@
+/*
+ NUMA topology and CPU pinning for the sweep and ensemble drivers.
+
+ numaTopology() reads the nodes and their cpulists from sysfs,
+   /sys/devices/system/node/node<N>/cpulist
+ keeping only the CPUs this process may run on (taskset, cgroups).  On a
+ machine without NUMA, or without sysfs, it returns one node holding every
+ allowed CPU, so callers need no special case.
+
+ pinToCpus() binds the calling thread (or a process before it starts any
+ threads) to a set of CPUs.  Memory a thread first touches after pinning is
+ then placed on its node by the default local allocation policy.
+
+ pinWorker() places worker thread id of an ensemble: workers are dealt
+ round-robin over the nodes, then over each node's CPUs, so any thread
+ count is spread evenly across sockets.  A worker should pin itself before
+ it allocates its state and output buffers, so they are local to it.
+ nodeTally collects the work each node did for the end-of-run report.
+*/
+
+#ifndef GOODWIN_NUMA_H
+#define GOODWIN_NUMA_H
+
+#include <sched.h>
+#include <dirent.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+
+struct numaNode {
+    int id;
+    std::vector<int> cpus;
+};
+
+/* "0-3,8-11" -> {0,1,2,3,8,9,10,11} */
+inline std::vector<int> parseCpuList( const char* s )
+{
+    std::vector<int> cpus;
+    while ( *s != '\0' && *s != '\n' ) {
+        char * end;
+        long lo = strtol( s, &end, 10 );
+        if ( end == s ) break;
+        long hi = lo;
+        s = end;
+        if ( *s == '-' ) {
+            hi = strtol( s+1, &end, 10 );
+            s = end;
+        }
+        for ( long c=lo; c <= hi; c++ ) cpus.push_back( (int)c );
+        if ( *s == ',' ) s++;
+    }
+    return cpus;
+}
+
+inline std::vector<int> allowedCpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    if ( sched_getaffinity( 0, sizeof(set), &set ) == 0 ) {
+        for ( int c=0; c < CPU_SETSIZE; c++ ) {
+            if ( CPU_ISSET( c, &set ) ) cpus.push_back( c );
+        }
+    }
+    return cpus;
+}
+
+inline std::vector<numaNode> numaTopology()
+{
+    std::vector<numaNode> nodes;
+    std::vector<int> allowed = allowedCpus();
+    DIR * dir = opendir( "/sys/devices/system/node" );
+    if ( dir != NULL ) {
+        struct dirent * e;
+        while ( ( e = readdir( dir ) ) != NULL ) {
+            int id;
+            char extra;
+            if ( sscanf( e->d_name, "node%d%c", &id, &extra ) != 1 ) continue;
+            std::string path = std::string( "/sys/devices/system/node/" ) + e->d_name + "/cpulist";
+            FILE * f = fopen( path.c_str(), "r" );
+            if ( f == NULL ) continue;
+            char line[4096];
+            numaNode node;
+            node.id = id;
+            if ( fgets( line, sizeof(line), f ) != NULL ) {
+                for ( int c : parseCpuList( line ) ) {
+                    if ( std::find( allowed.begin(), allowed.end(), c ) != allowed.end() ) {
+                        node.cpus.push_back( c );
+                    }
+                }
+            }
+            fclose( f );
+            if ( !node.cpus.empty() ) nodes.push_back( node );
+        }
+        closedir( dir );
+    }
+    if ( nodes.empty() ) {
+        numaNode node;
+        node.id = 0;
+        node.cpus = allowed;
+        if ( node.cpus.empty() ) node.cpus.push_back( 0 );
+        nodes.push_back( node );
+    }
+    std::sort( nodes.begin(), nodes.end(),
+               []( const numaNode& x, const numaNode& y ) { return x.id < y.id; } );
+    return nodes;
+}
+
+inline int numaCpuCount( const std::vector<numaNode>& nodes )
+{
+    int n = 0;
+    for ( const numaNode& node : nodes ) n += (int)node.cpus.size();
+    return n;
+}
+
+inline bool pinToCpus( const std::vector<int>& cpus )
+{
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    for ( int c : cpus ) {
+        if ( c >= 0 && c < CPU_SETSIZE ) CPU_SET( c, &set );
+    }
+    return sched_setaffinity( 0, sizeof(set), &set ) == 0;
+}
+
+enum pinMode { PIN_NONE, PIN_CORE, PIN_NODE };
+
+/* "none", "core" or "node"; NULL picks core, or node when threads outnumber CPUs */
+inline bool parsePinMode( const char* s, int nthreads, int ncpus, pinMode* mode )
+{
+    if ( s == NULL ) *mode = ( nthreads <= ncpus ) ? PIN_CORE : PIN_NODE;
+    else if ( strcmp( s, "none" ) == 0 ) *mode = PIN_NONE;
+    else if ( strcmp( s, "core" ) == 0 ) *mode = PIN_CORE;
+    else if ( strcmp( s, "node" ) == 0 ) *mode = PIN_NODE;
+    else return false;
+    return true;
+}
+
+inline const char* pinModeName( pinMode mode )
+{
+    return ( mode == PIN_CORE ) ? "core" : ( mode == PIN_NODE ) ? "node" : "none";
+}
+
+/* Pin the calling worker thread; returns the index into nodes it was placed on. */
+inline int pinWorker( const std::vector<numaNode>& nodes, int id, pinMode mode )
+{
+    int n = id % (int)nodes.size();
+    const std::vector<int>& cpus = nodes[n].cpus;
+    if ( mode == PIN_CORE ) {
+        pinToCpus( std::vector<int>( 1, cpus[( id / nodes.size() ) % cpus.size()] ) );
+    } else if ( mode == PIN_NODE ) {
+        pinToCpus( cpus );
+    }
+    return n;
+}
+
+class nodeTally {
+public:
+    explicit nodeTally( size_t nnodes ) : items_( nnodes, 0 ), workers_( nnodes, 0 ) {}
+
+    void add( int node, long items )
+    {
+        std::lock_guard<std::mutex> guard( lock_ );
+        items_[node] += items;
+        workers_[node]++;
+    }
+
+    long items( int node ) const { return items_[node]; }
+    int workers( int node ) const { return workers_[node]; }
+
+private:
+    std::mutex lock_;
+    std::vector<long> items_;
+    std::vector<int> workers_;
+};
+
+inline void printNodeThroughput( const std::vector<numaNode>& nodes, const nodeTally& tally,
+                                 double seconds, const char* unit )
+{
+    for ( size_t n=0; n < nodes.size(); n++ ) {
+        printf("  node %d (%d workers): %ld %s, %g %s/s\n", nodes[n].id, tally.workers( n ),
+               tally.items( n ), unit, tally.items( n ) / seconds, unit );
+    }
+}
+
+#endif /* GOODWIN_NUMA_H */
@@ -0,0 +1,201 @@
+/*
+ Periodic orbit and equilibrium of the Goodwin wage--output model, solved
+ directly by Newton shooting (goodwin_orbit.h) rather than read off a long
+ transient.
+
+ g++ -Wall -O2 -I/usr/include/ -c goodwin_orbit.cpp &&
+ g++ -L/usr/local/lib goodwin_orbit.o -lgsl -lgslcblas -lpopt -lstdc++fs -o goodwin_orbit
+
+ Prints the equilibrium (a/b, c/r) and its eigenvalues, then the period,
+ Floquet multipliers and Newton steps of the orbit through (w0, Y0), and
+ writes one period of the orbit, npoints + 1 rows, to a .pd file.  The
+ model conserves a first integral, so the orbits are a family of closed
+ curves around the equilibrium (a center: eigenvalues +-i sqrt(ac)), and
+ both multipliers of every orbit are 1.  The monodromy matrix is then a
+ Jordan block, so they come out split by about the square root of the
+ integration tolerance.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <complex>
+
+#include <popt.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <experimental/filesystem>
+
+#include "goodwin.h"
+#include "goodwin_orbit.h"
+
+namespace fs = std::experimental::filesystem;
+
+using namespace std;
+
+#define PROGRAM_NAME "goodwin_orbit"
+#define VERSION 1
+
+struct orbitOptions {
+    double period;      // guess; 0 to estimate from the flow
+    double transient;
+    int npoints;
+    shootingOptions shoot;
+};
+
+static void parseArguments( int argc, const char **argv, goodwinParams* gparams,
+                            orbitOptions* opts, char ** outfile )
+{
+    poptContext optCon;
+    const struct poptOption optionsTable[] = {
+        POPT_AUTOHELP
+        { "r", 'r', POPT_ARG_DOUBLE, &gparams->r, 0,
+            "Set wage appreciation parameter." },
+        { "c", 'c', POPT_ARG_DOUBLE, &gparams->c, 0,
+            "Set wage growth decay rate parameter." },
+        { "a", 'a', POPT_ARG_DOUBLE, &gparams->a, 0,
+            "Set output growth rate parameter." },
+        { "b", 'b', POPT_ARG_DOUBLE, &gparams->b, 0,
+            "Set output depreciation parameter." },
+        { "w0", 'w', POPT_ARG_DOUBLE, &gparams->w0, 0,
+            "Set initial wage share (the orbit's starting guess)." },
+        { "Y0", 'y', POPT_ARG_DOUBLE, &gparams->Y0, 0,
+            "Set initial output level (the orbit's starting guess)." },
+        { "Y0", 'Y', POPT_ARG_DOUBLE, &gparams->Y0, 0,
+            "Set initial output level (the orbit's starting guess)." },
+        { "period", 'T', POPT_ARG_DOUBLE, &opts->period, 0,
+            "Set period guess (default: measured from the flow)." },
+        { "transient", 0, POPT_ARG_DOUBLE, &opts->transient, 0,
+            "Integrate this long before measuring the period guess (default 0)." },
+        { "npoints", 'n', POPT_ARG_INT, &opts->npoints, 0,
+            "Set samples written over one period (default 200)." },
+        { "shoot-tol", 0, POPT_ARG_DOUBLE, &opts->shoot.tol, 0,
+            "Set Newton residual tolerance (default 1e-9)." },
+        { "output", 'o', POPT_ARG_STRING, outfile, 0,
+            "Pandas format CSV file output pathname." },
+        {NULL, 0, 0, NULL, 0, }
+    };
+    optCon = poptGetContext(PROGRAM_NAME, argc, argv, optionsTable, 0);
+    poptReadDefaultConfig(optCon, 0);
+    int err = poptGetNextOpt(optCon);
+    if (err != -1) {
+        fprintf(stderr, "\t%s: %s\n",
+            poptBadOption(optCon, POPT_BADOPTION_NOALIAS),
+            poptStrerror(err));
+        exit(-1);
+    }
+    poptFreeContext(optCon);
+}
+
+static string complexList( const vector< complex<double> >& z )
+{
+    ostringstream s;
+    s << setprecision(10);
+    for ( size_t i=0; i < z.size(); i++ ) {
+        if ( i > 0 ) s << " ";
+        s << z[i].real();
+        if ( z[i].imag() != 0.0 ) s << ( z[i].imag() > 0 ? "+" : "-" ) << fabs( z[i].imag() ) << "i";
+    }
+    return s.str();
+}
+
+int main ( int argc, const char *argv[] )
+{
+    goodwinParams params;
+    defaultParams( &params );
+    orbitOptions opts;
+    opts.period = 0.0;
+    opts.transient = 0.0;
+    opts.npoints = 200;
+    defaultShootingOptions( &opts.shoot );
+    char * pathname = NULL;
+    parseArguments( argc, argv, &params, &opts, &pathname );
+    string outfile = ( pathname != NULL ) ? pathname : "";
+    free( pathname );
+    if ( opts.npoints < 1 ) {
+        fprintf(stderr,"\tnpoints must be positive\n");
+        exit(-1);
+    }
+
+    gsl_odeiv2_system sys = { func, jac, 2, &params };
+    gsl_set_error_handler_off();
+
+    double xe[2] = { params.a / params.b * 1.1, params.c / params.r * 0.9 };
+    vector< complex<double> > eig;
+    string err;
+    if ( findEquilibrium( &sys, xe, &eig, &err ) ) {
+        cout << "Equilibrium w=" << setprecision(10) << xe[0] << " Y=" << xe[1]
+             << " , eigenvalues " << complexList( eig ) << endl;
+    } else {
+        cout << "Equilibrium not found: " << err << endl;
+    }
+
+    double x[2] = { params.w0, params.Y0 };
+    double T = opts.period;
+    if ( !( T > 0.0 ) ) {
+        if ( !estimatePeriod( &sys, x, opts.transient, 1e4, 0.01, &T, &err ) ) {
+            fprintf(stderr,"\tperiod estimate: %s\n",err.c_str());
+            exit(-1);
+        }
+        cout << "Period estimate " << T << endl;
+    }
+    periodicOrbit orbit;
+    if ( !findPeriodicOrbit( &sys, x, T, opts.shoot, &orbit, &err ) ) {
+        fprintf(stderr,"\tshooting: %s\n",err.c_str());
+        exit(-1);
+    }
+    cout << "Period " << setprecision(12) << orbit.period << " after " << orbit.iterations
+         << " Newton steps, residual " << orbit.residual << endl;
+    cout << "Floquet multipliers " << complexList( orbit.multipliers ) << endl;
+
+    vector<double> pts;
+    if ( !orbitPoints( &sys, orbit, opts.npoints, &pts ) ) {
+        fprintf(stderr,"\tintegration along the orbit failed\n");
+        exit(-1);
+    }
+
+    time_t sysTime = time(0);
+    char chTime[80];
+    strftime(chTime,79,"%Y-%m-%d",localtime(&sysTime));
+    string csvfile = strformat("./sim_data/%s_v%d_%s.pd",PROGRAM_NAME,VERSION,chTime);
+    if ( outfile.empty() ) {
+        cout<<"Using default output pathname: '"<< csvfile <<"'"<< endl;
+    } else {
+        csvfile = outfile;
+        cout << "Using outfile pathname set by user: '"<< csvfile <<"'" <<endl;
+    }
+    fs::path dname = fs::path( csvfile ).parent_path();
+    struct stat info;
+    if ( !dname.empty() && stat( dname.c_str(), &info ) != 0 ) {
+        printf(" dir path '%s' does not exist, so\n",dname.c_str());
+        printf(" we will now create this directory for you.\n");
+        int status = mkdir(dname.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+        if ( status == -1 ) printf("Could not mkdir for '%s'\n",dname.c_str());
+    }
+    ofstream pdout( csvfile );
+    if ( !pdout ) {
+        printf("Could not open '%s' for writing\n",csvfile.c_str());
+        return -1;
+    }
+    pdout << "# Goodwin model periodic orbit." << endl;
+    pdout << "# r="<< params.r << " , c=" << params.c
+       << " , a=" << params.a << " , b=" << params.b
+       << " , w0="<< orbit.x0[0] << " , Y0=" << orbit.x0[1] << endl;
+    pdout << "# period=" << setprecision(12) << orbit.period
+       << " , multipliers=" << complexList( orbit.multipliers )
+       << " , equilibrium=" << xe[0] << " " << xe[1] << endl;
+    pdout << "time,wages,output" << endl;
+    pdout << fixed << setprecision(6);
+    for ( int k=0; k <= opts.npoints; k++ ) {
+        pdout << setw(12) << k * orbit.period / opts.npoints << ","
+              << setw(12) << pts[2*k] << "," << setw(12) << pts[2*k+1] << endl;
+    }
+    pdout.close();
+    cout<< "Done.  See output in "<< csvfile <<endl;
+    return 0;
+}
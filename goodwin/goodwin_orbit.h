@@ -0,0 +1,344 @@
+/*
+ Equilibria and periodic orbits by Newton's method on any gsl_odeiv2_system
+ with a jacobian, in place of long transient integrations.
+
+ findEquilibrium() -- Newton on f(x) = 0.  The eigenvalues of the Jacobian
+    at the solution tell its stability.
+
+ findPeriodicOrbit() -- single shooting.  The unknowns are a point x0 on
+    the orbit and the period T, the equations
+        phi(T, x0) - x0 = 0          the orbit closes
+        f(xr) . (x0 - xr) = 0        x0 lies on the plane through the
+                                     guess xr normal to the flow there
+    phi(T, x0) and the monodromy matrix M = d phi / d x0 come from one
+    integration of the system together with its variational equations
+    dPhi/dt = J(x(t)) Phi, Phi(0) = I, so a Newton step costs one period.
+    The Newton matrix
+        [ M - I     f(phi(T, x0)) ]
+        [ f(xr)'          0       ]
+    is solved by SVD, dropping singular values below SHOOT_RCOND times the
+    largest.  For an isolated limit cycle, such as van der Pol's, it is
+    regular and Newton converges quadratically, typically in 3-6 periods.
+    The Goodwin model is conservative: its orbits form a family, the matrix
+    is singular along it, and the minimum norm step converges to the member
+    of the family nearest the guess.
+
+    The eigenvalues of M are the Floquet multipliers.  One is always 1 (a
+    shift along the orbit); the orbit is stable if the rest lie inside the
+    unit circle.
+
+ estimatePeriod() -- a starting guess: after a transient, the time to the
+    next crossing of the plane through the current point normal to the flow.
+
+ orbitPoints() -- npts + 1 samples of one period, starting and ending at x0.
+*/
+
+#ifndef GOODWIN_ORBIT_H
+#define GOODWIN_ORBIT_H
+
+#include <cmath>
+#include <complex>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_linalg.h>
+#include <gsl/gsl_eigen.h>
+#include <gsl/gsl_odeiv2.h>
+
+#include "goodwin.h"
+
+static const double SHOOT_RCOND = 1e-9;
+
+struct shootingOptions {
+    double tol;         // Newton stops when the residual norm is below tol
+    int maxIter;
+    double epsabs;      // integration tolerances for each shot
+    double epsrel;
+};
+
+inline void defaultShootingOptions( shootingOptions* o )
+{
+    o->tol = 1e-9;
+    o->maxIter = 25;
+    o->epsabs = 1e-11;
+    o->epsrel = 1e-11;
+}
+
+struct periodicOrbit {
+    std::vector<double> x0;                         // a point on the orbit
+    double period;
+    std::vector<double> monodromy;                  // n x n, row major
+    std::vector< std::complex<double> > multipliers;  // by decreasing modulus
+    int iterations;
+    double residual;
+};
+
+/* Eigenvalues of the n x n row major matrix A, by decreasing modulus. */
+inline bool eigenvalues( const std::vector<double>& A, size_t n, std::vector< std::complex<double> >* ev )
+{
+    gsl_matrix * m = gsl_matrix_alloc( n, n );
+    for ( size_t i=0; i < n; i++ ) {
+        for ( size_t j=0; j < n; j++ ) gsl_matrix_set( m, i, j, A[i*n+j] );
+    }
+    gsl_vector_complex * e = gsl_vector_complex_alloc( n );
+    gsl_eigen_nonsymm_workspace * w = gsl_eigen_nonsymm_alloc( n );
+    int status = gsl_eigen_nonsymm( m, e, w );
+    ev->clear();
+    for ( size_t i=0; i < n && status == GSL_SUCCESS; i++ ) {
+        gsl_complex z = gsl_vector_complex_get( e, i );
+        ev->push_back( std::complex<double>( GSL_REAL( z ), GSL_IMAG( z ) ) );
+    }
+    std::sort( ev->begin(), ev->end(),
+               []( const std::complex<double>& x, const std::complex<double>& y ) { return std::abs( x ) > std::abs( y ); } );
+    gsl_eigen_nonsymm_free( w );
+    gsl_vector_complex_free( e );
+    gsl_matrix_free( m );
+    return status == GSL_SUCCESS;
+}
+
+/*
+ Least squares, minimum norm solution of the m x n system A x = b (m >= n,
+ A row major), ignoring singular values below SHOOT_RCOND times the largest.
+*/
+inline bool svdSolve( const std::vector<double>& A, const std::vector<double>& b, size_t m, size_t n,
+                      std::vector<double>* x )
+{
+    gsl_matrix * U = gsl_matrix_alloc( m, n );
+    gsl_matrix * V = gsl_matrix_alloc( n, n );
+    gsl_vector * S = gsl_vector_alloc( n );
+    gsl_vector * work = gsl_vector_alloc( n );
+    gsl_vector * bv = gsl_vector_alloc( m );
+    gsl_vector * xv = gsl_vector_alloc( n );
+    for ( size_t i=0; i < m; i++ ) {
+        for ( size_t j=0; j < n; j++ ) gsl_matrix_set( U, i, j, A[i*n+j] );
+        gsl_vector_set( bv, i, b[i] );
+    }
+    int status = gsl_linalg_SV_decomp( U, V, S, work );
+    if ( status == GSL_SUCCESS ) {
+        double smax = gsl_vector_get( S, 0 );
+        for ( size_t i=0; i < n; i++ ) {
+            if ( gsl_vector_get( S, i ) < SHOOT_RCOND * smax ) gsl_vector_set( S, i, 0.0 );
+        }
+        status = gsl_linalg_SV_solve( U, V, S, bv, xv );
+    }
+    x->resize( n );
+    for ( size_t i=0; i < n; i++ ) {
+        (*x)[i] = gsl_vector_get( xv, i );
+        if ( !std::isfinite( (*x)[i] ) ) status = GSL_EDOM;
+    }
+    gsl_vector_free( xv );
+    gsl_vector_free( bv );
+    gsl_vector_free( work );
+    gsl_vector_free( S );
+    gsl_matrix_free( V );
+    gsl_matrix_free( U );
+    return status == GSL_SUCCESS;
+}
+
+/* The system and its variational equations, as one system of n + n*n equations. */
+struct variationalParams {
+    const gsl_odeiv2_system * sys;
+    std::vector<double> J;
+    std::vector<double> dfdt;
+};
+
+inline int variationalFunc( double t, const double z[], double dz[], void* params )
+{
+    variationalParams * v = (variationalParams*)params;
+    size_t n = v->sys->dimension;
+    int status = v->sys->function( t, z, dz, v->sys->params );
+    if ( status != GSL_SUCCESS ) return status;
+    status = v->sys->jacobian( t, z, v->J.data(), v->dfdt.data(), v->sys->params );
+    if ( status != GSL_SUCCESS ) return status;
+    const double * Phi = z + n;
+    double * dPhi = dz + n;
+    for ( size_t i=0; i < n; i++ ) {
+        for ( size_t j=0; j < n; j++ ) {
+            double s = 0.0;
+            for ( size_t k=0; k < n; k++ ) s += v->J[i*n+k] * Phi[k*n+j];
+            dPhi[i*n+j] = s;
+        }
+    }
+    return GSL_SUCCESS;
+}
+
+/* xT = phi(T, x0), and with M != NULL the monodromy d phi / d x0; returns a GSL status. */
+inline int flowMap( const gsl_odeiv2_system* sys, const double* x0, double T, double* xT, double* M,
+                    double epsabs, double epsrel )
+{
+    size_t n = sys->dimension;
+    variationalParams vp = { sys, std::vector<double>( n*n ), std::vector<double>( n ) };
+    gsl_odeiv2_system aug = { variationalFunc, NULL, n + n*n, &vp };
+    std::vector<double> z( ( M != NULL ) ? n + n*n : n, 0.0 );
+    std::copy( x0, x0 + n, z.begin() );
+    if ( M != NULL ) {
+        for ( size_t i=0; i < n; i++ ) z[n + i*n + i] = 1.0;
+    }
+    gsl_odeiv2_driver * d = gsl_odeiv2_driver_alloc_y_new( ( M != NULL ) ? &aug : sys,
+                                                           gsl_odeiv2_step_rk8pd, 1e-6, epsabs, epsrel );
+    double t = 0.0;
+    int status = gsl_odeiv2_driver_apply( d, &t, T, z.data() );
+    gsl_odeiv2_driver_free( d );
+    std::copy( z.begin(), z.begin() + n, xT );
+    if ( M != NULL ) std::copy( z.begin() + n, z.end(), M );
+    return status;
+}
+
+/* Newton from x toward f(x) = 0; on success x is the equilibrium and ev the Jacobian's eigenvalues. */
+inline bool findEquilibrium( const gsl_odeiv2_system* sys, double* x, std::vector< std::complex<double> >* ev,
+                             std::string* err, double tol = 1e-12, int maxIter = 50 )
+{
+    size_t n = sys->dimension;
+    std::vector<double> f( n ), J( n*n ), dfdt( n ), dx, ftry( n ), xtry( n );
+    sys->function( 0.0, x, f.data(), sys->params );
+    double res = 0.0;
+    for ( double v : f ) res = std::max( res, std::fabs( v ) );
+    for ( int it=0; it < maxIter && res > tol; it++ ) {
+        sys->jacobian( 0.0, x, J.data(), dfdt.data(), sys->params );
+        for ( double& v : f ) v = -v;
+        if ( !svdSolve( J, f, n, n, &dx ) ) break;
+        // halve the step while it does not reduce the residual
+        double lambda = 1.0, restry = res;
+        for ( int k=0; k < 30; k++, lambda *= 0.5 ) {
+            for ( size_t i=0; i < n; i++ ) xtry[i] = x[i] + lambda * dx[i];
+            sys->function( 0.0, xtry.data(), ftry.data(), sys->params );
+            restry = 0.0;
+            for ( double v : ftry ) restry = std::max( restry, std::fabs( v ) );
+            if ( restry < res ) break;
+        }
+        if ( !( restry < res ) ) break;
+        std::copy( xtry.begin(), xtry.end(), x );
+        f = ftry;
+        res = restry;
+    }
+    if ( !( res <= tol ) ) {
+        *err = strformat( "Newton stalled at |f| = %g", res );
+        return false;
+    }
+    sys->jacobian( 0.0, x, J.data(), dfdt.data(), sys->params );
+    return eigenvalues( J, n, ev );
+}
+
+/*
+ Integrate x through a transient of length transient, then find the time
+ until the flow next crosses, in the same direction, the plane through
+ the new x normal to f(x), sampling every dt up to tmax.  x is left at
+ the start of that lap.
+*/
+inline bool estimatePeriod( const gsl_odeiv2_system* sys, double* x, double transient, double tmax,
+                            double dt, double* T, std::string* err )
+{
+    size_t n = sys->dimension;
+    if ( transient > 0.0 && flowMap( sys, x, transient, x, NULL, 1e-9, 1e-9 ) != GSL_SUCCESS ) {
+        *err = "transient integration failed";
+        return false;
+    }
+    std::vector<double> fa( n ), y( x, x + n );
+    sys->function( 0.0, x, fa.data(), sys->params );
+    auto g = [&]( const std::vector<double>& z ) {
+        double s = 0.0;
+        for ( size_t i=0; i < n; i++ ) s += fa[i] * ( z[i] - x[i] );
+        return s;
+    };
+    gsl_odeiv2_driver * d = gsl_odeiv2_driver_alloc_y_new( sys, gsl_odeiv2_step_rk8pd, 1e-6, 1e-9, 1e-9 );
+    double t = 0.0, gprev = 0.0;
+    bool found = false;
+    for ( long k=1; k * dt <= tmax; k++ ) {
+        if ( gsl_odeiv2_driver_apply( d, &t, k * dt, y.data() ) != GSL_SUCCESS ) break;
+        double gk = g( y );
+        if ( gprev < 0.0 && gk >= 0.0 ) {
+            *T = t - dt * gk / ( gk - gprev );
+            found = true;
+            break;
+        }
+        gprev = gk;
+    }
+    gsl_odeiv2_driver_free( d );
+    if ( !found ) *err = strformat( "no return to the start within t = %g", tmax );
+    return found;
+}
+
+/* Shoot from (guess, Tguess) to a periodic orbit. */
+inline bool findPeriodicOrbit( const gsl_odeiv2_system* sys, const double* guess, double Tguess,
+                               const shootingOptions& o, periodicOrbit* orbit, std::string* err )
+{
+    size_t n = sys->dimension;
+    std::vector<double> x( guess, guess + n ), xr( guess, guess + n ), fr( n ), xT( n ), fT( n );
+    std::vector<double> M( n*n ), A( ( n+1 ) * ( n+1 ) ), r( n+1 ), dz;
+    double T = Tguess;
+    sys->function( 0.0, xr.data(), fr.data(), sys->params );
+    for ( int it=0; it <= o.maxIter; it++ ) {
+        if ( !( T > 0.0 ) ) {
+            *err = strformat( "period went non-positive (%g) at Newton step %d", T, it );
+            return false;
+        }
+        int status = flowMap( sys, x.data(), T, xT.data(), M.data(), o.epsabs, o.epsrel );
+        if ( status != GSL_SUCCESS ) {
+            *err = strformat( "integration failed at Newton step %d, status %d", it, status );
+            return false;
+        }
+        double res = 0.0, phase = 0.0;
+        for ( size_t i=0; i < n; i++ ) {
+            r[i] = xT[i] - x[i];
+            phase += fr[i] * ( x[i] - xr[i] );
+            res += r[i] * r[i];
+        }
+        r[n] = phase;
+        res = sqrt( res + phase * phase );
+        if ( res < o.tol ) {
+            orbit->x0 = x;
+            orbit->period = T;
+            orbit->monodromy = M;
+            orbit->iterations = it;
+            orbit->residual = res;
+            if ( !eigenvalues( M, n, &orbit->multipliers ) ) {
+                *err = "eigenvalues of the monodromy matrix did not converge";
+                return false;
+            }
+            return true;
+        }
+        if ( it == o.maxIter ) {
+            *err = strformat( "no convergence in %d Newton steps, residual %g", o.maxIter, res );
+            return false;
+        }
+        sys->function( 0.0, xT.data(), fT.data(), sys->params );
+        for ( size_t i=0; i < n; i++ ) {
+            for ( size_t j=0; j < n; j++ ) A[i*(n+1)+j] = M[i*n+j] - ( i == j ? 1.0 : 0.0 );
+            A[i*(n+1)+n] = fT[i];
+            A[n*(n+1)+i] = fr[i];
+            r[i] = -r[i];
+        }
+        A[n*(n+1)+n] = 0.0;
+        r[n] = -r[n];
+        if ( !svdSolve( A, r, n+1, n+1, &dz ) ) {
+            *err = strformat( "singular Newton matrix at step %d", it );
+            return false;
+        }
+        for ( size_t i=0; i < n; i++ ) x[i] += dz[i];
+        T += dz[n];
+    }
+    return false;
+}
+
+/* npts + 1 states at t = k T / npts, k = 0 .. npts, row major n per state. */
+inline bool orbitPoints( const gsl_odeiv2_system* sys, const periodicOrbit& orbit, int npts,
+                         std::vector<double>* pts, double epsabs = 1e-10, double epsrel = 1e-10 )
+{
+    size_t n = sys->dimension;
+    std::vector<double> y( orbit.x0 );
+    pts->assign( y.begin(), y.end() );
+    gsl_odeiv2_driver * d = gsl_odeiv2_driver_alloc_y_new( sys, gsl_odeiv2_step_rk8pd, 1e-6, epsabs, epsrel );
+    double t = 0.0;
+    int status = GSL_SUCCESS;
+    for ( int k=1; k <= npts && status == GSL_SUCCESS; k++ ) {
+        status = gsl_odeiv2_driver_apply( d, &t, k * orbit.period / npts, y.data() );
+        pts->insert( pts->end(), y.begin(), y.begin() + n );
+    }
+    gsl_odeiv2_driver_free( d );
+    return status == GSL_SUCCESS;
+}
+
+#endif /* GOODWIN_ORBIT_H */
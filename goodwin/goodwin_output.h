@@ -0,0 +1,367 @@
+/*
+ Output stages for goodwin trajectory samples.
+
+ trajectoryDecimator -- error-bounded thinning of a (t, w, Y) sample stream.
+    Linear interpolation between the kept samples reproduces every dropped
+    sample to within an absolute tolerance in both w and Y.  It is a
+    "swing door" filter: from the last kept sample (the anchor) it tracks,
+    per component, the interval of slopes that still passes within tol of
+    every sample seen since.  A new sample is absorbed while its own slope
+    from the anchor lies inside all the intervals, otherwise the previous
+    sample is kept as the new anchor.  That is O(1) work per sample and one
+    pending sample of memory, whatever the run length.
+
+ formatDouble / formatRow -- double to text with std::to_chars, either
+    fixed notation padded like setw(w) << fixed << setprecision(p), or the
+    shortest text that reads back to the same double.  No locale, no stream
+    state, no allocation: text goes straight into the caller's buffer.
+
+ asyncWriter -- file output on a background thread.  The solver formats
+    rows straight into one of a small pool of preallocated buffers.  Full
+    buffers go to the writer thread through a lock-free single-producer /
+    single-consumer ring, and come back empty through a second ring, so
+    integration and disk I/O overlap and the solver only waits when every
+    buffer is queued for the disk.
+*/
+
+#ifndef GOODWIN_OUTPUT_H
+#define GOODWIN_OUTPUT_H
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+class trajectoryDecimator {
+public:
+    explicit trajectoryDecimator( double tol )
+        : tol_(tol), haveAnchor_(false), havePending_(false), seen_(0), kept_(0),
+          at_(0.0), ay_{0.0, 0.0}, pt_(0.0), py_{0.0, 0.0}, lo_{0.0, 0.0}, hi_{0.0, 0.0} {}
+
+    long seen() const { return seen_; }
+    long kept() const { return kept_; }
+
+    /* Feed one sample; emit(t, y) is called for every sample that is kept. */
+    template <class Emit>
+    void push( double t, const double y[2], Emit emit )
+    {
+        seen_++;
+        if ( !haveAnchor_ ) {
+            setAnchor( t, y );
+            emit( t, y );
+            return;
+        }
+        if ( havePending_ ) {
+            double dt = t - at_;
+            bool inside = true;
+            for ( int k=0; k < 2; k++ ) {
+                double s = ( y[k] - ay_[k] ) / dt;
+                if ( s < lo_[k] || s > hi_[k] ) inside = false;
+            }
+            if ( !inside ) {
+                setAnchor( pt_, py_ );
+                emit( pt_, py_ );
+                havePending_ = false;
+            }
+        }
+        // the sample becomes pending, and further segments must pass near it
+        double dt = t - at_;
+        for ( int k=0; k < 2; k++ ) {
+            double lo = ( y[k] - tol_ - ay_[k] ) / dt;
+            double hi = ( y[k] + tol_ - ay_[k] ) / dt;
+            if ( havePending_ ) {
+                lo_[k] = std::max( lo_[k], lo );
+                hi_[k] = std::min( hi_[k], hi );
+            } else {
+                lo_[k] = lo;
+                hi_[k] = hi;
+            }
+        }
+        pt_ = t;
+        py_[0] = y[0];
+        py_[1] = y[1];
+        havePending_ = true;
+    }
+
+    /* Emit the final pending sample, so the last sample is always kept. */
+    template <class Emit>
+    void finish( Emit emit )
+    {
+        if ( havePending_ ) {
+            setAnchor( pt_, py_ );
+            emit( pt_, py_ );
+            havePending_ = false;
+        }
+    }
+
+private:
+    void setAnchor( double t, const double y[2] )
+    {
+        at_ = t;
+        ay_[0] = y[0];
+        ay_[1] = y[1];
+        haveAnchor_ = true;
+        kept_++;
+    }
+
+    double tol_;
+    bool haveAnchor_;
+    bool havePending_;
+    long seen_;
+    long kept_;
+    double at_, ay_[2];          // anchor (last kept) sample
+    double pt_, py_[2];          // pending (latest absorbed) sample
+    double lo_[2], hi_[2];       // admissible slopes from the anchor
+};
+
+/* longest formatted row: three fixed notation doubles can each run to ~330 chars */
+#define ROW_MAX 1024
+/* most decimals accepted for fixed notation, keeping rows inside ROW_MAX */
+#define PRECISION_MAX 17
+
+struct textFormat {
+    int precision;   // decimals in fixed notation, or < 0 for shortest round-trip
+    int width;       // minimum field width, right aligned (fixed notation only)
+};
+
+/*
+ Fixed notation for moderate |x| by integer arithmetic: x*10^p is rounded
+ to an integer and its digits written out.  The product carries an error
+ far below 0.01, so the rounding can only go wrong when the fraction is
+ within 0.01 of one half; those cases, and anything large, return NULL for
+ std::to_chars to handle exactly.
+*/
+inline char* formatFixedFast( char* tmp, double x, int precision )
+{
+    static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+    if ( precision > 9 || !( std::fabs( x ) < 1e12 / pow10[precision > 9 ? 9 : precision] ) ) return NULL;
+    double r = std::fabs( x ) * pow10[precision];
+    double fl = std::floor( r );
+    double frac = r - fl;
+    if ( std::fabs( frac - 0.5 ) < 0.01 ) return NULL;
+    unsigned long long n = (unsigned long long)fl + ( frac > 0.5 ? 1 : 0 );
+    char digits[24];
+    int nd = 0;
+    do {
+        digits[nd++] = (char)( '0' + n % 10 );
+        n /= 10;
+    } while ( n > 0 );
+    while ( nd <= precision ) digits[nd++] = '0';    // at least one integer digit
+    char * q = tmp;
+    if ( std::signbit( x ) ) *q++ = '-';
+    for ( int k=nd-1; k >= 0; k-- ) {
+        if ( k == precision - 1 ) *q++ = '.';
+        *q++ = digits[k];
+    }
+    return q;
+}
+
+/* Append x at p and return the new end; p needs room for ~340 chars. */
+inline char* formatDouble( char* p, double x, const textFormat& f )
+{
+    char tmp[400];
+    char * end = ( f.precision >= 0 ) ? formatFixedFast( tmp, x, f.precision ) : NULL;
+    if ( end == NULL ) {
+        std::to_chars_result r = ( f.precision >= 0 )
+            ? std::to_chars( tmp, tmp + sizeof(tmp), x, std::chars_format::fixed, f.precision )
+            : std::to_chars( tmp, tmp + sizeof(tmp), x );
+        end = r.ptr;
+    }
+    int n = (int)( end - tmp );
+    if ( f.precision >= 0 && n < f.width ) {
+        memset( p, ' ', f.width - n );
+        p += f.width - n;
+    }
+    memcpy( p, tmp, n );
+    return p + n;
+}
+
+/* "t<sep>w<sep>Y\n" at p; returns the number of chars written (< ROW_MAX). */
+inline size_t formatRow( char* p, const textFormat& f, const char* sep,
+                         double t, const double y[2] )
+{
+    char * q = p;
+    size_t nsep = strlen( sep );
+    q = formatDouble( q, t, f );
+    memcpy( q, sep, nsep );
+    q += nsep;
+    q = formatDouble( q, y[0], f );
+    memcpy( q, sep, nsep );
+    q += nsep;
+    q = formatDouble( q, y[1], f );
+    *q++ = '\n';
+    return q - p;
+}
+
+/*
+ Bounded lock-free queue for exactly one producer thread and one consumer
+ thread.  N must be a power of two.
+*/
+template <class T, size_t N>
+class spscQueue {
+public:
+    spscQueue() : head_(0), tail_(0) {}
+
+    bool push( const T& x )
+    {
+        size_t t = tail_.load( std::memory_order_relaxed );
+        if ( t - head_.load( std::memory_order_acquire ) == N ) return false;
+        items_[t & ( N-1 )] = x;
+        tail_.store( t+1, std::memory_order_release );
+        return true;
+    }
+
+    bool pop( T* x )
+    {
+        size_t h = head_.load( std::memory_order_relaxed );
+        if ( h == tail_.load( std::memory_order_acquire ) ) return false;
+        *x = items_[h & ( N-1 )];
+        head_.store( h+1, std::memory_order_release );
+        return true;
+    }
+
+private:
+    T items_[N];
+    alignas(64) std::atomic<size_t> head_;
+    alignas(64) std::atomic<size_t> tail_;
+};
+
+class asyncWriter {
+public:
+    explicit asyncWriter( size_t bufsize = 1 << 20, int nbuf = 4 )
+        : fd_(-1), bufsize_(bufsize), cur_(-1), used_(0), done_(false),
+          err_(0), bytes_(0), stall_(0.0)
+    {
+        if ( nbuf > MAXBUF ) nbuf = MAXBUF;
+        bufs_.resize( nbuf );
+        for ( int k=0; k < nbuf; k++ ) bufs_[k].resize( bufsize );
+    }
+    ~asyncWriter() { close(); }
+
+    bool open( const std::string& path )
+    {
+        fd_ = ::open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+        if ( fd_ < 0 ) return false;
+        for ( int k=0; k < (int)bufs_.size(); k++ ) free_.push( k );
+        free_.pop( &cur_ );
+        used_ = 0;
+        done_ = false;
+        writer_ = std::thread( &asyncWriter::drain, this );
+        return true;
+    }
+
+    /* Space for at least n bytes; follow with commit() of what was used. */
+    char* reserve( size_t n )
+    {
+        if ( used_ + n > bufsize_ ) flush();
+        return &bufs_[cur_][used_];
+    }
+    void commit( size_t n ) { used_ += n; }
+
+    void write( const char* data, size_t n )
+    {
+        while ( n > 0 ) {
+            if ( used_ == bufsize_ ) flush();
+            size_t m = std::min( n, bufsize_ - used_ );
+            memcpy( &bufs_[cur_][used_], data, m );
+            used_ += m;
+            data += m;
+            n -= m;
+        }
+    }
+    void write( const std::string& s ) { write( s.data(), s.size() ); }
+
+    /* Drain everything, stop the writer thread and close the file. */
+    bool close()
+    {
+        if ( fd_ < 0 ) return err_ == 0;
+        if ( used_ > 0 ) flush();
+        done_.store( true, std::memory_order_release );
+        writer_.join();
+        if ( ::close( fd_ ) != 0 && err_ == 0 ) err_ = errno;
+        fd_ = -1;
+        return err_ == 0;
+    }
+
+    int error() const { return err_; }
+    long long bytes() const { return bytes_; }
+    /* seconds the producer spent waiting for a free buffer */
+    double stallSeconds() const { return stall_; }
+
+private:
+    enum { MAXBUF = 16 };
+    struct chunk {
+        int buf;
+        size_t len;
+    };
+
+    /* hand the current buffer to the writer and take a free one */
+    void flush()
+    {
+        chunk c = { cur_, used_ };
+        while ( !full_.push( c ) ) std::this_thread::yield();
+        if ( !free_.pop( &cur_ ) ) {
+            auto start = std::chrono::steady_clock::now();
+            while ( !free_.pop( &cur_ ) ) std::this_thread::yield();
+            stall_ += std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+        }
+        used_ = 0;
+    }
+
+    void drain()
+    {
+        chunk c;
+        while ( true ) {
+            if ( full_.pop( &c ) ) {
+                writeChunk( c );
+            } else if ( done_.load( std::memory_order_acquire ) ) {
+                // the last chunk was queued before done_ was set
+                if ( !full_.pop( &c ) ) break;
+                writeChunk( c );
+            } else {
+                std::this_thread::sleep_for( std::chrono::microseconds( 50 ) );
+            }
+        }
+    }
+
+    void writeChunk( const chunk& c )
+    {
+        const char * p = bufs_[c.buf].data();
+        size_t n = c.len;
+        while ( n > 0 && err_ == 0 ) {
+            ssize_t w = ::write( fd_, p, n );
+            if ( w < 0 ) {
+                if ( errno == EINTR ) continue;
+                err_ = errno;
+                break;
+            }
+            p += w;
+            n -= w;
+            bytes_ += w;
+        }
+        free_.push( c.buf );
+    }
+
+    int fd_;
+    size_t bufsize_;
+    std::vector<std::vector<char>> bufs_;
+    spscQueue<chunk, MAXBUF> full_;    // solver -> writer
+    spscQueue<int, MAXBUF> free_;      // writer -> solver
+    int cur_;
+    size_t used_;
+    std::thread writer_;
+    std::atomic<bool> done_;
+    int err_;
+    long long bytes_;
+    double stall_;
+};
+
+#endif /* GOODWIN_OUTPUT_H */
@@ -0,0 +1,272 @@
+/*
+ Parareal: parallel in time integration of one long trajectory.
+
+ The run's output grid is cut into slices, and two propagators carry a
+ state across a slice:
+   coarse G   classical RK4 with a fixed step coarseDt, cheap and serial
+   fine F     the run's own integrator (rk8pd or a native stepper at the
+              run's tolerances), stepping through every output time
+ A serial coarse sweep gives first guesses U_k at the slice starts.  Each
+ iteration then runs F from every U_k at once, one slice per thread, and
+ corrects the starts in a serial sweep
+     U_k+1 <- G( U_k new ) + F( U_k old ) - G( U_k old )
+ until no start moves by more than tol: by default the fine solver's own
+ step tolerance epsabs + epsrel |y|, the accuracy the serial run holds its
+ steps to.  After k iterations the first k slices are exact, so the
+ iteration cannot take more than one per slice; the speedup over the
+ serial run is at most slices / (iterations + 1), the + 1 being the
+ output pass.
+
+ The output pass integrates slices again from the converged starts, in
+ chunks of PARAREAL_CHUNK outputs so that memory stays bounded: a window
+ of chunks is filled in parallel and handed over in order.  Chunks after
+ the first in a slice start from states recorded in the last fine sweep,
+ which began from starts within tol of the final ones, so the output may
+ step by up to about tol there, as it may at the slice boundaries.
+
+ The conservative Goodwin orbit is a hard case for Parareal: nothing damps
+ the coarse propagator's phase error, which grows along the run.  On the
+ default orbit, which passes within 0.03 of the w = 0 axis, RK4 at 0.1 has
+ lost the phase entirely by t = 1000 and the iteration only converges by
+ running out of slices; at the default 0.02 it stays in phase, and 10^5
+ outputs converge to 1e-6 in 7 iterations over 8 slices and 6 over 64.
+ The coarse sweep is serial and G costs about as much per unit time as F
+ there, so the speedup is well short of the bound; --coarse-dt trades the
+ two.
+*/
+
+#ifndef GOODWIN_PARAREAL_H
+#define GOODWIN_PARAREAL_H
+
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include "goodwin.h"
+#include "goodwin_rk.h"
+#include "goodwin_grid.h"
+
+static const long PARAREAL_CHUNK = 1 << 14;    // outputs per task of the output pass
+
+struct pararealOptions {
+    int slices;         // 0: one per thread
+    int threads;        // 0: all cores
+    double tol;         // 0: epsabs + epsrel |y| of the fine solver
+    double coarseDt;
+    int maxIter;        // 0: one per slice, where Parareal is exact
+};
+
+inline void defaultPararealOptions( pararealOptions* o )
+{
+    o->slices = 0;
+    o->threads = 0;
+    o->tol = 0.0;
+    o->coarseDt = 0.02;
+    o->maxIter = 0;
+}
+
+struct pararealReport {
+    int slices;
+    int threads;
+    int iterations;
+    bool converged;
+    std::vector<double> correction;     // per iteration: largest move of a slice start
+    std::vector<double> wall;           // per iteration: seconds since the start
+    double fineSecs;    // the first fine sweep done serially, about the serial run's cost
+    double totalSecs;   // iterations and output pass
+};
+
+/* Fixed step classical RK4 from t0 to t1, in steps of at most dt. */
+inline void rk4Coarse( const goodwinParams& p, double t0, double t1, double dt, double y[2] )
+{
+    long n = std::max( 1L, (long)ceil( ( t1 - t0 ) / dt ) );
+    double h = ( t1 - t0 ) / n, t = t0;
+    void* pp = (void*)&p;
+    for ( long s=0; s < n; s++ ) {
+        double k1[2], k2[2], k3[2], k4[2], yt[2];
+        func( t, y, k1, pp );
+        for ( int c=0; c < 2; c++ ) yt[c] = y[c] + 0.5*h*k1[c];
+        func( t + 0.5*h, yt, k2, pp );
+        for ( int c=0; c < 2; c++ ) yt[c] = y[c] + 0.5*h*k2[c];
+        func( t + 0.5*h, yt, k3, pp );
+        for ( int c=0; c < 2; c++ ) yt[c] = y[c] + h*k3[c];
+        func( t + h, yt, k4, pp );
+        for ( int c=0; c < 2; c++ ) y[c] += h/6.0 * ( k1[c] + 2.0*k2[c] + 2.0*k3[c] + k4[c] );
+        t = t0 + ( s + 1 ) * h;
+    }
+}
+
+/*
+ Integrate the whole grid by Parareal and hand every output, in order, to
+ sample( t, y ), which returns false to stop the run.  False on a failure
+ of the fine solver, with *err set.
+*/
+template <class Sample>
+bool pararealRun( stepperKind kind, double epsabs, double epsrel, const goodwinParams& p,
+                  const timeGrid& grid, const pararealOptions& o, pararealReport* rep,
+                  std::string* err, Sample sample )
+{
+    auto start = std::chrono::steady_clock::now();
+    auto since = [&start]() {
+        return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    };
+    long N = grid.size();
+    int threads = ( o.threads > 0 ) ? o.threads : std::max( 1u, std::thread::hardware_concurrency() );
+    int S = ( o.slices > 0 ) ? o.slices : threads;
+    S = (int)std::min( (long)S, N );
+    threads = std::min( threads, S );
+    int maxIter = ( o.maxIter > 0 ) ? std::min( o.maxIter, S ) : S;
+    rep->slices = S;
+    rep->threads = threads;
+    rep->iterations = 0;
+    rep->converged = false;
+    rep->correction.clear();
+    rep->wall.clear();
+    rep->fineSecs = 0.0;
+
+    // slice k runs from output b[k] to b[k+1]; output 0 is the initial point
+    std::vector<long> b( S + 1 );
+    for ( int k=0; k <= S; k++ ) b[k] = (long)( (double)k * N / S );
+    auto timeAt = [&grid]( long i ) { return ( i == 0 ) ? grid.tStart : grid.time( i ); };
+
+    std::vector<double> U( 2 * ( S + 1 ) ), G( 2 * S ), F( 2 * S );
+    std::vector<double> secs( S, 0.0 );
+    std::vector< std::vector<double> > chunkStart( S );     // from the last fine sweep
+    std::vector<int> failed( S, 0 );
+    U[0] = p.w0;
+    U[1] = p.Y0;
+    for ( int k=0; k < S; k++ ) {
+        double y[2] = { U[2*k], U[2*k+1] };
+        rk4Coarse( p, timeAt( b[k] ), timeAt( b[k+1] ), o.coarseDt, y );
+        G[2*k] = U[2*k+2] = y[0];
+        G[2*k+1] = U[2*k+3] = y[1];
+    }
+
+    auto fine = [&]( goodwinIntegrator& solver, int k ) {
+        auto t0 = std::chrono::steady_clock::now();
+        solver.reset( p );
+        failed[k] = 0;
+        double t = timeAt( b[k] ), y[2] = { U[2*k], U[2*k+1] };
+        std::vector<double>& cs = chunkStart[k];
+        cs.clear();
+        for ( long i=b[k]+1; i <= b[k+1]; i++ ) {
+            if ( ( i - 1 - b[k] ) % PARAREAL_CHUNK == 0 ) {
+                cs.push_back( y[0] );
+                cs.push_back( y[1] );
+            }
+            if ( solver.apply( &t, grid.time( i ), y ) != GSL_SUCCESS || !std::isfinite( y[0] + y[1] ) ) {
+                failed[k] = 1;
+                break;
+            }
+        }
+        F[2*k] = y[0];
+        F[2*k+1] = y[1];
+        secs[k] = std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count();
+    };
+    // slices before first are exact and keep their last fine result
+    auto sweep = [&]( int first ) {
+        std::atomic<int> next( first );
+        auto worker = [&]() {
+            goodwinIntegrator solver( kind, epsabs, epsrel );
+            int k;
+            while ( ( k = next.fetch_add( 1 ) ) < S ) fine( solver, k );
+        };
+        std::vector<std::thread> workers;
+        for ( int id=0; id < threads; id++ ) workers.push_back( std::thread( worker ) );
+        for ( std::thread& th : workers ) th.join();
+    };
+
+    for ( int it=1; it <= maxIter; it++ ) {
+        sweep( it - 1 );
+        // a slice whose start is still far off may fail; it just gets no fine correction yet
+        if ( failed[it-1] ) {
+            int k = it - 1;
+            *err = strformat( "fine solver failed in slice %d (t = %g to %g)", k, timeAt( b[k] ), timeAt( b[k+1] ) );
+            rep->totalSecs = since();
+            return false;
+        }
+        if ( it == 1 ) {
+            for ( int k=0; k < S; k++ ) rep->fineSecs += secs[k];
+        }
+        double moved = 0.0;
+        bool within = true;
+        for ( int k=it-1; k < S; k++ ) {
+            double y[2] = { U[2*k], U[2*k+1] };
+            rk4Coarse( p, timeAt( b[k] ), timeAt( b[k+1] ), o.coarseDt, y );
+            for ( int c=0; c < 2; c++ ) {
+                double u = failed[k] ? y[c] : y[c] + F[2*k+c] - G[2*k+c];
+                double d = fabs( u - U[2*k+2+c] );
+                double tol = ( o.tol > 0.0 ) ? o.tol : epsabs + epsrel * fabs( u );
+                if ( d > tol || failed[k] ) within = false;
+                moved = std::max( moved, d );
+                G[2*k+c] = y[c];
+                U[2*k+2+c] = u;
+            }
+        }
+        rep->iterations = it;
+        rep->correction.push_back( moved );
+        rep->wall.push_back( since() );
+        if ( within || it == S ) {    // after one iteration per slice every start is exact
+            rep->converged = true;
+            break;
+        }
+    }
+
+    // output pass: windows of chunks, filled in parallel and handed over in order
+    struct chunk { int k; long i0, i1; const double* y0; };
+    std::vector<chunk> chunks;
+    for ( int k=0; k < S; k++ ) {
+        for ( long i0=b[k], j=0; i0 < b[k+1]; i0 += PARAREAL_CHUNK, j++ ) {
+            const double* y0 = ( j == 0 ) ? &U[2*k] : &chunkStart[k][2*j];
+            chunks.push_back( { k, i0, std::min( i0 + PARAREAL_CHUNK, b[k+1] ), y0 } );
+        }
+    }
+    size_t window = 4 * threads;
+    std::vector< std::vector<double> > rows( window );
+    for ( size_t w0=0; w0 < chunks.size(); w0 += window ) {
+        size_t w1 = std::min( w0 + window, chunks.size() );
+        std::atomic<size_t> next( w0 );
+        std::atomic<int> bad( 0 );
+        auto worker = [&]() {
+            goodwinIntegrator solver( kind, epsabs, epsrel );
+            size_t c;
+            while ( ( c = next.fetch_add( 1 ) ) < w1 ) {
+                const chunk& ch = chunks[c];
+                std::vector<double>& r = rows[c - w0];
+                r.resize( 2 * ( ch.i1 - ch.i0 ) );
+                solver.reset( p );
+                double t = timeAt( ch.i0 ), y[2] = { ch.y0[0], ch.y0[1] };
+                for ( long i=ch.i0+1; i <= ch.i1; i++ ) {
+                    if ( solver.apply( &t, grid.time( i ), y ) != GSL_SUCCESS ) bad = 1;
+                    r[2*( i - ch.i0 - 1 )] = y[0];
+                    r[2*( i - ch.i0 - 1 ) + 1] = y[1];
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        for ( int id=0; id < threads; id++ ) workers.push_back( std::thread( worker ) );
+        for ( std::thread& th : workers ) th.join();
+        if ( bad ) {
+            *err = strformat( "fine solver failed in the output pass after t = %g", timeAt( chunks[w0].i0 ) );
+            return false;
+        }
+        for ( size_t c=w0; c < w1; c++ ) {
+            const chunk& ch = chunks[c];
+            const std::vector<double>& r = rows[c - w0];
+            for ( long i=ch.i0+1; i <= ch.i1; i++ ) {
+                if ( !sample( grid.time( i ), &r[2*( i - ch.i0 - 1 )] ) ) {
+                    rep->totalSecs = since();
+                    return true;
+                }
+            }
+        }
+    }
+    rep->totalSecs = since();
+    return true;
+}
+
+#endif /* GOODWIN_PARAREAL_H */
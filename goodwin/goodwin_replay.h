@@ -0,0 +1,153 @@
+/*
+ Cycle replay: integrate one revolution of a closed orbit, then serve any
+ later time by phase lookup instead of integrating on.
+
+ The Goodwin model is conservative, so the orbit through (w0, Y0) closes
+ and every later revolution retraces the first.  cycleReplay::record()
+ integrates from (w0, Y0) at tight tolerances, keeping (y, dy/dt) every
+ REPLAY_SPACING, until the closure monitor of goodwin_monitor.h sees the
+ trajectory come back.  The period is then refined to where the stored
+ trajectory crosses the plane through (w0, Y0) normal to the flow there,
+ and sample( t ) interpolates the stored cycle at phase (t - t0) mod T
+ with the same cubic Hermite interpolant the monitors use, good to about
+ REPLAY_SPACING^4.  A run of N outputs then costs one period of
+ integration plus N lookups.
+
+ Two errors are left, both reported: closure, the relative distance
+ between the start and the state one period later (the integration
+ error over a revolution, a jump replayed once per cycle), and the
+ period itself, whose error shifts the phase by that much per cycle.
+ Models without a closed orbit through the initial point (a limit cycle
+ approached from off it, a spiral) fail to record within maxTime, and
+ the run should be integrated normally.
+*/
+
+#ifndef GOODWIN_REPLAY_H
+#define GOODWIN_REPLAY_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "goodwin.h"
+#include "goodwin_rk.h"
+#include "goodwin_fate.h"
+#include "goodwin_monitor.h"
+
+static const double REPLAY_SPACING = 0.01;    // stored samples, in model time
+static const double REPLAY_EPS = 1e-11;       // epsabs and epsrel of the recorded cycle
+static const double REPLAY_CLOSURE_TOL = 1e-6;
+
+class cycleReplay {
+public:
+    cycleReplay() : period_( 0.0 ), closure_( 0.0 ) {}
+
+    /* Integrate from (p.w0, p.Y0) at t0 until the orbit closes, at most maxTime. */
+    bool record( stepperKind kind, const goodwinParams& p, double t0, double maxTime, std::string* err )
+    {
+        goodwinIntegrator solver( kind, REPLAY_EPS, REPLAY_EPS );
+        solver.reset( p );
+        monitorOptions mo;
+        defaultMonitorOptions( &mo );
+        mo.closureTol = REPLAY_CLOSURE_TOL;
+        terminationMonitor monitor( mo );
+        params_ = p;
+        t0_ = t0;
+        double t = t0, y[2] = { p.w0, p.Y0 };
+        monitor.start( t, y, p );
+        y_.clear();
+        f_.clear();
+        push( t, y );
+        bool closed = false;
+        for ( long n=1; ; n++ ) {
+            if ( n * REPLAY_SPACING > maxTime ) {
+                *err = strformat( "the orbit did not close within t = %g", maxTime );
+                return false;
+            }
+            if ( solver.apply( &t, t0 + n * REPLAY_SPACING, y ) != GSL_SUCCESS ) {
+                *err = strformat( "integration failed at t = %g", t );
+                return false;
+            }
+            push( t, y );
+            if ( closed ) break;    // one sample past the closure, so phase < T is always inside
+            if ( monitor.check( t, y ) ) {
+                if ( monitor.reason() != STOP_CLOSED ) {
+                    *err = strformat( "run stopped (%s) at t = %g", stopReasonName( monitor.reason() ), t );
+                    return false;
+                }
+                period_ = monitor.period();
+                closed = true;
+            }
+        }
+        refinePeriod();
+        double yT[2];
+        sample( t0_ + period_, yT );
+        closure_ = std::max( fabs( yT[0] - p.w0 ) / ( 1.0 + fabs( p.w0 ) ),
+                             fabs( yT[1] - p.Y0 ) / ( 1.0 + fabs( p.Y0 ) ) );
+        return true;
+    }
+
+    /* The state at time t >= t0, from the stored cycle. */
+    void sample( double t, double y[2] ) const
+    {
+        double phase = fmod( t - t0_, period_ );
+        if ( phase < 0.0 ) phase += period_;
+        if ( t - t0_ == period_ ) phase = period_;    // record()'s own check of the closure
+        long k = std::min( (long)( phase / REPLAY_SPACING ), (long)size() - 2 );
+        double s = phase / REPLAY_SPACING - k;
+        for ( int c=0; c < 2; c++ ) {
+            y[c] = hermiteValue( y_[2*k+c], f_[2*k+c], y_[2*k+2+c], f_[2*k+2+c], REPLAY_SPACING, s );
+        }
+    }
+
+    double period() const { return period_; }
+    double closure() const { return closure_; }
+    size_t size() const { return y_.size() / 2; }
+
+private:
+    goodwinParams params_;
+    double t0_;
+    std::vector<double> y_, f_;     // (w, Y) and their slopes every REPLAY_SPACING
+    double period_;
+    double closure_;
+
+    void push( double t, const double y[2] )
+    {
+        double f[2];
+        func( t, y, f, &params_ );
+        y_.push_back( y[0] );
+        y_.push_back( y[1] );
+        f_.push_back( f[0] );
+        f_.push_back( f[1] );
+    }
+
+    /*
+     Newton on g(T) = ( y(T) - y0 ) . f(y0), the crossing of the section
+     through y0 normal to the flow, along the stored samples.
+    */
+    void refinePeriod()
+    {
+        const double* y0 = &y_[0];
+        const double* f0 = &f_[0];
+        for ( int it=0; it < 20; it++ ) {
+            double phase = period_;
+            long k = std::min( (long)( phase / REPLAY_SPACING ), (long)size() - 2 );
+            double s = phase / REPLAY_SPACING - k, h = REPLAY_SPACING, g = 0.0, dg = 0.0;
+            for ( int c=0; c < 2; c++ ) {
+                double a = y_[2*k+c], fa = f_[2*k+c], b = y_[2*k+2+c], fb = f_[2*k+2+c];
+                double v = hermiteValue( a, fa, b, fb, h, s );
+                // d/dt of the interpolant
+                double s2 = s*s;
+                double dv = ( ( 6*s2 - 6*s )*a + ( 3*s2 - 4*s + 1 )*h*fa + ( -6*s2 + 6*s )*b + ( 3*s2 - 2*s )*h*fb ) / h;
+                g += ( v - y0[c] ) * f0[c];
+                dg += dv * f0[c];
+            }
+            if ( dg == 0.0 ) break;
+            double step = g / dg;
+            period_ -= step;
+            if ( fabs( step ) < 1e-15 * period_ ) break;
+        }
+    }
+};
+
+#endif /* GOODWIN_REPLAY_H */
@@ -0,0 +1,469 @@
+/*
+ Native embedded Runge--Kutta steppers for small ODE systems.
+
+ rkSolver<Tableau, N> integrates an N dimensional system with fixed size
+ stage arrays held in the object, so a step allocates nothing and every
+ loop has a compile time trip count the compiler can unroll.  Tableaux:
+
+   bs3     Bogacki--Shampine 3(2), 4 stages, FSAL
+   dp5     Dormand--Prince 5(4), 7 stages, FSAL
+   tsit5   Tsitouras 5(4), 7 stages, FSAL
+   vern6   Verner 6(5) (the DVERK pair), 8 stages
+   vern9   Verner 9(8), 16 stages, for tight tolerances
+
+ FSAL ("first same as last") tableaux evaluate their last stage at the new
+ solution, so it is the first stage of the next step and each accepted step
+ costs one evaluation less.  The coefficients are checked against the order
+ conditions for every rooted tree up to the stated order.
+
+ Step size control is the PI controller of Hairer, Norsett & Wanner, with
+ the error measured in the RMS norm relative to epsabs + epsrel*|y|.
+ apply() has the calling convention of gsl_odeiv2_driver_apply: it steps
+ exactly to t1 and returns GSL_SUCCESS, GSL_EMAXITER or GSL_FAILURE.
+
+ goodwinIntegrator selects at run time between these and the GSL rk8pd
+ solverContext for the goodwin model; systemIntegrator does the same for
+ any gsl_odeiv2_system.
+*/
+
+#ifndef GOODWIN_RK_H
+#define GOODWIN_RK_H
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_odeiv2.h>
+
+#include "goodwin.h"
+#include "goodwin_solver.h"
+
+struct bs3Tableau {
+    static constexpr const char* name = "bs3";
+    static constexpr int stages = 4;
+    static constexpr int errOrder = 2;     // order of the embedded solution
+    static constexpr bool fsal = true;
+    static constexpr double c[4] = { 0.0, 1.0/2, 3.0/4, 1.0 };
+    static constexpr double a[4][4] = {
+        { 0 },
+        { 1.0/2 },
+        { 0.0, 3.0/4 },
+        { 2.0/9, 1.0/3, 4.0/9 } };
+    static constexpr double b[4] = { 2.0/9, 1.0/3, 4.0/9, 0.0 };
+    // b - bhat
+    static constexpr double e[4] = { 2.0/9 - 7.0/24, 1.0/3 - 1.0/4, 4.0/9 - 1.0/3, -1.0/8 };
+};
+
+struct dp5Tableau {
+    static constexpr const char* name = "dp5";
+    static constexpr int stages = 7;
+    static constexpr int errOrder = 4;
+    static constexpr bool fsal = true;
+    static constexpr double c[7] = { 0.0, 1.0/5, 3.0/10, 4.0/5, 8.0/9, 1.0, 1.0 };
+    static constexpr double a[7][7] = {
+        { 0 },
+        { 1.0/5 },
+        { 3.0/40, 9.0/40 },
+        { 44.0/45, -56.0/15, 32.0/9 },
+        { 19372.0/6561, -25360.0/2187, 64448.0/6561, -212.0/729 },
+        { 9017.0/3168, -355.0/33, 46732.0/5247, 49.0/176, -5103.0/18656 },
+        { 35.0/384, 0.0, 500.0/1113, 125.0/192, -2187.0/6784, 11.0/84 } };
+    static constexpr double b[7] = { 35.0/384, 0.0, 500.0/1113, 125.0/192, -2187.0/6784, 11.0/84, 0.0 };
+    static constexpr double e[7] = {
+        35.0/384 - 5179.0/57600, 0.0, 500.0/1113 - 7571.0/16695, 125.0/192 - 393.0/640,
+        -2187.0/6784 + 92097.0/339200, 11.0/84 - 187.0/2100, -1.0/40 };
+};
+
+/* Ch. Tsitouras, Comput. Math. Appl. 62 (2011) 770-775 */
+struct tsit5Tableau {
+    static constexpr const char* name = "tsit5";
+    static constexpr int stages = 7;
+    static constexpr int errOrder = 4;
+    static constexpr bool fsal = true;
+    static constexpr double c[7] = { 0.0, 0.161, 0.327, 0.9, 0.9800255409045097, 1.0, 1.0 };
+    static constexpr double a[7][7] = {
+        { 0 },
+        { 0.161 },
+        { -0.008480655492356989, 0.335480655492357 },
+        { 2.897153057105493, -6.359448489975075, 4.3622954328695815 },
+        { 5.325864828439257, -11.748883564062828, 7.4955393428898365, -0.09249506636175525 },
+        { 5.86145544294642, -12.92096931784711, 8.159367898576159, -0.071584973281401,
+          -0.028269050394068383 },
+        { 0.09646076681806523, 0.01, 0.4798896504144996, 1.379008574103742,
+          -3.290069515436081, 2.324710524099774 } };
+    static constexpr double b[7] = { 0.09646076681806523, 0.01, 0.4798896504144996, 1.379008574103742,
+                                     -3.290069515436081, 2.324710524099774, 0.0 };
+    static constexpr double e[7] = { -0.00178001105222577714, -0.0008164344596567469,
+                                     0.007880878010261995, -0.1447110071732629, 0.5823571654525552,
+                                     -0.45808210592918697, 1.0/66 };
+};
+
+/* J.H. Verner, SIAM J. Numer. Anal. 15 (1978) 772-790, as used in DVERK */
+struct vern6Tableau {
+    static constexpr const char* name = "vern6";
+    static constexpr int stages = 8;
+    static constexpr int errOrder = 5;
+    static constexpr bool fsal = false;
+    static constexpr double c[8] = { 0.0, 1.0/6, 4.0/15, 2.0/3, 5.0/6, 1.0, 1.0/15, 1.0 };
+    static constexpr double a[8][8] = {
+        { 0 },
+        { 1.0/6 },
+        { 4.0/75, 16.0/75 },
+        { 5.0/6, -8.0/3, 5.0/2 },
+        { -165.0/64, 55.0/6, -425.0/64, 85.0/96 },
+        { 12.0/5, -8.0, 4015.0/612, -11.0/36, 88.0/255 },
+        { -8263.0/15000, 124.0/75, -643.0/680, -81.0/250, 2484.0/10625, 0.0 },
+        { 3501.0/1720, -300.0/43, 297275.0/52632, -319.0/2322, 24068.0/84065, 0.0, 3850.0/26703 } };
+    static constexpr double b[8] = { 3.0/40, 0.0, 875.0/2244, 23.0/72, 264.0/1955, 0.0,
+                                     125.0/11592, 43.0/616 };
+    static constexpr double e[8] = { 3.0/40 - 13.0/160, 0.0, 875.0/2244 - 2375.0/5984, 23.0/72 - 5.0/16,
+                                     264.0/1955 - 12.0/85, -3.0/44, 125.0/11592, 43.0/616 };
+};
+
+/*
+ J.H. Verner, "Numerically optimal Runge-Kutta pairs with interpolants",
+ Numer. Algorithms 53 (2010) 383-396: the most efficient 9(8) pair, to 16
+ digits, at which the order conditions hold to 1e-14.  The last stage is
+ only used by the embedded 8th order solution.
+*/
+struct vern9Tableau {
+    static constexpr const char* name = "vern9";
+    static constexpr int stages = 16;
+    static constexpr int errOrder = 8;
+    static constexpr bool fsal = false;
+    static constexpr double c[16] = { 0.0, 0.03462, 0.09702435063878045, 0.14553652595817068, 0.561,
+                                      0.22900791159048503, 0.544992088409515, 0.645, 0.48375, 0.06757,
+                                      0.25, 0.6590650618730999, 0.8206, 0.9012, 1.0, 1.0 };
+    static constexpr double a[16][16] = {
+        { 0 },
+        { 0.03462 },
+        { -0.03893354388572873, 0.13595789452450918 },
+        { 0.03638413148954267, 0.0, 0.10915239446862804 },
+        { 2.0257639143939694, 0.0, -7.638023836496291, 6.173259922102322 },
+        { 0.05112275589406061, 0.0, 0.0, 0.17708237945550218, 0.0008027762409222536 },
+        { 0.13160063579752163, 0.0, 0.0, -0.2957276252669636, 0.08781378035642955, 0.6213052975225274 },
+        { 0.07166666666666667, 0.0, 0.0, 0.0, 0.0, 0.33055335789153195, 0.2427799754418014 },
+        { 0.071806640625, 0.0, 0.0, 0.0, 0.0, 0.3294380283228177, 0.1165190029271823, -0.034013671875 },
+        { 0.04836757646340646, 0.0, 0.0, 0.0, 0.0, 0.03928989925676164, 0.10547409458903446,
+          -0.021438652846483126, -0.10412291746271944 },
+        { -0.026645614872014785, 0.0, 0.0, 0.0, 0.0, 0.03333333333333333, -0.1631072244872467,
+          0.03396081684127761, 0.1572319413814626, 0.21522674780318796 },
+        { 0.03689009248708622, 0.0, 0.0, 0.0, 0.0, -0.1465181576725543, 0.2242577768172024,
+          0.02294405717066073, -0.0035850052905728597, 0.08669223316444385, 0.43838406519683376 },
+        { -0.4866012215113341, 0.0, 0.0, 0.0, 0.0, -6.304602650282853, -0.2812456182894729,
+          -2.679019236219849, 0.5188156639241577, 1.3653531876033418, 5.885091088503946,
+          2.8028087862720628 },
+        { 0.4185367457753472, 0.0, 0.0, 0.0, 0.0, 6.724547581906459, -0.42544428016461133,
+          3.3432791530012653, 0.6170816631175374, -0.9299661239399329, -6.099948804751011,
+          -3.002206187889399, 0.2553202529443446 },
+        { -0.7793740861228848, 0.0, 0.0, 0.0, 0.0, -13.937342538107776, 1.2520488533793563,
+          -14.691500408016868, -0.494705058533141, 2.2429749091462368, 13.367893803828643,
+          14.396650486650687, -0.79758133317768, 0.4409353709534278 },
+        { 2.0580513374668867, 0.0, 0.0, 0.0, 0.0, 22.357937727968032, 0.9094981099755646,
+          35.89110098240264, -3.442515027624454, -4.865481358036369, -18.909803813543427,
+          -34.26354448030452, 1.2647565216956427 } };
+    static constexpr double b[16] = { 0.014611976858423152, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+                                      -0.3915211862331339, 0.23109325002895065, 0.12747667699928525,
+                                      0.2246434176204158, 0.5684352689748513, 0.058258715572158275,
+                                      0.13643174034822156, 0.030570139830827976, 0.0 };
+    // b - bhat
+    static constexpr double e[16] = { -0.005357988290444577, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+                                      -2.583020491182464, 0.14252253154686628, 0.013420653512688688,
+                                      -0.028672962914094935, 2.624999655215792, -0.2825509643291527,
+                                      0.13643174034822156, 0.030570139830827976, -0.04834231373823958 };
+};
+
+template <class Tab, int N>
+class rkSolver {
+public:
+    explicit rkSolver( double hstart = 1e-6, double epsabs = 1e-6, double epsrel = 0.0,
+                       long maxSteps = 100000000 )
+        : hstart_(hstart), epsabs_(epsabs), epsrel_(epsrel), maxSteps_(maxSteps),
+          evals_(0), accepted_(0), rejected_(0)
+    {
+        reset();
+    }
+
+    /* Forget the step size history, as for a new run. */
+    void reset()
+    {
+        h_ = hstart_;
+        errOld_ = 1e-4;
+        k0Valid_ = false;
+        tk0_ = 0.0;
+        memset( k_, 0, sizeof(k_) );
+        memset( yk0_, 0, sizeof(yk0_) );
+    }
+
+    /*
+     One step of size h from (t, y) to ynew, without step size control;
+     returns the error estimate in units of the tolerance.
+    */
+    template <class F>
+    double step( const F& f, double t, double h, const double y[N], double ynew[N] )
+    {
+        if ( !k0Valid_ || t != tk0_ || memcmp( y, yk0_, sizeof(yk0_) ) != 0 ) {
+            f( t, y, k_[0] );
+            evals_++;
+            tk0_ = t;
+            memcpy( yk0_, y, sizeof(yk0_) );
+            k0Valid_ = true;
+        }
+        double ytmp[N];
+        for ( int s=1; s < Tab::stages; s++ ) {
+            for ( int i=0; i < N; i++ ) {
+                double sum = 0.0;
+                for ( int j=0; j < s; j++ ) sum += Tab::a[s][j] * k_[j][i];
+                ytmp[i] = y[i] + h * sum;
+            }
+            f( t + Tab::c[s] * h, ytmp, k_[s] );
+            evals_++;
+        }
+        double err = 0.0;
+        for ( int i=0; i < N; i++ ) {
+            double sum = 0.0, esum = 0.0;
+            for ( int j=0; j < Tab::stages; j++ ) {
+                sum += Tab::b[j] * k_[j][i];
+                esum += Tab::e[j] * k_[j][i];
+            }
+            ynew[i] = Tab::fsal ? ytmp[i] : y[i] + h * sum;
+            double sc = epsabs_ + epsrel_ * std::max( std::fabs( y[i] ), std::fabs( ynew[i] ) );
+            double ei = h * esum / sc;
+            err += ei * ei;
+        }
+        return std::sqrt( err / N );
+    }
+
+    /* Adaptive steps from *t exactly to t1 > *t, updating *t and y. */
+    template <class F>
+    int apply( const F& f, double* t, double t1, double y[N] )
+    {
+        const double safe = 0.9, facmin = 0.2, facmax = 10.0;
+        const double beta = 0.2 / ( Tab::errOrder + 1 );
+        const double expo = 1.0 / ( Tab::errOrder + 1 ) - 0.75 * beta;
+        double ynew[N];
+        while ( *t < t1 ) {
+            if ( accepted_ + rejected_ >= maxSteps_ ) return GSL_EMAXITER;
+            double h = h_;
+            bool last = false;
+            if ( *t + h >= t1 ) {
+                h = t1 - *t;
+                last = true;
+            }
+            double err = step( f, *t, h, y, ynew );
+            double fac1 = std::pow( std::max( err, 1e-300 ), expo );
+            if ( err <= 1.0 ) {
+                double fac = fac1 / std::pow( errOld_, beta ) / safe;
+                fac = std::min( 1.0 / facmin, std::max( 1.0 / facmax, fac ) );
+                double hnew = h / fac;
+                errOld_ = std::max( err, 1e-4 );
+                *t = last ? t1 : *t + h;
+                memcpy( y, ynew, sizeof(ynew) );
+                if ( Tab::fsal ) {
+                    memcpy( k_[0], k_[Tab::stages-1], sizeof(k_[0]) );
+                    tk0_ = *t;
+                    memcpy( yk0_, y, sizeof(yk0_) );
+                } else {
+                    k0Valid_ = false;
+                }
+                // a step cut short to land on t1 says little about the natural step size
+                if ( !last || hnew < h ) h_ = hnew;
+                accepted_++;
+            } else {
+                h_ = h / std::min( 1.0 / facmin, fac1 / safe );
+                rejected_++;
+                if ( !( h_ > std::fabs( *t ) * 1e-15 ) ) return GSL_FAILURE;
+            }
+        }
+        return GSL_SUCCESS;
+    }
+
+    long evals() const { return evals_; }
+    long accepted() const { return accepted_; }
+    long rejected() const { return rejected_; }
+
+private:
+    double hstart_, epsabs_, epsrel_;
+    long maxSteps_;
+    double h_;
+    double errOld_;
+    double k_[Tab::stages][N];
+    bool k0Valid_;              // k_[0] holds f(tk0_, yk0_)
+    double tk0_, yk0_[N];
+    long evals_, accepted_, rejected_;
+};
+
+/* The goodwin right hand side as a functor the native steppers can inline. */
+struct goodwinRhs {
+    const goodwinParams * p;
+    void operator()( double t, const double* y, double* f ) const
+    {
+        func( t, y, f, (void*)p );
+    }
+};
+
+enum stepperKind { STEPPER_RK8PD, STEPPER_BS3, STEPPER_DP5, STEPPER_TSIT5, STEPPER_VERN6, STEPPER_VERN9 };
+
+inline bool parseStepper( const char* s, stepperKind* kind )
+{
+    if ( s == NULL || strcmp( s, "rk8pd" ) == 0 ) *kind = STEPPER_RK8PD;
+    else if ( strcmp( s, bs3Tableau::name ) == 0 ) *kind = STEPPER_BS3;
+    else if ( strcmp( s, dp5Tableau::name ) == 0 ) *kind = STEPPER_DP5;
+    else if ( strcmp( s, tsit5Tableau::name ) == 0 ) *kind = STEPPER_TSIT5;
+    else if ( strcmp( s, vern6Tableau::name ) == 0 ) *kind = STEPPER_VERN6;
+    else if ( strcmp( s, vern9Tableau::name ) == 0 ) *kind = STEPPER_VERN9;
+    else return false;
+    return true;
+}
+
+inline const char* stepperName( stepperKind kind )
+{
+    switch ( kind ) {
+        case STEPPER_BS3: return bs3Tableau::name;
+        case STEPPER_DP5: return dp5Tableau::name;
+        case STEPPER_TSIT5: return tsit5Tableau::name;
+        case STEPPER_VERN6: return vern6Tableau::name;
+        case STEPPER_VERN9: return vern9Tableau::name;
+        default: return "rk8pd";
+    }
+}
+
+/* The native steppers behind one run time choice, for a right hand side F. */
+template <int N, class F>
+class nativeStepper {
+public:
+    nativeStepper( stepperKind kind, double hstart, double epsabs, double epsrel )
+        : kind_(kind), bs3_( hstart, epsabs, epsrel ), dp5_( hstart, epsabs, epsrel ),
+          tsit5_( hstart, epsabs, epsrel ), vern6_( hstart, epsabs, epsrel ),
+          vern9_( hstart, epsabs, epsrel ) {}
+
+    void reset()
+    {
+        switch ( kind_ ) {
+            case STEPPER_BS3: bs3_.reset(); break;
+            case STEPPER_DP5: dp5_.reset(); break;
+            case STEPPER_TSIT5: tsit5_.reset(); break;
+            case STEPPER_VERN6: vern6_.reset(); break;
+            case STEPPER_VERN9: vern9_.reset(); break;
+            default: break;
+        }
+    }
+
+    int apply( const F& f, double* t, double t1, double y[N] )
+    {
+        switch ( kind_ ) {
+            case STEPPER_BS3: return bs3_.apply( f, t, t1, y );
+            case STEPPER_DP5: return dp5_.apply( f, t, t1, y );
+            case STEPPER_TSIT5: return tsit5_.apply( f, t, t1, y );
+            case STEPPER_VERN6: return vern6_.apply( f, t, t1, y );
+            case STEPPER_VERN9: return vern9_.apply( f, t, t1, y );
+            default: return GSL_EINVAL;
+        }
+    }
+
+private:
+    stepperKind kind_;
+    rkSolver<bs3Tableau, N> bs3_;
+    rkSolver<dp5Tableau, N> dp5_;
+    rkSolver<tsit5Tableau, N> tsit5_;
+    rkSolver<vern6Tableau, N> vern6_;
+    rkSolver<vern9Tableau, N> vern9_;
+};
+
+/*
+ The goodwin model on a stepper chosen at run time.  rk8pd runs on a GSL
+ solverContext of its own, the rest are native.  A caller that runs one
+ integrator after another on a thread can pass shared, usually
+ &threadSolver(), for rk8pd to reuse instead; it is used only when its
+ tolerances are epsabs and epsrel, and no two integrators on it may be
+ live at once.
+*/
+class goodwinIntegrator {
+public:
+    explicit goodwinIntegrator( stepperKind kind, double epsabs = 1e-6, double epsrel = 0.0,
+                                solverContext* shared = NULL )
+        : kind_(kind), rhs_{ &params_ }, native_( kind, 1e-6, epsabs, epsrel )
+    {
+        defaultParams( &params_ );
+        if ( kind != STEPPER_RK8PD ) gsl_ = NULL;
+        else if ( shared != NULL && shared->epsabs() == epsabs && shared->epsrel() == epsrel ) gsl_ = shared;
+        else {
+            own_.reset( new solverContext( gsl_odeiv2_step_rk8pd, 1e-6, epsabs, epsrel ) );
+            gsl_ = own_.get();
+        }
+    }
+    // rhs_ points at params_
+    goodwinIntegrator( const goodwinIntegrator& ) = delete;
+    goodwinIntegrator& operator=( const goodwinIntegrator& ) = delete;
+
+    void reset( const goodwinParams& p )
+    {
+        params_ = p;
+        if ( gsl_ != NULL ) gsl_->reset( p );
+        else native_.reset();
+    }
+
+    int apply( double* t, double t1, double y[2] )
+    {
+        return ( gsl_ != NULL ) ? gsl_->apply( t, t1, y ) : native_.apply( rhs_, t, t1, y );
+    }
+
+private:
+    stepperKind kind_;
+    goodwinParams params_;
+    goodwinRhs rhs_;
+    nativeStepper<2, goodwinRhs> native_;
+    solverContext * gsl_;
+    std::unique_ptr<solverContext> own_;
+};
+
+/* Any gsl_odeiv2_system as a right hand side for the native steppers. */
+struct gslRhs {
+    const gsl_odeiv2_system * sys;
+    void operator()( double t, const double* y, double* f ) const
+    {
+        sys->function( t, y, f, sys->params );
+    }
+};
+
+/*
+ An N dimensional gsl_odeiv2_system on a stepper chosen at run time, so
+ programs with their own models can use the native steppers and the
+ autotuner.  The system must outlive the integrator.
+*/
+template <int N>
+class systemIntegrator {
+public:
+    systemIntegrator( const gsl_odeiv2_system* sys, stepperKind kind,
+                      double epsabs = 1e-6, double epsrel = 0.0, double hstart = 1e-6 )
+        : kind_(kind), hstart_(hstart), rhs_{ sys }, native_( kind, hstart, epsabs, epsrel ), d_(NULL)
+    {
+        if ( kind == STEPPER_RK8PD ) {
+            d_ = gsl_odeiv2_driver_alloc_y_new( sys, gsl_odeiv2_step_rk8pd, hstart, epsabs, epsrel );
+        }
+    }
+    ~systemIntegrator() { if ( d_ != NULL ) gsl_odeiv2_driver_free( d_ ); }
+    systemIntegrator( const systemIntegrator& ) = delete;
+    systemIntegrator& operator=( const systemIntegrator& ) = delete;
+
+    void reset()
+    {
+        if ( d_ != NULL ) gsl_odeiv2_driver_reset_hstart( d_, hstart_ );
+        else native_.reset();
+    }
+
+    int apply( double* t, double t1, double y[N] )
+    {
+        return ( d_ != NULL ) ? gsl_odeiv2_driver_apply( d_, t, t1, y ) : native_.apply( rhs_, t, t1, y );
+    }
+
+private:
+    stepperKind kind_;
+    double hstart_;
+    gslRhs rhs_;
+    nativeStepper<N, gslRhs> native_;
+    gsl_odeiv2_driver * d_;
+};
+
+#endif /* GOODWIN_RK_H */
@@ -0,0 +1,64 @@
+/*
+ Counter-based random numbers for the ensemble programs.
+
+ Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3",
+ SC11) maps a 128 bit counter and a 64 bit key to 128 random bits.  There is
+ no generator state to carry around: the normals for path p at step n are a
+ pure function of (seed, p, n), so any thread can produce them, in any
+ order, and get the same answer.
+*/
+
+#ifndef GOODWIN_RNG_H
+#define GOODWIN_RNG_H
+
+#include <cstdint>
+#include <cmath>
+
+struct philox4x32 {
+    uint32_t v[4];
+};
+
+inline philox4x32 philox4x32_10( const uint32_t ctr[4], const uint32_t key[2] )
+{
+    uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    for ( int round=0; round < 10; round++ ) {
+        uint64_t p0 = (uint64_t)0xD2511F53u * c0;
+        uint64_t p1 = (uint64_t)0xCD9E8D57u * c2;
+        uint32_t hi0 = (uint32_t)( p0 >> 32 ), lo0 = (uint32_t)p0;
+        uint32_t hi1 = (uint32_t)( p1 >> 32 ), lo1 = (uint32_t)p1;
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+    philox4x32 out = { { c0, c1, c2, c3 } };
+    return out;
+}
+
+/* 32 random bits to a uniform deviate in the open interval (0,1) */
+inline double u01( uint32_t x )
+{
+    return ( x + 0.5 ) * ( 1.0 / 4294967296.0 );
+}
+
+/*
+ Two independent standard normals for stream (seed, index, step), by
+ Box--Muller on the first two words of one Philox block.
+*/
+inline void philoxNormal2( uint64_t seed, uint64_t index, uint64_t step,
+                           double* z0, double* z1 )
+{
+    const uint32_t ctr[4] = { (uint32_t)index, (uint32_t)( index >> 32 ),
+                              (uint32_t)step, (uint32_t)( step >> 32 ) };
+    const uint32_t key[2] = { (uint32_t)seed, (uint32_t)( seed >> 32 ) };
+    philox4x32 r = philox4x32_10( ctr, key );
+    double rad = std::sqrt( -2.0 * std::log( u01( r.v[0] ) ) );
+    double theta = 2.0 * M_PI * u01( r.v[1] );
+    *z0 = rad * std::cos( theta );
+    *z1 = rad * std::sin( theta );
+}
+
+#endif /* GOODWIN_RNG_H */
@@ -0,0 +1,477 @@
+/*
+ Stochastic Goodwin wage--output model.
+
+ Adds Wiener shocks to wages and output,
+
+   dw = ( -c w + r w Y ) dt + g_w dW_w
+   dY = (  a Y - b w Y ) dt + g_Y dW_Y
+
+ with additive ( g = sigma ) or multiplicative ( g = sigma * state ) noise,
+ integrated by Euler--Maruyama or Milstein with a fixed step h.  Each
+ output interval of the time grid is taken in steps of h, which must divide
+ the spacing of a linear grid; on log and final grids an interval is cut
+ into the fewest equal steps no longer than h.  Paths are stepped together in
+ blocks held as structure-of-arrays, so the inner loops vectorize, and the
+ Gaussian increments come from a counter-based Philox generator keyed by
+ (seed, path, step), so a path is the same whichever thread steps it.
+ Ensemble mean, sd and quantiles of w(t) and Y(t) are written out in the
+ same layout as goodwin_mc.
+
+ The statistics also depend on the order blocks reach them; as in
+ goodwin_mc, --deterministic fixes that order to the block numbers, so the
+ output file is the same bit for bit on any number of threads, and
+ --verify-determinism checks it.  Build with -ffp-contract=off, as the
+ makefile does, so that no fused multiply-adds make the vectorized and
+ remainder iterations of the step loop differ.
+
+ g++ -Wall -O3 -ffp-contract=off -pthread -I/usr/include/ -c goodwin_sde.cpp &&
+ g++ -pthread -L/usr/local/lib goodwin_sde.o -lgsl -lgslcblas -lpopt -lstdc++fs -o goodwin_sde
+*/
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <unistd.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+#include <popt.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <experimental/filesystem>
+
+#include "goodwin.h"
+#include "goodwin_stats.h"
+#include "goodwin_numa.h"
+#include "goodwin_grid.h"
+#include "goodwin_rng.h"
+
+namespace fs = std::experimental::filesystem;
+
+using namespace std;
+
+#define PROGRAM_NAME "goodwin_sde"
+#define VERSION 1
+/* paths stepped together by one thread */
+#define PATH_BLOCK 256
+/* cap on the per-thread trajectory buffer, in doubles */
+#define BLOCK_BUFFER_MAX (8*1024*1024)
+
+struct sdeOptions {
+    long Npaths;
+    double h;
+    int threads;
+    long seed;
+    char * scheme;
+    char * noise;
+    double sigma_w;
+    double sigma_Y;
+    char * quantiles;
+    char * pin;
+    gridOptions grid;
+    int deterministic;  // statistics independent of thread count and scheduling
+    int verify;
+};
+
+static void parseArguments( int argc, const char **argv, goodwinParams* gparams,
+                            sdeOptions* sde, char ** outfile )
+{
+    poptContext optCon;
+    const struct poptOption optionsTable[] = {
+        POPT_AUTOHELP
+        { "nsteps", 'n', POPT_ARG_INT, &gparams->Nsteps, 0,
+            "Set number of output time steps." },
+        { "paths", 'P', POPT_ARG_LONG, &sde->Npaths, 0,
+            "Set number of sample paths." },
+        { "h", 0, POPT_ARG_DOUBLE, &sde->h, 0,
+            "Set SDE integration step (a divisor of the output spacing of a linear grid)." },
+        { "t-start", 0, POPT_ARG_DOUBLE, &sde->grid.tStart, 0,
+            "Set start time of the run (default 0)." },
+        { "t-end", 0, POPT_ARG_DOUBLE, &sde->grid.tEnd, 0,
+            "Set end time of the run; with a linear grid this sets the number of outputs." },
+        { "dt", 0, POPT_ARG_DOUBLE, &sde->grid.dt, 0,
+            "Set output spacing (default 0.1); the first output time of a log grid." },
+        { "grid", 0, POPT_ARG_STRING, &sde->grid.spacing, 0,
+            "Set output times: linear (default), log (Nsteps log-spaced to t-end), or final (last state only)." },
+        { "threads", 't', POPT_ARG_INT, &sde->threads, 0,
+            "Set number of worker threads (default: all cores)." },
+        { "pin", 0, POPT_ARG_STRING, &sde->pin, 0,
+            "Pin worker threads to a core, a NUMA node, or none (default core)." },
+        { "seed", 's', POPT_ARG_LONG, &sde->seed, 0,
+            "Set random seed." },
+        { "scheme", 0, POPT_ARG_STRING, &sde->scheme, 0,
+            "Integration scheme: em (Euler--Maruyama) or milstein." },
+        { "noise", 0, POPT_ARG_STRING, &sde->noise, 0,
+            "Noise type: additive or multiplicative." },
+        { "sigma-w", 0, POPT_ARG_DOUBLE, &sde->sigma_w, 0,
+            "Set wage noise intensity." },
+        { "sigma-Y", 0, POPT_ARG_DOUBLE, &sde->sigma_Y, 0,
+            "Set output noise intensity." },
+        { "deterministic", 'D', POPT_ARG_NONE, &sde->deterministic, 0,
+            "Reduce path blocks in block order, so the output is bit for bit the same on any number of threads." },
+        { "verify-determinism", 0, POPT_ARG_NONE, &sde->verify, 0,
+            "Run deterministically on 1 and on --threads threads, check the statistics are bit for bit equal, and time it against a free-running run." },
+        { "quantiles", 'q', POPT_ARG_STRING, &sde->quantiles, 0,
+            "Comma separated quantiles to track (default 0.05,0.25,0.5,0.75,0.95)." },
+        { "r", 'r', POPT_ARG_DOUBLE, &gparams->r, 0,
+            "Set wage appreciation parameter." },
+        { "c", 'c', POPT_ARG_DOUBLE, &gparams->c, 0,
+            "Set wage growth decay rate parameter." },
+        { "a", 'a', POPT_ARG_DOUBLE, &gparams->a, 0,
+            "Set output growth rate parameter." },
+        { "b", 'b', POPT_ARG_DOUBLE, &gparams->b, 0,
+            "Set output depreciation parameter." },
+        { "w0", 'w', POPT_ARG_DOUBLE, &gparams->w0, 0,
+            "Set initial wage share." },
+        { "Y0", 'y', POPT_ARG_DOUBLE, &gparams->Y0, 0,
+            "Set initial output level." },
+        { "Y0", 'Y', POPT_ARG_DOUBLE, &gparams->Y0, 0,
+            "Set initial output level." },
+        { "output", 'o', POPT_ARG_STRING, outfile, 0,
+            "Pandas format CSV file output pathname." },
+        {NULL, 0, 0, NULL, 0, }
+    };
+    int err;
+    const char *arg = NULL;
+    int argcnt = 0;
+
+    optCon = poptGetContext(PROGRAM_NAME, argc, argv, optionsTable, 0);
+    poptReadDefaultConfig(optCon, 0);
+
+    err = poptGetNextOpt(optCon);
+    if (err != -1) {
+        fprintf(stderr, "\t%s: %s\n",
+            poptBadOption(optCon, POPT_BADOPTION_NOALIAS),
+            poptStrerror(err));
+        exit(-1);
+    }
+
+    /* Parse arguments that do not begin with '-' (leftovers) */
+    arg = poptGetArg(optCon);
+    while (arg != NULL) {
+        printf("arg %2d   = %s\n", ++argcnt, arg);
+        arg = poptGetArg(optCon);
+    }
+    poptFreeContext(optCon);
+}
+
+struct sdeShared {
+    goodwinParams p;
+    double sigma_w;
+    double sigma_Y;
+    vector<int> substeps;     // per output interval: SDE steps
+    vector<double> dt;        // and their size
+    uint64_t seed;
+    bool multiplicative;
+    bool milstein;
+    long Npaths;
+    int block;
+    atomic<long> nextBlock;
+    atomic<long> diverged;
+    int deterministic;
+    ensembleAccumulator * acc;
+    vector<numaNode> nodes;
+    pinMode pin;
+    nodeTally * tally;
+};
+
+/*
+ Advance np paths by one step of dt.  The noise type and scheme are template
+ parameters so the inner loop has no branches and can be vectorized.
+ For additive noise g' = 0 and the Milstein correction vanishes.
+*/
+template <bool multiplicative, bool milstein>
+static void stepBlock( const sdeShared* sh, double* __restrict w, double* __restrict Y,
+                       double* __restrict z0, double* __restrict z1,
+                       int np, uint64_t path0, uint64_t step, double dt )
+{
+    const double r = sh->p.r, c = sh->p.c, a = sh->p.a, b = sh->p.b;
+    const double sw = sh->sigma_w, sY = sh->sigma_Y;
+    const double sqdt = sqrt( dt );
+    for ( int k=0; k < np; k++ ) philoxNormal2( sh->seed, path0 + k, step, &z0[k], &z1[k] );
+    for ( int k=0; k < np; k++ ) {
+        double wk = w[k], Yk = Y[k];
+        double fw = -c*wk + r*wk*Yk;
+        double fY = a*Yk - b*wk*Yk;
+        double dW0 = sqdt * z0[k], dW1 = sqdt * z1[k];
+        double gw = multiplicative ? sw*wk : sw;
+        double gY = multiplicative ? sY*Yk : sY;
+        double nw = wk + fw*dt + gw*dW0;
+        double nY = Yk + fY*dt + gY*dW1;
+        if ( milstein && multiplicative ) {
+            nw += 0.5 * sw * gw * ( dW0*dW0 - dt );
+            nY += 0.5 * sY * gY * ( dW1*dW1 - dt );
+        }
+        w[k] = nw;
+        Y[k] = nY;
+    }
+}
+
+typedef void (*stepFn)( const sdeShared*, double*, double*, double*, double*,
+                        int, uint64_t, uint64_t, double );
+
+static void sdeWorker( int id, sdeShared* sh )
+{
+    stepFn step = sh->multiplicative
+        ? ( sh->milstein ? stepBlock<true,true> : stepBlock<true,false> )
+        : ( sh->milstein ? stepBlock<false,true> : stepBlock<false,false> );
+    // pin first, so the path state and trajectory arena are first touched on this worker's node
+    int node = pinWorker( sh->nodes, id, sh->pin );
+    int Nt = sh->p.Nsteps;
+    int B = sh->block;
+    vector<double> w( B ), Y( B ), z0( B ), z1( B );
+    vector<double> traj( (size_t)B * Nt * 2 );
+    vector<char> ok( B );
+    long done = 0;
+
+    while ( true ) {
+        long blk = sh->nextBlock++;
+        long path0 = blk * B;
+        if ( path0 >= sh->Npaths ) break;
+        int np = (int)min( (long)B, sh->Npaths - path0 );
+        for ( int k=0; k < np; k++ ) {
+            w[k] = sh->p.w0;
+            Y[k] = sh->p.Y0;
+        }
+        uint64_t n = 0;
+        for ( int i=0; i < Nt; i++ ) {
+            for ( int s=0; s < sh->substeps[i]; s++ ) {
+                step( sh, w.data(), Y.data(), z0.data(), z1.data(), np, (uint64_t)path0, n++, sh->dt[i] );
+            }
+            for ( int k=0; k < np; k++ ) {
+                traj[(size_t)k*Nt*2 + 2*i] = w[k];
+                traj[(size_t)k*Nt*2 + 2*i + 1] = Y[k];
+            }
+        }
+        long ndiv = 0;
+        for ( int k=0; k < np; k++ ) {
+            ok[k] = isfinite( w[k] ) && isfinite( Y[k] );
+            if ( !ok[k] ) ndiv++;
+        }
+        sh->diverged += ndiv;
+        if ( sh->deterministic ) sh->acc->addInOrder( traj.data(), ok.data(), np, id, blk );
+        else sh->acc->add( traj.data(), ok.data(), np, id );
+        done += np;
+    }
+    sh->tally->add( node, done );
+}
+
+/* Run all the paths into sh->acc on nthreads workers; the elapsed seconds. */
+static double runEnsemble( sdeShared* sh, int nthreads )
+{
+    sh->nextBlock = 0;
+    sh->diverged = 0;
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for ( int id=0; id < nthreads; id++ ) workers.push_back( thread( sdeWorker, id, sh ) );
+    for ( auto& w : workers ) w.join();
+    return chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+}
+
+int main ( int argc, const char *argv[] )
+{
+    goodwinParams params;
+    defaultParams( &params );
+    sdeOptions sde;
+    sde.Npaths = 1000;
+    sde.h = 1e-3;
+    sde.threads = 0;
+    sde.seed = 1;
+    sde.scheme = NULL;
+    sde.noise = NULL;
+    sde.sigma_w = 0.1;
+    sde.sigma_Y = 0.1;
+    sde.quantiles = NULL;
+    sde.pin = NULL;
+    defaultGridOptions( &sde.grid );
+    sde.deterministic = 0;
+    sde.verify = 0;
+    char * pathname = NULL;
+    parseArguments( argc, argv, &params, &sde, &pathname );
+    string outfile = ( pathname != NULL ) ? pathname : "";
+    string scheme = ( sde.scheme != NULL ) ? sde.scheme : "em";
+    string noise = ( sde.noise != NULL ) ? sde.noise : "multiplicative";
+
+    if ( params.Nsteps>NMAX ) {
+        cout << "Nsteps exceeded maximum.  Resetting Nsteps to  NMAX ="<<NMAX<<endl;
+        params.Nsteps = NMAX;
+    } else if (params.Nsteps<1 ) {
+        cout << "Nsteps = "<<params.Nsteps << " less than minimum."
+        << "\nResetting Nsteps to default = 100" << endl;
+        params.Nsteps = 100;
+    }
+    if ( sde.Npaths < 1 ) {
+        fprintf(stderr, "\tpaths: must be at least 1\n");
+        exit(-1);
+    }
+    if ( scheme != "em" && scheme != "milstein" ) {
+        fprintf(stderr, "\tscheme: unknown scheme '%s'\n", scheme.c_str());
+        exit(-1);
+    }
+    if ( noise != "additive" && noise != "multiplicative" ) {
+        fprintf(stderr, "\tnoise: unknown noise type '%s'\n", noise.c_str());
+        exit(-1);
+    }
+    vector<double> probs;
+    if ( !parseQuantiles( sde.quantiles, &probs ) ) {
+        fprintf(stderr, "\tquantiles: could not parse '%s'\n", sde.quantiles);
+        exit(-1);
+    }
+    timeGrid grid;
+    string gridErr;
+    if ( !makeTimeGrid( sde.grid, params.Nsteps, &grid, &gridErr ) ) {
+        fprintf(stderr,"\tgrid: %s\n",gridErr.c_str());
+        exit(-1);
+    }
+    if ( grid.size() >= NMAX ) {
+        fprintf(stderr,"\tgrid: %ld outputs exceeds maximum %d\n",grid.size(),NMAX);
+        exit(-1);
+    }
+    params.Nsteps = grid.size();
+    if ( !( sde.h > 0.0 ) ) {
+        fprintf(stderr, "\th: must be positive\n");
+        exit(-1);
+    }
+    vector<int> substeps( params.Nsteps );
+    vector<double> stepDt( params.Nsteps );
+    long totalSteps = 0;
+    if ( grid.spacing == GRID_LINEAR ) {
+        double spacing = grid.span / grid.intervals;
+        int n = (int)lround( spacing / sde.h );
+        if ( n < 1 || fabs( n * sde.h - spacing ) > 1e-9 * spacing ) {
+            fprintf(stderr, "\th: %g does not divide the output spacing %g\n", sde.h, spacing);
+            exit(-1);
+        }
+        fill( substeps.begin(), substeps.end(), n );
+        fill( stepDt.begin(), stepDt.end(), sde.h );
+    } else {
+        for ( int i=0; i < params.Nsteps; i++ ) {
+            double span = grid.time( i+1 ) - ( ( i == 0 ) ? grid.tStart : grid.time( i ) );
+            substeps[i] = max( 1, (int)ceil( span / sde.h - 1e-9 ) );
+            stepDt[i] = span / substeps[i];
+        }
+    }
+    for ( int n : substeps ) totalSteps += n;
+    vector<numaNode> nodes = numaTopology();
+    if ( sde.threads < 1 ) sde.threads = numaCpuCount( nodes );
+    pinMode pin;
+    if ( !parsePinMode( sde.pin, sde.threads, numaCpuCount( nodes ), &pin ) ) {
+        fprintf(stderr, "\tpin: unknown mode '%s' (use core, node or none)\n", sde.pin);
+        exit(-1);
+    }
+
+    sdeShared sh;
+    sh.p = params;
+    sh.sigma_w = sde.sigma_w;
+    sh.sigma_Y = sde.sigma_Y;
+    sh.substeps = substeps;
+    sh.dt = stepDt;
+    sh.seed = (uint64_t)sde.seed;
+    sh.multiplicative = ( noise == "multiplicative" );
+    sh.milstein = ( scheme == "milstein" );
+    sh.Npaths = sde.Npaths;
+    sh.block = (int)max( 1L, min( (long)PATH_BLOCK, (long)BLOCK_BUFFER_MAX / ( 2L * params.Nsteps ) ) );
+    sh.deterministic = sde.deterministic || sde.verify;
+    sh.nodes = nodes;
+    sh.pin = pin;
+    // --verify-determinism: the same ensemble free running, then in order on one thread
+    unique_ptr<ensembleAccumulator> serialAcc;
+    double freeSecs = 0.0, serialSecs = 0.0;
+    bool freeMatches = false;
+    if ( sde.verify ) {
+        ensembleAccumulator freeAcc( params.Nsteps, probs, sde.threads );
+        serialAcc.reset( new ensembleAccumulator( params.Nsteps, probs, 1 ) );
+        nodeTally scratch( nodes.size() );
+        sh.tally = &scratch;
+        sh.acc = &freeAcc;
+        sh.deterministic = 0;
+        freeSecs = runEnsemble( &sh, sde.threads );
+        sh.acc = serialAcc.get();
+        sh.deterministic = 1;
+        serialSecs = runEnsemble( &sh, 1 );
+        freeMatches = freeAcc.identical( *serialAcc );
+    }
+    ensembleAccumulator acc( params.Nsteps, probs, sde.threads );
+    sh.acc = &acc;
+    nodeTally tally( nodes.size() );
+    sh.tally = &tally;
+
+    cout << "Integrating " << sde.Npaths << " paths x " << totalSteps
+         << " steps (" << scheme << ", " << noise << " noise) on "
+         << sde.threads << " threads (pinned: " << pinModeName( pin ) << ", "
+         << nodes.size() << " NUMA node(s))"
+         << ( sh.deterministic ? ", in block order" : "" ) << endl;
+    double elapsed = runEnsemble( &sh, sde.threads );
+    cout << "Done " << sde.Npaths << " paths (" << sh.diverged << " diverged) in "
+         << elapsed << " s, " << (double)sde.Npaths * totalSteps / elapsed
+         << " path-steps/s" << endl;
+    if ( pin != PIN_NONE ) printNodeThroughput( nodes, tally, elapsed, "paths" );
+    bool verified = true;
+    if ( sde.verify ) {
+        verified = acc.identical( *serialAcc );
+        cout << "Determinism: " << sde.threads << " threads in order " << ( verified ? "match" : "DIFFER from" )
+             << " 1 thread bit for bit (" << elapsed << " s against " << serialSecs << " s on 1 thread); "
+             << "free running took " << freeSecs << " s, so ordering costs "
+             << 100.0 * ( elapsed / freeSecs - 1.0 ) << "%, and "
+             << ( freeMatches ? "happened to match" : "did not match" ) << endl;
+    }
+
+    // File output set-up
+    time_t sysTime = time(0);
+    char chTime[80];
+    strftime(chTime,79,"%Y-%m-%d",localtime(&sysTime));
+    string csvfile = strformat("./sim_data/%s_v%d_N%d_P%ld_%s.pd",PROGRAM_NAME,
+            VERSION,params.Nsteps,sde.Npaths,chTime);
+    if ( outfile.empty() ) {
+        cout<<"Using default output pathname: '"<< csvfile <<"'"<< endl;
+    } else {
+        csvfile = outfile;
+        cout << "Using outfile pathname set by user: '"<< csvfile <<"'" <<endl;
+    }
+    fs::path dname = fs::path( csvfile ).parent_path();
+    struct stat info;
+    if ( !dname.empty() && stat( dname.c_str(), &info ) != 0 ) {
+        printf(" dir path '%s' does not exist, so\n",dname.c_str());
+        printf(" we will now create this directory for you.\n");
+        int status = mkdir(dname.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+        if ( status == -1 ) printf("Could not mkdir for '%s'\n",dname.c_str());
+    }
+
+    ofstream pdout;
+    pdout.open(csvfile);
+    pdout << "# Goodwin model SDE ensemble output." << endl;
+    pdout << "# r="<< params.r << " , c=" << params.c
+       << " , a=" << params.a << " , b=" << params.b
+       << " , w0="<< params.w0 << " , Y0=" << params.Y0
+       << " , Nsteps=" << params.Nsteps << endl;
+    pdout << "# scheme=" << scheme << " , noise=" << noise
+       << " , sigma_w=" << sde.sigma_w << " , sigma_Y=" << sde.sigma_Y
+       << " , h=" << sde.h << " , paths=" << sde.Npaths
+       << " , diverged=" << sh.diverged << " , seed=" << sde.seed
+       << ( sh.deterministic ? " , deterministic=1" : "" ) << endl;
+    if ( !isDefaultGrid( sde.grid ) ) pdout << gridHeader( grid );
+    // NB: no whitespace in the column names if we want Pandas dataframe format
+    pdout << "time";
+    acc.writeHeader( pdout );
+    pdout << endl;
+    for ( int i = 0; i < params.Nsteps; i++ ) {
+        pdout << setw(12) << fixed << grid.time( i+1 );
+        acc.writeRow( pdout, i );
+        pdout << endl;
+    }
+    pdout.close();
+    cout<< "Done.  See output in "<< csvfile <<endl;
+    if ( !verified ) {
+        fprintf(stderr,"\tverify-determinism: %d thread statistics differ from 1 thread\n",sde.threads);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+/*
+ Reusable GSL solver state for many short goodwin runs.
+
+ solverContext owns one gsl_odeiv2_driver, and with it the step, control
+ and evolve objects.  Between runs they are reset rather than reallocated,
+ which gives the same trajectory as a freshly allocated driver: the
+ initial step goes back to hstart and the step counters to zero.
+
+ threadSolver() gives each thread its own context.  It is created on the
+ thread's first call and kept until the thread exits, so a pool of
+ threads running thousands of short simulations allocates only once per
+ thread.
+*/
+
+#ifndef GOODWIN_SOLVER_H
+#define GOODWIN_SOLVER_H
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_odeiv2.h>
+
+#include "goodwin.h"
+
+class solverContext {
+public:
+    explicit solverContext( const gsl_odeiv2_step_type* T = gsl_odeiv2_step_rk8pd,
+                            double hstart = 1e-6, double epsabs = 1e-6, double epsrel = 0.0 )
+        : hstart_(hstart), epsabs_(epsabs), epsrel_(epsrel)
+    {
+        defaultParams( &params_ );
+        sys_.function = func;
+        sys_.jacobian = jac;
+        sys_.dimension = 2;
+        sys_.params = &params_;
+        d_ = gsl_odeiv2_driver_alloc_y_new( &sys_, T, hstart, epsabs, epsrel );
+    }
+    ~solverContext() { gsl_odeiv2_driver_free( d_ ); }
+
+    // the driver keeps pointers into this object
+    solverContext( const solverContext& ) = delete;
+    solverContext& operator=( const solverContext& ) = delete;
+
+    /* Start a new run with parameters p, as if the driver were new. */
+    void reset( const goodwinParams& p )
+    {
+        params_ = p;
+        gsl_odeiv2_driver_reset_hstart( d_, hstart_ );
+    }
+
+    int apply( double* t, double t1, double y[2] )
+    {
+        return gsl_odeiv2_driver_apply( d_, t, t1, y );
+    }
+
+    const goodwinParams& params() const { return params_; }
+    gsl_odeiv2_driver* driver() { return d_; }
+    double epsabs() const { return epsabs_; }
+    double epsrel() const { return epsrel_; }
+
+private:
+    goodwinParams params_;
+    gsl_odeiv2_system sys_;
+    gsl_odeiv2_driver * d_;
+    double hstart_, epsabs_, epsrel_;
+};
+
+/* This thread's default (rk8pd, 1e-6) context. */
+inline solverContext& threadSolver()
+{
+    thread_local solverContext ctx;
+    return ctx;
+}
+
+#endif /* GOODWIN_SOLVER_H */
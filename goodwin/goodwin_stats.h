@@ -0,0 +1,284 @@
+/*
+ Streaming (one pass, constant memory) estimators for ensemble statistics.
+
+ runningMoments  -- Welford mean and variance.
+ p2Quantile      -- Jain & Chlamtac P^2 quantile estimator, which tracks a
+                    single quantile with five markers, no matter how many
+                    samples are pushed through it.
+ ensembleAccumulator -- both of the above for w(t) and Y(t) at every output
+                    time of an ensemble, safe to feed from many threads.
+
+ Neither estimator is order independent: the P^2 markers and the last bits
+ of the Welford sums depend on the order the samples arrive in.
+ ensembleAccumulator::addInOrder() takes the batches in batch number order
+ whichever thread brings them, so the statistics come out bit for bit the
+ same on any number of threads.
+*/
+
+#ifndef GOODWIN_STATS_H
+#define GOODWIN_STATS_H
+
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <string>
+#include <cstdlib>
+#include <ostream>
+#include <iomanip>
+
+struct runningMoments {
+    long n = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+
+    void add( double x )
+    {
+        n++;
+        double delta = x - mean;
+        mean += delta / n;
+        m2 += delta * ( x - mean );
+    }
+    double variance() const { return n > 1 ? m2 / ( n - 1 ) : 0.0; }
+    double sd() const { return std::sqrt( variance() ); }
+};
+
+/* Parse a comma separated list of probabilities, e.g. "0.05,0.5,0.95". */
+inline bool parseQuantiles( const char * spec, std::vector<double>* probs )
+{
+    probs->clear();
+    std::string s = ( spec == NULL ) ? "0.05,0.25,0.5,0.75,0.95" : spec;
+    size_t pos = 0;
+    while ( pos <= s.size() ) {
+        size_t comma = s.find( ',', pos );
+        if ( comma == std::string::npos ) comma = s.size();
+        std::string tok = s.substr( pos, comma - pos );
+        char * end;
+        double p = std::strtod( tok.c_str(), &end );
+        if ( tok.empty() || *end != '\0' || !( p > 0.0 && p < 1.0 ) ) return false;
+        probs->push_back( p );
+        pos = comma + 1;
+    }
+    return !probs->empty();
+}
+
+class p2Quantile {
+public:
+    explicit p2Quantile( double p = 0.5 ) : p_(p), count_(0)
+    {
+        np_[0] = 0.0;     dn_[0] = 0.0;
+        np_[1] = 2.0*p;   dn_[1] = p/2.0;
+        np_[2] = 4.0*p;   dn_[2] = p;
+        np_[3] = 2.0+2*p; dn_[3] = (1.0+p)/2.0;
+        np_[4] = 4.0;     dn_[4] = 1.0;
+    }
+
+    double prob() const { return p_; }
+    long count() const { return count_; }
+
+    void add( double x )
+    {
+        int i, k;
+        if ( count_ < 5 ) {
+            q_[count_++] = x;
+            if ( count_ == 5 ) {
+                sort5( q_, 5 );
+                for ( i=0; i < 5; i++ ) n_[i] = i;
+            }
+            return;
+        }
+        // locate the cell k with q_[k] <= x < q_[k+1], stretching the ends
+        if ( x < q_[0] ) {
+            q_[0] = x;
+            k = 0;
+        } else if ( x >= q_[4] ) {
+            q_[4] = x;
+            k = 3;
+        } else {
+            k = 0;
+            while ( x >= q_[k+1] ) k++;
+        }
+        for ( i=k+1; i < 5; i++ ) n_[i]++;
+        for ( i=0; i < 5; i++ ) np_[i] += dn_[i];
+        // nudge the three interior markers toward their desired positions
+        for ( i=1; i <= 3; i++ ) {
+            double d = np_[i] - n_[i];
+            if ( ( d >=  1.0 && n_[i+1] - n_[i] >  1 ) ||
+                 ( d <= -1.0 && n_[i-1] - n_[i] < -1 ) ) {
+                int s = ( d >= 0.0 ) ? 1 : -1;
+                double qp = parabolic( i, s );
+                if ( q_[i-1] < qp && qp < q_[i+1] ) q_[i] = qp;
+                else q_[i] = linear( i, s );
+                n_[i] += s;
+            }
+        }
+        count_++;
+    }
+
+    double value() const
+    {
+        if ( count_ >= 5 ) return q_[2];
+        if ( count_ == 0 ) return NAN;
+        double tmp[5];
+        std::copy( q_, q_+count_, tmp );
+        sort5( tmp, (int)count_ );
+        int idx = (int)std::lround( p_ * ( count_ - 1 ) );
+        return tmp[idx];
+    }
+
+private:
+    /* insertion sort for the (at most five) initial observations */
+    static void sort5( double* x, int n )
+    {
+        for ( int i=1; i < n; i++ ) {
+            double v = x[i];
+            int j = i;
+            while ( j > 0 && x[j-1] > v ) { x[j] = x[j-1]; j--; }
+            x[j] = v;
+        }
+    }
+
+    double parabolic( int i, int s ) const
+    {
+        return q_[i] + s / (double)( n_[i+1] - n_[i-1] ) *
+            ( ( n_[i] - n_[i-1] + s ) * ( q_[i+1] - q_[i] ) / (double)( n_[i+1] - n_[i] )
+            + ( n_[i+1] - n_[i] - s ) * ( q_[i] - q_[i-1] ) / (double)( n_[i] - n_[i-1] ) );
+    }
+    double linear( int i, int s ) const
+    {
+        return q_[i] + s * ( q_[i+s] - q_[i] ) / (double)( n_[i+s] - n_[i] );
+    }
+
+    double p_;
+    long count_;
+    double q_[5];   // marker heights
+    long n_[5];     // actual marker positions
+    double np_[5];  // desired marker positions
+    double dn_[5];  // desired position increments
+};
+
+struct seriesStats {
+    runningMoments m;
+    std::vector<p2Quantile> q;
+};
+
+/*
+ Per output time statistics of w(t) and Y(t).  The time axis is split into
+ stripes, each with its own lock, and each worker starts feeding at a
+ different stripe so the workers rarely wait on each other.  In order, a
+ stripe also waits for the batch before: batches still go through
+ different stripes at once, as in a pipeline.
+*/
+class ensembleAccumulator {
+public:
+    ensembleAccumulator( int Nt, const std::vector<double>& probs, int nstripes )
+        : Nt_(Nt), nstripes_(nstripes), locks_(new std::mutex[nstripes]),
+          turns_(new std::condition_variable[nstripes]), next_(nstripes, 0)
+    {
+        seriesStats proto;
+        for ( double p : probs ) proto.q.push_back( p2Quantile(p) );
+        w.assign( Nt, proto );
+        Y.assign( Nt, proto );
+    }
+
+    /* traj holds nsamples rows of Nt (w,Y) pairs; rows with ok[k]==0 are skipped */
+    void add( const double* traj, const char* ok, int nsamples, int firstStripe )
+    {
+        for ( int s=0; s < nstripes_; s++ ) {
+            int stripe = ( firstStripe + s ) % nstripes_;
+            int i0 = (int)( (long)stripe * Nt_ / nstripes_ );
+            int i1 = (int)( (long)(stripe+1) * Nt_ / nstripes_ );
+            std::lock_guard<std::mutex> guard( locks_[stripe] );
+            for ( int k=0; k < nsamples; k++ ) {
+                if ( !ok[k] ) continue;
+                const double * row = traj + (size_t)k * Nt_ * 2;
+                for ( int i=i0; i < i1; i++ ) {
+                    push( w[i], row[2*i] );
+                    push( Y[i], row[2*i+1] );
+                }
+            }
+        }
+    }
+
+    /*
+     As add(), for batch number batch of a sequence numbered from 0 with no
+     gaps: each stripe takes the batches in that order, waiting if need be.
+    */
+    void addInOrder( const double* traj, const char* ok, int nsamples, int firstStripe, long batch )
+    {
+        for ( int s=0; s < nstripes_; s++ ) {
+            int stripe = ( firstStripe + s ) % nstripes_;
+            int i0 = (int)( (long)stripe * Nt_ / nstripes_ );
+            int i1 = (int)( (long)(stripe+1) * Nt_ / nstripes_ );
+            std::unique_lock<std::mutex> guard( locks_[stripe] );
+            turns_[stripe].wait( guard, [&]() { return next_[stripe] == batch; } );
+            for ( int k=0; k < nsamples; k++ ) {
+                if ( !ok[k] ) continue;
+                const double * row = traj + (size_t)k * Nt_ * 2;
+                for ( int i=i0; i < i1; i++ ) {
+                    push( w[i], row[2*i] );
+                    push( Y[i], row[2*i+1] );
+                }
+            }
+            next_[stripe]++;
+            turns_[stripe].notify_all();
+        }
+    }
+
+    /* true if every statistic is bit for bit the same as in o */
+    bool identical( const ensembleAccumulator& o ) const
+    {
+        if ( Nt_ != o.Nt_ ) return false;
+        auto same = []( double x, double y ) { return memcmp( &x, &y, sizeof x ) == 0; };
+        for ( int i=0; i < Nt_; i++ ) {
+            const seriesStats* a[2] = { &w[i], &Y[i] };
+            const seriesStats* b[2] = { &o.w[i], &o.Y[i] };
+            for ( int v=0; v < 2; v++ ) {
+                if ( a[v]->m.n != b[v]->m.n || !same( a[v]->m.mean, b[v]->m.mean )
+                     || !same( a[v]->m.m2, b[v]->m.m2 ) || a[v]->q.size() != b[v]->q.size() ) return false;
+                for ( size_t j=0; j < a[v]->q.size(); j++ ) {
+                    if ( !same( a[v]->q[j].value(), b[v]->q[j].value() ) ) return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /* column names following "time", e.g. ",w_mean,w_sd,w_q0.05,..." */
+    void writeHeader( std::ostream& os ) const
+    {
+        for ( const char * v : { "w", "Y" } ) {
+            os << "," << v << "_mean," << v << "_sd";
+            for ( auto& q : w[0].q ) os << "," << v << "_q" << q.prob();
+        }
+    }
+
+    void writeRow( std::ostream& os, int i ) const
+    {
+        for ( auto * series : { &w[i], &Y[i] } ) {
+            os << "," << std::setw(12) << series->m.mean << "," << std::setw(12) << series->m.sd();
+            for ( auto& q : series->q ) os << "," << std::setw(12) << q.value();
+        }
+    }
+
+    std::vector<seriesStats> w;
+    std::vector<seriesStats> Y;
+
+private:
+    static void push( seriesStats& s, double x )
+    {
+        s.m.add( x );
+        for ( auto& q : s.q ) q.add( x );
+    }
+
+    int Nt_;
+    int nstripes_;
+    std::unique_ptr<std::mutex[]> locks_;
+    std::unique_ptr<std::condition_variable[]> turns_;
+    std::vector<long> next_;    // addInOrder: the batch each stripe takes next
+};
+
+#endif /* GOODWIN_STATS_H */
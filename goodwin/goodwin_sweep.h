@@ -0,0 +1,412 @@
+/*
+ Parameter sweeps for goodwin, run as a coordinator and forked workers.
+
+ sweepGrid -- a grid over goodwinParams from a spec such as
+    "r=0.5:1.5:11,w0=2:4:3"      (name=lo:hi:n, or name=value)
+    Unlisted parameters keep their values from the command line.  Points
+    are numbered with the last listed axis varying fastest.  Every point
+    is integrated over the same output timeGrid, with the same monitors.
+
+ sweepResults -- one MAP_SHARED anonymous mapping, made before the fork,
+    holding every point's (w, Y) samples plus a row count, status and
+    stop reason (goodwin_monitor.h) per point.  Workers write their points
+    in place, so results reach the coordinator without pipes or files, and
+    each worker first touches the pages it fills on its own NUMA node.
+
+ runSweep() -- cuts the grid into contiguous shards and keeps one worker
+    process per slot busy; slot s is pinned to NUMA node s % nnodes.  A
+    worker that crashes or is killed has only its own shard reset and
+    queued again, up to a retry limit, so completed shards are never rerun.
+    A point whose integration fails keeps the rows it reached and the GSL
+    status; that is a result, not a worker failure.
+
+ writeSweep() -- the merged output: one .pd file of point,time,wages,output
+    rows in point order, and an index .pd file giving each point's
+    parameters, status, stop reason, first row and row count.  Points are
+    run with the grid's termination monitors, so one that blows up,
+    settles or closes its orbit early stops there.
+
+ When sweepGrid::dataset is set, each worker also writes every point it
+ integrates as its own part of one hive-partitioned Parquet dataset,
+ datasetPartPath( dataset, point ) of goodwin_arrow.h, so the whole sweep
+ reads back as a single dataset keyed by the parameters.  A rerun shard
+ rewrites its parts.
+*/
+
+#ifndef GOODWIN_SWEEP_H
+#define GOODWIN_SWEEP_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <experimental/filesystem>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_odeiv2.h>
+
+#include "goodwin.h"
+#include "goodwin_output.h"
+#include "goodwin_arrow.h"
+#include "goodwin_numa.h"
+#include "goodwin_solver.h"
+#include "goodwin_grid.h"
+#include "goodwin_monitor.h"
+
+#define SWEEP_NPARAMS 6
+#define SWEEP_NOTRUN (-1)
+
+static const char * const sweepParamNames[SWEEP_NPARAMS] = { "r", "c", "a", "b", "w0", "Y0" };
+
+inline double* sweepParam( goodwinParams* p, int k )
+{
+    double * fields[SWEEP_NPARAMS] = { &p->r, &p->c, &p->a, &p->b, &p->w0, &p->Y0 };
+    return fields[k];
+}
+
+struct sweepAxis {
+    int param;
+    double lo, hi;
+    int n;
+};
+
+struct sweepGrid {
+    goodwinParams base;
+    std::vector<sweepAxis> axes;
+    timeGrid times;
+    monitorOptions monitors;
+    std::string dataset;    // Parquet dataset directory, or empty for none
+    int rowGroup;
+    std::string program;    // recorded in each part's metadata
+
+    long size() const
+    {
+        long n = 1;
+        for ( const sweepAxis& ax : axes ) n *= ax.n;
+        return n;
+    }
+
+    goodwinParams point( long k ) const
+    {
+        goodwinParams p = base;
+        for ( int j=(int)axes.size()-1; j >= 0; j-- ) {
+            const sweepAxis& ax = axes[j];
+            int i = (int)( k % ax.n );
+            k /= ax.n;
+            *sweepParam( &p, ax.param ) = ( ax.n > 1 ) ? ax.lo + ( ax.hi - ax.lo ) * i / ( ax.n - 1 ) : ax.lo;
+        }
+        return p;
+    }
+};
+
+/* Parse "name=lo:hi:n,name=value,..."; on error returns false with a message in err. */
+inline bool parseSweep( const char* spec, const goodwinParams& base, sweepGrid* grid, std::string* err )
+{
+    grid->base = base;
+    grid->axes.clear();
+    grid->times = defaultGrid( base.Nsteps );
+    defaultMonitorOptions( &grid->monitors );
+    grid->dataset.clear();
+    grid->rowGroup = 65536;
+    grid->program = "goodwin";
+    std::string s( spec );
+    size_t pos = 0;
+    while ( pos <= s.size() ) {
+        size_t end = s.find( ',', pos );
+        if ( end == std::string::npos ) end = s.size();
+        std::string item = s.substr( pos, end - pos );
+        pos = end + 1;
+        if ( item.empty() ) continue;
+        size_t eq = item.find( '=' );
+        sweepAxis ax;
+        ax.param = -1;
+        for ( int k=0; k < SWEEP_NPARAMS && eq != std::string::npos; k++ ) {
+            if ( item.compare( 0, eq, sweepParamNames[k] ) == 0 ) ax.param = k;
+        }
+        if ( ax.param < 0 ) {
+            *err = "unknown sweep parameter in '" + item + "' (use r, c, a, b, w0, Y0)";
+            return false;
+        }
+        const char * v = item.c_str() + eq + 1;
+        char extra;
+        int nf = sscanf( v, "%lf:%lf:%d%c", &ax.lo, &ax.hi, &ax.n, &extra );
+        if ( nf == 1 ) {
+            ax.hi = ax.lo;
+            ax.n = 1;
+        } else if ( nf != 3 || ax.n < 1 ) {
+            *err = "bad sweep range '" + item + "' (use name=lo:hi:n or name=value)";
+            return false;
+        }
+        if ( ax.lo <= 0.0 || ax.hi <= 0.0 ) {
+            *err = "sweep values must be positive in '" + item + "'";
+            return false;
+        }
+        grid->axes.push_back( ax );
+    }
+    if ( grid->axes.empty() ) {
+        *err = "empty sweep";
+        return false;
+    }
+    return true;
+}
+
+struct sweepResults {
+    long npoints;
+    int nsteps;
+    int * rows;       // samples written per point
+    int * status;     // GSL_SUCCESS, a GSL error code, or SWEEP_NOTRUN
+    int * stop;       // stopReason
+    double * data;    // npoints x nsteps x (w, Y)
+    void * map;
+    size_t mapsize;
+};
+
+inline bool allocSweepResults( long npoints, int nsteps, sweepResults* res )
+{
+    size_t head = ( 3 * npoints * sizeof(int) + 63 ) & ~(size_t)63;
+    res->mapsize = head + (size_t)npoints * nsteps * 2 * sizeof(double);
+    res->map = mmap( NULL, res->mapsize, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+    if ( res->map == MAP_FAILED ) return false;
+    res->npoints = npoints;
+    res->nsteps = nsteps;
+    res->rows = (int*)res->map;
+    res->status = res->rows + npoints;
+    res->stop = res->status + npoints;
+    res->data = (double*)( (char*)res->map + head );
+    for ( long k=0; k < npoints; k++ ) {
+        res->rows[k] = 0;
+        res->status[k] = SWEEP_NOTRUN;
+        res->stop[k] = STOP_COMPLETE;
+    }
+    return true;
+}
+
+inline void freeSweepResults( sweepResults* res )
+{
+    munmap( res->map, res->mapsize );
+}
+
+/* Point k's rows as its part of grid.dataset; false with a message on stderr on failure. */
+inline bool writeSweepPart( const sweepGrid& grid, const sweepResults* res, long k )
+{
+    goodwinParams p = grid.point( k );
+    std::string path = datasetPartPath( grid.dataset, p );
+    std::error_code ec;
+    std::experimental::filesystem::create_directories(
+        std::experimental::filesystem::path( path ).parent_path(), ec );
+    columnarWriter part;
+    if ( !part.open( path, p, grid.program, grid.rowGroup ) ) {
+        fprintf(stderr,"\tCould not open '%s': %s\n",path.c_str(),part.error().c_str());
+        return false;
+    }
+    const double * y = res->data + (size_t)k * res->nsteps * 2;
+    for ( int i=1; i <= res->rows[k]; i++ ) part.append( grid.times.time( i ), y + 2*(i-1) );
+    if ( !part.close() ) {
+        fprintf(stderr,"\tError writing '%s': %s\n",path.c_str(),part.error().c_str());
+        return false;
+    }
+    return true;
+}
+
+/*
+ Integrate points [first, last) on the output grid, as goodwin does, and
+ write their dataset parts.  False if a part could not be written.
+*/
+inline bool runSweepShard( const sweepGrid& grid, long first, long last, sweepResults* res )
+{
+    solverContext& solver = threadSolver();
+    terminationMonitor monitor( grid.monitors );
+    gsl_set_error_handler_off();
+    for ( long k=first; k < last; k++ ) {
+        goodwinParams p = grid.point( k );
+        solver.reset( p );
+        double t = grid.times.tStart;
+        double y[2] = { p.w0, p.Y0 };
+        monitor.start( t, y, p );
+        double * out = res->data + (size_t)k * res->nsteps * 2;
+        int status = GSL_SUCCESS;
+        int rows = 0;
+        for ( int i=1; i <= res->nsteps; i++ ) {
+            status = solver.apply( &t, grid.times.time( i ), y );
+            if ( status != GSL_SUCCESS ) {
+                monitor.fail();
+                break;
+            }
+            out[2*(i-1)] = y[0];
+            out[2*(i-1)+1] = y[1];
+            rows = i;
+            if ( monitor.check( t, y ) ) break;
+        }
+        res->rows[k] = rows;
+        res->status[k] = status;
+        res->stop[k] = monitor.reason();
+        if ( !grid.dataset.empty() && !writeSweepPart( grid, res, k ) ) return false;
+    }
+    return true;
+}
+
+struct sweepOptions {
+    int workers;    // concurrent worker processes (0: one per allowed CPU)
+    int shards;     // shards the grid is cut into (0: 4 per worker)
+    int retries;    // reruns allowed per shard after a worker failure
+};
+
+struct sweepSummary {
+    int workers;
+    int shards;
+    int nodes;
+    int retried;                  // shard reruns after worker failures
+    std::vector<int> failed;      // shards given up on
+    std::vector<long> nodePoints; // points completed per NUMA node
+    double seconds;
+};
+
+inline void runSweep( const sweepGrid& grid, const sweepOptions& opts,
+                      sweepResults* res, sweepSummary* sum )
+{
+    std::vector<numaNode> nodes = numaTopology();
+    long npoints = grid.size();
+    int workers = ( opts.workers > 0 ) ? opts.workers : numaCpuCount( nodes );
+    int nshards = ( opts.shards > 0 ) ? opts.shards : 4 * workers;
+    if ( nshards > npoints ) nshards = (int)npoints;
+    if ( workers > nshards ) workers = nshards;
+    sum->workers = workers;
+    sum->shards = nshards;
+    sum->nodes = (int)nodes.size();
+    sum->retried = 0;
+    sum->failed.clear();
+    sum->nodePoints.assign( nodes.size(), 0 );
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<int> attempts( nshards, 0 );
+    std::deque<int> pending;
+    for ( int s=0; s < nshards; s++ ) pending.push_back( s );
+    std::vector<pid_t> slotPid( workers, -1 );
+    std::vector<int> slotShard( workers, -1 );
+    int running = 0;
+    auto shardFirst = [npoints, nshards]( int s ) { return npoints * s / nshards; };
+
+    fflush( stdout );
+    fflush( stderr );
+    while ( !pending.empty() || running > 0 ) {
+        for ( int slot=0; slot < workers && !pending.empty(); slot++ ) {
+            if ( slotPid[slot] >= 0 ) continue;
+            int s = pending.front();
+            pending.pop_front();
+            attempts[s]++;
+            pid_t pid = fork();
+            if ( pid == 0 ) {
+                pinToCpus( nodes[slot % nodes.size()].cpus );
+                _exit( runSweepShard( grid, shardFirst( s ), shardFirst( s+1 ), res ) ? 0 : 3 );
+            }
+            if ( pid < 0 ) {
+                fprintf(stderr,"\tfork failed for shard %d: %s\n",s,strerror(errno));
+                pending.push_front( s );
+                attempts[s]--;
+                break;
+            }
+            slotPid[slot] = pid;
+            slotShard[slot] = s;
+            running++;
+        }
+        if ( running == 0 ) break;    // fork keeps failing
+
+        int wstatus;
+        pid_t pid = waitpid( -1, &wstatus, 0 );
+        if ( pid < 0 ) {
+            if ( errno == EINTR ) continue;
+            break;
+        }
+        int slot = 0;
+        while ( slot < workers && slotPid[slot] != pid ) slot++;
+        if ( slot == workers ) continue;
+        int s = slotShard[slot];
+        slotPid[slot] = -1;
+        running--;
+        if ( WIFEXITED( wstatus ) && WEXITSTATUS( wstatus ) == 0 ) {
+            sum->nodePoints[slot % nodes.size()] += shardFirst( s+1 ) - shardFirst( s );
+            continue;
+        }
+        if ( WIFSIGNALED( wstatus ) ) {
+            fprintf(stderr,"\tshard %d worker killed by signal %d\n",s,WTERMSIG(wstatus));
+        } else {
+            fprintf(stderr,"\tshard %d worker exited with status %d\n",s,WEXITSTATUS(wstatus));
+        }
+        for ( long k=shardFirst( s ); k < shardFirst( s+1 ); k++ ) {
+            res->rows[k] = 0;
+            res->status[k] = SWEEP_NOTRUN;
+            res->stop[k] = STOP_COMPLETE;
+        }
+        if ( attempts[s] <= opts.retries ) {
+            sum->retried++;
+            pending.push_back( s );
+        } else {
+            sum->failed.push_back( s );
+        }
+    }
+    // anything left unstarted after fork failures counts as failed
+    for ( int s : pending ) sum->failed.push_back( s );
+    sum->seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+/* Merged data (point,time,wages,output) and its index, both in .pd format. */
+inline bool writeSweep( const sweepGrid& grid, const sweepResults& res, const textFormat& fmt,
+                        const std::string& header, const std::string& datafile,
+                        const std::string& indexfile, std::string* err )
+{
+    asyncWriter data, index;
+    if ( !data.open( datafile ) ) {
+        *err = "could not open '" + datafile + "': " + strerror( errno );
+        return false;
+    }
+    if ( !index.open( indexfile ) ) {
+        *err = "could not open '" + indexfile + "': " + strerror( errno );
+        return false;
+    }
+    data.write( header );
+    data.write( "point,time,wages,output\n" );
+    index.write( header );
+    index.write( "# first_row counts data rows after the column names; status 0 is GSL_SUCCESS, -1 not run\n" );
+    index.write( "point,r,c,a,b,w0,Y0,status,stop,first_row,nrows\n" );
+    textFormat pfmt = { -1, 0 };
+    long first = 0;
+    for ( long k=0; k < res.npoints; k++ ) {
+        goodwinParams p = grid.point( k );
+        char * q = index.reserve( ROW_MAX );
+        char * q0 = q;
+        q = std::to_chars( q, q + 24, k ).ptr;
+        for ( int j=0; j < SWEEP_NPARAMS; j++ ) {
+            *q++ = ',';
+            q = formatDouble( q, *sweepParam( &p, j ), pfmt );
+        }
+        q += sprintf( q, ",%d,%s,%ld,%d\n", res.status[k], stopReasonName( (stopReason)res.stop[k] ),
+                      first, res.rows[k] );
+        index.commit( q - q0 );
+
+        const double * y = res.data + (size_t)k * res.nsteps * 2;
+        for ( int i=1; i <= res.rows[k]; i++ ) {
+            q = data.reserve( ROW_MAX + 24 );
+            q0 = q;
+            q = std::to_chars( q, q + 24, k ).ptr;
+            *q++ = ',';
+            q += formatRow( q, fmt, ",", grid.times.time( i ), y + 2*(i-1) );
+            data.commit( q - q0 );
+        }
+        first += res.rows[k];
+    }
+    bool ok = data.close();
+    if ( !ok ) *err = "error writing '" + datafile + "': " + strerror( data.error() );
+    if ( !index.close() ) {
+        ok = false;
+        *err = "error writing '" + indexfile + "': " + strerror( index.error() );
+    }
+    return ok;
+}
+
+#endif /* GOODWIN_SWEEP_H */
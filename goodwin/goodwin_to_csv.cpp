@@ -1,16 +1,20 @@
 /*
  Example GNU-GSL ODE solver for Goodwin wage--output model
  
- g++ -Wall -I/usr/include/ -c goodwin_to_csv.cpp &&
- g++ -L/usr/local/lib goodwin_to_csv.o -lgsl -lgslcblas -lpopt -o goodwin_to_csv
+ g++ -Wall -pthread -I/usr/include/ -c goodwin_to_csv.cpp &&
+ g++ -pthread -L/usr/local/lib goodwin_to_csv.o -lgsl -lgslcblas -lpopt -o goodwin_to_csv
 
  Version 2.0  has cmdl parsing options, and file output
+ Version 2.1  formats rows with std::to_chars, has --precision and --quiet
+ Version 2.2  output time grid options --t-start, --t-end, --dt, --grid
 */
 
 #include <iostream>
 #include <fstream>
 #include <iomanip>
 #include <unistd.h>
+#include <sstream>
+#include <vector>
 #include <gsl/gsl_errno.h>
 #include <gsl/gsl_matrix.h>
 #include <gsl/gsl_odeiv2.h>
@@ -18,21 +22,16 @@
 #include <popt.h>
 #include <string.h>
 
+#include "goodwin.h"
+#include "goodwin_output.h"
+#include "goodwin_grid.h"
+
 using namespace std;
 
 #define PROGRAM_NAME "popt_demo"
 
-struct goodwinParams {
-    double r;
-    double c;
-    double a;
-    double b;
-    double w0;
-    double Y0;
-};
-
-
-static void parseArguments( int argc, const char **argv, goodwinParams* gparams )
+static void parseArguments( int argc, const char **argv, goodwinParams* gparams,
+                            gridOptions* grid, int* precision, int* quiet )
 {
     poptContext optCon;
     const struct poptOption optionsTable[] = {
@@ -51,6 +50,18 @@ static void parseArguments( int argc, const char **argv, goodwinParams* gparams
             "Set initial output level." },
         { "Y0 ", 'Y', POPT_ARG_DOUBLE, &gparams->Y0, 0,
             "Set initial output level." },
+        { "t-start", 0, POPT_ARG_DOUBLE, &grid->tStart, 0,
+            "Set start time of the run (default 0)." },
+        { "t-end", 0, POPT_ARG_DOUBLE, &grid->tEnd, 0,
+            "Set end time of the run; with a linear grid this sets the number of outputs." },
+        { "dt", 0, POPT_ARG_DOUBLE, &grid->dt, 0,
+            "Set output spacing (default 0.1); the first output time of a log grid." },
+        { "grid", 0, POPT_ARG_STRING, &grid->spacing, 0,
+            "Set output times: linear (default, 100 outputs), log (100 log-spaced to t-end), or final." },
+        { "precision", 'p', POPT_ARG_INT, precision, 0,
+            "Set decimals written per value (default 6; -1 for shortest exact round-trip)." },
+        { "quiet", 'q', POPT_ARG_NONE, quiet, 0,
+            "Do not echo every row to stdout." },
         {NULL, 0, 0, NULL, 0, }
     };
     int i;
@@ -90,75 +101,57 @@ static void parseArguments( int argc, const char **argv, goodwinParams* gparams
 }
 
 
-int func (double t, const double y[], double f[],
-      void *params)
-{
-    (void)(t); /* avoid unused parameter warning */ 
-    struct goodwinParams *p = (struct goodwinParams*)(params); 
-    double r = p->r; 
-    double c = p->c; 
-    double a = p->a; 
-    double b = p->b;
-    f[0] = -c*y[0] + r*y[0]*y[1]; // wages y[0], f[0]=dy[0]/dt
-    f[1] = a*y[1] - b*y[0]*y[1]; // output y[1], f[1]=dy[1]/dt
-    return GSL_SUCCESS;
-}
-
-int
-jac (double t, const double y[], double *dfdy,
-     double dfdt[], void *params)
-{
-    (void)(t); /* avoid unused parameter warning */
-    struct goodwinParams *p = (struct goodwinParams*)(params); 
-    double r = p->r; 
-    double c = p->c; 
-    double a = p->a; 
-    double b = p->b;
-    gsl_matrix_view dfdy_mat
-    = gsl_matrix_view_array (dfdy, 2, 2);
-    gsl_matrix * m = &dfdy_mat.matrix;
-    gsl_matrix_set (m, 0, 0, -c+r*y[1] );
-    gsl_matrix_set (m, 0, 1, -b*y[1] );
-    gsl_matrix_set (m, 1, 0, r*y[0] );
-    gsl_matrix_set (m, 1, 1, a-b*y[0] );
-    dfdt[0] = 0.0;  // no explicit time dependencies
-    dfdt[1] = 0.0;
-    return GSL_SUCCESS;
-}
-
 int main ( int argc, const char *argv[] )
 {
     goodwinParams params;
-    params.r = 1.0;
-    params.c = 1.0;
-    params.a = 1.0;
-    params.b = 1.0;
-    params.w0 = 3.0;
-    params.Y0 = 4.0;
-    parseArguments( argc, argv, &params );
+    defaultParams( &params );
+    int precision = 6;
+    int quiet = 0;
+    gridOptions gopts;
+    defaultGridOptions( &gopts );
+    parseArguments( argc, argv, &params, &gopts, &precision, &quiet );
+    if ( precision > PRECISION_MAX ) precision = PRECISION_MAX;
+    timeGrid grid;
+    string err;
+    if ( !makeTimeGrid( gopts, 100, &grid, &err ) ) {
+        fprintf(stderr,"\tgrid: %s\n",err.c_str());
+        exit(-1);
+    }
     
     gsl_odeiv2_system sys = {func, jac, 2, &params };
 
     gsl_odeiv2_driver * d =
     gsl_odeiv2_driver_alloc_y_new (&sys, gsl_odeiv2_step_rk8pd,
                                     1e-6, 1e-6, 0.0);
-    int i;
-    double t = 0.0, t1 = 100.0;
+    long i;
+    double t = grid.tStart;
     double y[2] = {  params.w0,  params.Y0 }; // initial conditions: { wages, output }
     
-    ofstream fout;
-    fout.open ("goodwin.csv");
-    fout << "# Goodwin model data output." << endl;
-    fout << "# r="<< params.r << " , c=" << params.r 
+    asyncWriter fout;
+    if ( !fout.open ("goodwin.csv") ) {
+        printf ("Could not open goodwin.csv for writing\n");
+        gsl_odeiv2_driver_free (d);
+        return -1;
+    }
+    ostringstream header;
+    header << "# Goodwin model data output." << endl;
+    header << "# r="<< params.r << " , c=" << params.c 
        << " , a=" << params.a << " , b=" << params.b 
        << " , w0="<< y[0] << " , Y0=" << y[1] << endl;
-    fout << "# columns:" << endl << setw(4) << "#   " 
+    if ( !isDefaultGrid( gopts ) ) header << gridHeader( grid );
+    header << "# columns:" << endl << setw(4) << "#   " 
        << setw(8) << "time" << setw(3) << " , " 
        << setw(12) << "wages" << setw(3) << " , " 
        << setw(12) << "output" << endl; 
-    for (i = 1; i <= 100; i++)
+    fout.write( header.str() );
+
+    // echoed rows are batched in one reusable buffer instead of one cout per row
+    textFormat fmt = { precision, 12 };
+    vector<char> echo( 64*ROW_MAX );
+    size_t necho = 0;
+    for (i = 1; i <= grid.size(); i++)
     {
-        double ti =  i * t1 / 1000.0;
+        double ti = grid.time( i );
         int status = gsl_odeiv2_driver_apply (d, &t, ti, y);
 
         if (status != GSL_SUCCESS)
@@ -166,11 +159,16 @@ int main ( int argc, const char *argv[] )
             printf ("error, return value = %d\n", status);
             break;
         }
-        cout  << setw(12) << fixed << t << setw(12) 
-           <<  y[0] << setw(12) << y[1] << endl;
-        fout << setw(12) << fixed << t << " , " << setw(12)
-           <<  y[0] << " , " << setw(12) << y[1] << endl;
+        if ( !quiet ) {
+            if ( necho + ROW_MAX > echo.size() ) {
+                fwrite( echo.data(), 1, necho, stdout );
+                necho = 0;
+            }
+            necho += formatRow( &echo[necho], fmt, "", t, y );
+        }
+        fout.commit( formatRow( fout.reserve( ROW_MAX ), fmt, " , ", t, y ) );
     }
+    if ( necho > 0 ) fwrite( echo.data(), 1, necho, stdout );
     fout.close();
     gsl_odeiv2_driver_free (d);
     return 0;
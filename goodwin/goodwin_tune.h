@@ -0,0 +1,210 @@
+/*
+ Stepper and tolerance autotuning.
+
+ Every program here used to integrate with GSL's rk8pd at epsabs = 1e-6,
+ epsrel = 0, whatever the model and the accuracy the run really needs.
+ autotune() picks the cheapest (stepper, tolerance) pair that meets an
+ accuracy target for one model and parameter regime:
+
+   1. A short calibration run on vern6 at epsabs = epsrel = 1e-13 is the
+      reference.
+   2. For each stepper, tolerances 1e-3, 1e-4, ... 1e-12 are tried until
+      the calibration run stays within the target, measured as the largest
+      |y - yref| / (1 + |yref|) over all calibration outputs and components.
+   3. Those passing configurations are timed, repeating the calibration run
+      for at least TUNE_MIN_SECONDS, and the fastest wins.
+
+ The caller supplies the calibration run as
+   bool run( stepperKind kind, double epsabs, double epsrel, std::vector<double>* out )
+ filling out with the state at each output time, so the same tuner serves
+ goodwin, vanderpol and anything else with an N dimensional system.
+
+ Results persist in a .pd table keyed by model, regime and target
+ (default ./sim_data/autotune.pd); a later run with the same key reads
+ the configuration back instead of recalibrating.  The regime key is the
+ parameters to two significant figures, so nearby parameter sets share a
+ tuning.  Timings are of course only valid on the machine that made them.
+*/
+
+#ifndef GOODWIN_TUNE_H
+#define GOODWIN_TUNE_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <sys/stat.h>
+
+#include "goodwin.h"
+#include "goodwin_rk.h"
+
+static const char TUNE_FILE_DEFAULT[] = "./sim_data/autotune.pd";
+static const double TUNE_REF_TOL = 1e-13;
+static const double TUNE_MIN_SECONDS = 0.02;
+static const int TUNE_OUTPUTS = 200;    // calibration run length, in output intervals
+
+struct tuneConfig {
+    stepperKind stepper;
+    double epsabs;
+    double epsrel;
+    double error;       // calibration error at this setting
+    double usPerRun;    // calibration run time, microseconds
+};
+
+/* goodwin regime key: the parameters to two significant figures */
+inline std::string goodwinRegime( const goodwinParams& p )
+{
+    return strformat( "r=%.2g c=%.2g a=%.2g b=%.2g w0=%.2g Y0=%.2g",
+                      p.r, p.c, p.a, p.b, p.w0, p.Y0 );
+}
+
+/* largest |y - yref| / (1 + |yref|) */
+inline double tuneError( const std::vector<double>& y, const std::vector<double>& yref )
+{
+    if ( y.size() != yref.size() ) return INFINITY;
+    double e = 0.0;
+    for ( size_t k=0; k < y.size(); k++ ) {
+        double d = fabs( y[k] - yref[k] ) / ( 1.0 + fabs( yref[k] ) );
+        if ( !( d <= e ) ) e = d;    // NaN counts as failure
+    }
+    return e;
+}
+
+/* Seconds per calibration run, repeating it until TUNE_MIN_SECONDS have passed. */
+template <class Run>
+double tuneTime( Run& run, stepperKind kind, double epsabs, double epsrel )
+{
+    std::vector<double> out;
+    int reps = 0;
+    auto start = std::chrono::steady_clock::now();
+    double secs;
+    do {
+        run( kind, epsabs, epsrel, &out );
+        reps++;
+        secs = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    } while ( secs < TUNE_MIN_SECONDS );
+    return secs / reps;
+}
+
+/*
+ Calibrate and pick the cheapest configuration meeting target.  Progress
+ goes to log unless it is NULL.  Returns false, with *err set, if the
+ reference run fails or no configuration meets the target.
+*/
+template <class Run>
+bool autotune( Run run, double target, tuneConfig* best, std::string* err, FILE* log = stdout )
+{
+    std::vector<double> yref;
+    if ( !run( STEPPER_VERN6, TUNE_REF_TOL, TUNE_REF_TOL, &yref ) ) {
+        *err = "reference integration failed";
+        return false;
+    }
+    const stepperKind kinds[] = { STEPPER_RK8PD, STEPPER_BS3, STEPPER_DP5, STEPPER_TSIT5, STEPPER_VERN6,
+                                  STEPPER_VERN9 };
+    bool found = false;
+    for ( stepperKind kind : kinds ) {
+        for ( int k=3; k <= 12; k++ ) {
+            double tol = pow( 10.0, -k );
+            std::vector<double> y;
+            if ( !run( kind, tol, tol, &y ) ) continue;
+            double e = tuneError( y, yref );
+            if ( !( e <= target ) ) continue;
+            tuneConfig c = { kind, tol, tol, e, 1e6 * tuneTime( run, kind, tol, tol ) };
+            if ( log != NULL ) {
+                fprintf( log, "  %-6s eps %-6.0e error %10.3e  %10.1f us/run\n",
+                         stepperName( kind ), tol, e, c.usPerRun );
+            }
+            if ( !found || c.usPerRun < best->usPerRun ) *best = c;
+            found = true;
+            break;
+        }
+    }
+    if ( !found ) *err = strformat( "no stepper reaches error %g (tightest tried: 1e-12)", target );
+    return found;
+}
+
+/* Look up model/regime/target in the tuning table at path. */
+inline bool loadTune( const std::string& path, const std::string& model, const std::string& regime,
+                      double target, tuneConfig* c )
+{
+    FILE * f = fopen( path.c_str(), "r" );
+    if ( f == NULL ) return false;
+    std::string want = model + "," + regime + "," + strformat( "%g", target ) + ",";
+    char line[1024];
+    bool found = false;
+    while ( !found && fgets( line, sizeof(line), f ) != NULL ) {
+        if ( strncmp( line, want.c_str(), want.size() ) != 0 ) continue;
+        char name[32];
+        if ( sscanf( line + want.size(), "%31[^,],%lf,%lf,%lf,%lf", name,
+                     &c->epsabs, &c->epsrel, &c->error, &c->usPerRun ) == 5 ) {
+            found = parseStepper( name, &c->stepper );
+        }
+    }
+    fclose( f );
+    return found;
+}
+
+/* Record c for model/regime/target in the table at path, replacing any earlier entry. */
+inline bool saveTune( const std::string& path, const std::string& model, const std::string& regime,
+                      double target, const tuneConfig& c )
+{
+    std::string key = model + "," + regime + "," + strformat( "%g", target ) + ",";
+    std::vector<std::string> rows;
+    FILE * f = fopen( path.c_str(), "r" );
+    if ( f != NULL ) {
+        char line[1024];
+        while ( fgets( line, sizeof(line), f ) != NULL ) {
+            if ( line[0] == '#' || strncmp( line, "model,", 6 ) == 0 ) continue;
+            if ( strncmp( line, key.c_str(), key.size() ) == 0 ) continue;
+            rows.push_back( line );
+        }
+        fclose( f );
+    }
+    rows.push_back( key + strformat( "%s,%g,%g,%.3e,%.1f\n", stepperName( c.stepper ),
+                                     c.epsabs, c.epsrel, c.error, c.usPerRun ) );
+    size_t slash = path.rfind( '/' );
+    if ( slash != std::string::npos && slash > 0 ) {
+        mkdir( path.substr( 0, slash ).c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH );
+    }
+    std::string tmp = path + ".tmp";
+    f = fopen( tmp.c_str(), "w" );
+    if ( f == NULL ) return false;
+    fprintf( f, "# Autotuned ODE stepper settings: cheapest meeting target, relative error vs vern6 at %g.\n",
+             TUNE_REF_TOL );
+    fprintf( f, "model,regime,target,stepper,epsabs,epsrel,error,us_per_run\n" );
+    for ( const std::string& r : rows ) fputs( r.c_str(), f );
+    bool ok = ( fclose( f ) == 0 );
+    return ok && rename( tmp.c_str(), path.c_str() ) == 0;
+}
+
+/*
+ The configuration for model/regime at target: from the table at path
+ unless retune, else calibrated with run and saved there.
+*/
+template <class Run>
+bool tunedConfig( Run run, const std::string& path, const std::string& model, const std::string& regime,
+                  double target, bool retune, tuneConfig* c, std::string* err, FILE* log = stdout )
+{
+    if ( !retune && loadTune( path, model, regime, target, c ) ) {
+        if ( log != NULL ) {
+            fprintf( log, "Autotune: %s eps %g from %s\n", stepperName( c->stepper ), c->epsabs, path.c_str() );
+        }
+        return true;
+    }
+    if ( log != NULL ) fprintf( log, "Autotune: calibrating %s [%s] for error %g\n",
+                                model.c_str(), regime.c_str(), target );
+    if ( !autotune( run, target, c, err, log ) ) return false;
+    if ( log != NULL ) {
+        fprintf( log, "Autotune: chose %s eps %g (%.1f us/run)\n",
+                 stepperName( c->stepper ), c->epsabs, c->usPerRun );
+    }
+    if ( !saveTune( path, model, regime, target, *c ) && log != NULL ) {
+        fprintf( log, "Autotune: could not write '%s'\n", path.c_str() );
+    }
+    return true;
+}
+
+#endif /* GOODWIN_TUNE_H */
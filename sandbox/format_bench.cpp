@@ -0,0 +1,144 @@
+/*
+ Benchmark of the ways we have written goodwin rows as text.
+
+ g++ -Wall -O2 -I../goodwin -c format_bench.cpp &&
+ g++ format_bench.o -o format_bench
+
+ Usage: ./format_bench [Nrows] [outfile]      (defaults: 10000000 /dev/null)
+
+ Each method writes the same "t,w,Y" rows in the %12f layout of goodwin.cpp:
+   iostream   ofstream << setw(12) << fixed << ... << endl   (the old way)
+   snprintf   snprintf into one big buffer, fwrite when full
+   to_chars   formatRow() from goodwin_output.h into the same buffer
+   shortest   formatRow() with shortest round-trip digits, no padding
+   memcpy     copy of ready-made row text, the ceiling for any formatter
+*/
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "goodwin_output.h"
+
+using namespace std;
+
+static const size_t BUFSIZE = 1 << 20;
+
+/* a smooth closed orbit, tabulated so the timings are of formatting only */
+static const int NTAB = 4096;
+static double wtab[NTAB], Ytab[NTAB];
+
+static void sample( long i, double* t, double y[2] )
+{
+    *t = i * 0.1;
+    y[0] = wtab[i & ( NTAB-1 )];
+    y[1] = Ytab[i & ( NTAB-1 )];
+}
+
+static void report( const char* name, long nrows, long long bytes, double secs )
+{
+    printf("%-10s %8.3f s  %10.3g rows/s  %8.1f MB/s\n", name, secs,
+           nrows / secs, bytes / secs / 1e6 );
+}
+
+int main( int argc, char* argv[] )
+{
+    long nrows = ( argc > 1 ) ? atol( argv[1] ) : 10000000;
+    const char * path = ( argc > 2 ) ? argv[2] : "/dev/null";
+    double t, y[2];
+    long long bytes;
+    vector<char> buf( BUFSIZE );
+    size_t used;
+    for ( int k=0; k < NTAB; k++ ) {
+        wtab[k] = 1.0 + 0.8 * sin( k * 0.1 );
+        Ytab[k] = 1.0 + 0.8 * cos( k * 0.1 );
+    }
+
+    // snprintf into a reusable buffer
+    {
+        auto start = chrono::steady_clock::now();
+        FILE * out = fopen( path, "w" );
+        used = 0;
+        bytes = 0;
+        for ( long i=0; i < nrows; i++ ) {
+            sample( i, &t, y );
+            if ( used + ROW_MAX > BUFSIZE ) {
+                fwrite( buf.data(), 1, used, out );
+                used = 0;
+            }
+            int n = snprintf( &buf[used], ROW_MAX, "%12f,%12f,%12f\n", t, y[0], y[1] );
+            used += n;
+            bytes += n;
+        }
+        fwrite( buf.data(), 1, used, out );
+        fclose( out );
+        double secs = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+        report( "snprintf", nrows, bytes, secs );
+    }
+
+    // iostream, as goodwin.cpp used to
+    {
+        auto start = chrono::steady_clock::now();
+        ofstream out( path );
+        for ( long i=0; i < nrows; i++ ) {
+            sample( i, &t, y );
+            out << setw(12) << fixed << t << "," << setw(12)
+                << y[0] << "," << setw(12) << y[1] << endl;
+        }
+        out.close();
+        double secs = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+        report( "iostream", nrows, bytes, secs );   // same layout as snprintf
+    }
+
+    // std::to_chars, fixed and shortest
+    for ( int shortest=0; shortest < 2; shortest++ ) {
+        textFormat fmt = { shortest ? -1 : 6, 12 };
+        auto start = chrono::steady_clock::now();
+        FILE * out = fopen( path, "w" );
+        used = 0;
+        bytes = 0;
+        for ( long i=0; i < nrows; i++ ) {
+            sample( i, &t, y );
+            if ( used + ROW_MAX > BUFSIZE ) {
+                fwrite( buf.data(), 1, used, out );
+                used = 0;
+            }
+            size_t n = formatRow( &buf[used], fmt, ",", t, y );
+            used += n;
+            bytes += n;
+        }
+        fwrite( buf.data(), 1, used, out );
+        fclose( out );
+        double secs = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+        report( shortest ? "shortest" : "to_chars", nrows, bytes, secs );
+    }
+
+    // memcpy of preformatted rows
+    {
+        const char row[] = "    0.100000,    1.079867,    1.796007\n";
+        size_t n = sizeof(row) - 1;
+        auto start = chrono::steady_clock::now();
+        FILE * out = fopen( path, "w" );
+        used = 0;
+        for ( long i=0; i < nrows; i++ ) {
+            if ( used + n > BUFSIZE ) {
+                fwrite( buf.data(), 1, used, out );
+                used = 0;
+            }
+            memcpy( &buf[used], row, n );
+            used += n;
+        }
+        fwrite( buf.data(), 1, used, out );
+        fclose( out );
+        double secs = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+        report( "memcpy", nrows, (long long)n * nrows, secs );
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ Demonstration and benchmark of the lazy trajectory ranges of
+ goodwin_generator.h against writing the whole run out first.
+
+ g++ -Wall -O2 -std=c++20 -I../goodwin -c generator_bench.cpp &&
+ g++ generator_bench.o -lgsl -lgslcblas -o generator_bench
+
+ Usage: ./generator_bench [Nsteps]      (default 1000000)
+
+ 1. Early stop: a run of Nsteps outputs every 0.1, pulled through a
+    closure monitor, integrates one period and no further.
+ 2. Fused against buffered: the same run decimated to 1e-3 into a sink
+    that keeps a running max of w, once as a coroutine pipeline and once
+    the way the programs work now, every sample into a buffer and the
+    decimator run over the buffer.  Time and the buffer each needs.
+ 3. Interleaved: two rk8pd runs with different parameters pulled one
+    sample at a time, alternately, on one thread, against each run pulled
+    on its own.  The samples must be identical; a solver shared between
+    the suspended runs would mix their step sizes and parameters.
+ 4. Views: a run through std::views::filter, transform and take, the
+    standard adaptors composing with the generator.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <ranges>
+
+#include "goodwin.h"
+#include "goodwin_grid.h"
+#include "goodwin_generator.h"
+
+using namespace std;
+
+static double since( chrono::steady_clock::time_point start )
+{
+    return chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+}
+
+int main( int argc, char* argv[] )
+{
+    long nsteps = ( argc > 1 ) ? atol( argv[1] ) : 1000000;
+    if ( nsteps < 10 ) nsteps = 10;
+    goodwinParams p;
+    defaultParams( &p );
+    timeGrid grid = defaultGrid( nsteps );
+
+    monitorOptions mo;
+    defaultMonitorOptions( &mo );
+    mo.closureTol = 1e-5;
+    stopReason why;
+    long pulled = 0;
+    auto start = chrono::steady_clock::now();
+    for ( const trajSample& s : monitored( goodwinRun( STEPPER_RK8PD, 1e-6, 0.0, p, grid ), mo, p, grid.tStart, &why ) ) {
+        (void)s;
+        pulled++;
+    }
+    printf("Early stop: %ld of %ld outputs pulled, stop=%s, %.3f ms\n",
+           pulled, nsteps, stopReasonName( why ), since( start ) * 1e3);
+
+    const double tol = 1e-3;
+    start = chrono::steady_clock::now();
+    long kept = 0;
+    double wmax = 0.0;
+    for ( const trajSample& s : decimated( goodwinRun( STEPPER_RK8PD, 1e-6, 0.0, p, grid ), tol ) ) {
+        wmax = max( wmax, s.y[0] );
+        kept++;
+    }
+    double fusedSecs = since( start );
+    printf("Fused:    %ld of %ld samples kept, max w %.6f, %.3f s, no buffer\n", kept, nsteps, wmax, fusedSecs);
+
+    start = chrono::steady_clock::now();
+    vector<trajSample> all;
+    all.reserve( nsteps );
+    goodwinIntegrator solver( STEPPER_RK8PD );
+    solver.reset( p );
+    trajSample s = { grid.tStart, { p.w0, p.Y0 } };
+    for ( long i=1; i <= grid.size(); i++ ) {
+        if ( solver.apply( &s.t, grid.time( i ), s.y ) != GSL_SUCCESS ) break;
+        all.push_back( s );
+    }
+    vector<trajSample> out;
+    trajectoryDecimator decimator( tol );
+    auto keep = [&out]( double t, const double y[2] ) { out.push_back( { t, { y[0], y[1] } } ); };
+    for ( const trajSample& a : all ) decimator.push( a.t, a.y, keep );
+    decimator.finish( keep );
+    double wmaxb = 0.0;
+    for ( const trajSample& a : out ) wmaxb = max( wmaxb, a.y[0] );
+    double bufferedSecs = since( start );
+    printf("Buffered: %ld of %ld samples kept, max w %.6f, %.3f s, %.1f MB buffered\n",
+           (long)out.size(), nsteps, wmaxb, bufferedSecs,
+           ( all.capacity() + out.capacity() ) * sizeof( trajSample ) / 1e6);
+    printf("Fused / buffered time: %.3f\n", fusedSecs / bufferedSecs);
+
+    goodwinParams q = p;
+    q.r = 1.3;
+    q.w0 = 2.5;
+    timeGrid shortGrid = defaultGrid( 10000 );
+    auto alone = [&shortGrid]( const goodwinParams& pp ) {
+        vector<trajSample> v;
+        for ( const trajSample& s : goodwinRun( STEPPER_RK8PD, 1e-6, 0.0, pp, shortGrid ) ) v.push_back( s );
+        return v;
+    };
+    vector<trajSample> soloP = alone( p ), soloQ = alone( q );
+    auto runP = goodwinRun( STEPPER_RK8PD, 1e-6, 0.0, p, shortGrid );
+    auto runQ = goodwinRun( STEPPER_RK8PD, 1e-6, 0.0, q, shortGrid );
+    auto itP = runP.begin(), itQ = runQ.begin();
+    long n = 0, differ = 0;
+    for ( ; itP != runP.end() && itQ != runQ.end(); ++itP, ++itQ, n++ ) {
+        const trajSample& a = soloP[n];
+        const trajSample& b = soloQ[n];
+        if ( itP->t != a.t || itP->y[0] != a.y[0] || itP->y[1] != a.y[1] ) differ++;
+        if ( itQ->t != b.t || itQ->y[0] != b.y[0] || itQ->y[1] != b.y[1] ) differ++;
+    }
+    bool same = ( differ == 0 && n == (long)soloP.size() && n == (long)soloQ.size() );
+    printf("Interleaved: %ld samples from each of two runs, %ld differ from the runs alone: %s\n",
+           n, differ, same ? "ok" : "FAILED");
+
+    long high = 0;
+    double first = 0.0;
+    for ( double w : goodwinRun( STEPPER_RK8PD, 1e-6, 0.0, p, shortGrid )
+                     | views::filter( []( const trajSample& s ) { return s.y[0] > 3.0; } )
+                     | views::transform( []( const trajSample& s ) { return s.y[0]; } )
+                     | views::take( 5 ) ) {
+        if ( high++ == 0 ) first = w;
+    }
+    printf("Views: first %ld samples with w > 3 pulled through filter | transform | take, first w %.6f\n",
+           high, first);
+    return same ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""
+Reader for the min/max level-of-detail pyramid written by
+  goodwin --lod run.lod
+(see goodwin/goodwin_lod.h for the layout).
+
+A slider callback that re-slices the raw w/Y arrays, as update() in
+anim_trajectories.py does, costs O(samples) per redraw.  window() instead
+picks the coarsest pyramid level that still has a bin per pixel in
+[t0, t1] and returns just those bins, so a redraw costs O(pixels)
+however long the run was.
+
+  lod = read_lod('sim_data/run.lod')
+  b = window(lod, 0, 1e6, 800)
+  ax.fill_between(b['t0'], b['wmin'], b['wmax'], step='post')
+"""
+import sys
+import numpy as np
+
+MAX_LEVELS = 32
+header_dtype = np.dtype([('magic', 'S8'), ('base', '<u4'), ('fanout', '<u4'),
+                         ('samples', '<u8'), ('levels', '<u4'), ('reserved', '<u4'),
+                         ('offset', '<u8', MAX_LEVELS), ('count', '<u8', MAX_LEVELS)])
+bin_dtype = np.dtype([('t0', '<f8'), ('t1', '<f8'),
+                      ('wmin', '<f4'), ('wmax', '<f4'), ('Ymin', '<f4'), ('Ymax', '<f4')])
+
+def read_lod(path):
+    """ Header dict and the list of levels, each memory-mapped, finest first. """
+    h = np.fromfile(path, dtype=header_dtype, count=1)[0]
+    if h['magic'] != b'GWLOD01\n':
+        raise ValueError("'%s' is not a goodwin LOD pyramid" % path)
+    levels = [np.memmap(path, dtype=bin_dtype, mode='r',
+                        offset=int(h['offset'][k]), shape=(int(h['count'][k]),))
+              if h['count'][k] > 0 else np.zeros(0, dtype=bin_dtype)
+              for k in range(int(h['levels']))]
+    return {'base': int(h['base']), 'fanout': int(h['fanout']),
+            'samples': int(h['samples']), 'levels': levels}
+
+def window(lod, t0, t1, npix):
+    """ Bins overlapping [t0, t1] from the coarsest level with at least npix of them. """
+    levels = lod['levels']
+    for k in range(len(levels) - 1, -1, -1):
+        b = levels[k]
+        i0 = np.searchsorted(b['t1'], t0, side='left')
+        i1 = np.searchsorted(b['t0'], t1, side='right')
+        if i1 - i0 >= npix or k == 0:
+            return np.asarray(b[i0:i1])
+    return np.zeros(0, dtype=bin_dtype)
+
+if __name__ == '__main__':
+    import matplotlib.pyplot as plt
+    lod = read_lod(sys.argv[1] if len(sys.argv) > 1 else 'sim_data/goodwin.lod')
+    top = lod['levels'][-1]
+    t0, t1 = float(top['t0'][0]), float(top['t1'][-1])
+    print("%d samples, t = %g .. %g, %d levels" % (lod['samples'], t0, t1, len(lod['levels'])))
+    b = window(lod, t0, t1, 800)
+    fig, ax = plt.subplots()
+    ax.fill_between(b['t0'], b['wmin'], b['wmax'], step='post', alpha=0.6, label='wages')
+    ax.fill_between(b['t0'], b['Ymin'], b['Ymax'], step='post', alpha=0.6, label='output')
+    ax.set_xlabel('time, $t$')
+    ax.set_title("Goodwin model: min/max envelope, %d bins" % len(b))
+    ax.legend()
+    plt.show()
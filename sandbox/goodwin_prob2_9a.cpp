@@ -1,7 +1,7 @@
 /*
  Example GNU-GSL ODE solver for Goodwin wage--output model
  
- g++ -Wall -I/usr/include/jsoncpp/ -c goodwin_prob2_9a.cpp &&
+ g++ -Wall -I/usr/include/jsoncpp/ -I../goodwin -c goodwin_prob2_9a.cpp &&
  g++ -L/usr/local/lib goodwin_prob2_9a.o -lgsl -lgslcblas -lpopt -ljsoncpp -o goodwin_prob2_9a
 */
 
@@ -21,35 +21,25 @@
 #include <string.h>
 #include "json/json.h"
 
+#include "goodwin.h"
+#include "goodwin_rk.h"
+#include "goodwin_tune.h"
+#include "goodwin_grid.h"
+
 using namespace std;
 
 #define PROGRAM_NAME "goodwin"
 #define VERSION 1
-#define NMAX 1000000000
 
-struct goodwinParams {
-    double r;
-    double c;
-    double a;
-    double b;
-    double w0;
-    double Y0;
-    int Nsteps;
+struct runOptions {
+    double autotune;    // accuracy target, 0 for none
+    int retune;
+    char * tuneFile;
+    gridOptions grid;
 };
 
-std::string strformat( const string fmt_str,...)
-{
-    va_list ap;
-    char *fp = NULL;
-    va_start(ap, fmt_str);
-    vasprintf(&fp, fmt_str.c_str(), ap);
-    va_end(ap);
-    std::unique_ptr<char[]> formatted(fp);
-    return std::string(formatted.get());
-}
-
 static void parseArguments( int argc, const char **argv, 
-                            goodwinParams* gparams , char ** outfile )
+                            goodwinParams* gparams , runOptions* opts, char ** outfile )
 {
     poptContext optCon;
     const struct poptOption optionsTable[] = {
@@ -71,7 +61,21 @@ static void parseArguments( int argc, const char **argv,
         { "Y0 ", 'Y', POPT_ARG_DOUBLE, &gparams->Y0, 0,
             "Set initial output level." },
         { "output", 'o', POPT_ARG_STRING, outfile, 0,
-            "Pandas format CSV file output pathname (max 180 chars)." },
+            "JSON output pathname." },
+        { "t-start", 0, POPT_ARG_DOUBLE, &opts->grid.tStart, 0,
+            "Set start time of the run (default 0)." },
+        { "t-end", 0, POPT_ARG_DOUBLE, &opts->grid.tEnd, 0,
+            "Set end time of the run; with a linear grid this sets the number of outputs." },
+        { "dt", 0, POPT_ARG_DOUBLE, &opts->grid.dt, 0,
+            "Set output spacing (default 0.1); the first output time of a log grid." },
+        { "grid", 0, POPT_ARG_STRING, &opts->grid.spacing, 0,
+            "Set output times: linear (default), log (Nsteps log-spaced to t-end), or final (last state only)." },
+        { "autotune", 0, POPT_ARG_DOUBLE, &opts->autotune, 0,
+            "Use the cheapest stepper and tolerance found to keep the relative error within this target." },
+        { "retune", 0, POPT_ARG_NONE, &opts->retune, 0,
+            "Recalibrate --autotune even if the tuning file has a setting for this regime." },
+        { "tune-file", 0, POPT_ARG_STRING, &opts->tuneFile, 0,
+            "Set autotune settings file (default ./sim_data/autotune.pd)." },
         {NULL, 0, 0, NULL, 0, }
     };
     int i;
@@ -111,42 +115,6 @@ static void parseArguments( int argc, const char **argv,
 }
 
 
-int func (double t, const double y[], double f[],
-      void *params)
-{
-    (void)(t); /* avoid unused parameter warning */ 
-    struct goodwinParams *p = (struct goodwinParams*)(params); 
-    double r = p->r; 
-    double c = p->c; 
-    double a = p->a; 
-    double b = p->b;
-    f[0] = -c*y[0] + r*y[0]*y[1]; // wages y[0], f[0]=dy[0]/dt
-    f[1] = a*y[1] - b*y[0]*y[1]; // output y[1], f[1]=dy[1]/dt
-    return GSL_SUCCESS;
-}
-
-int
-jac (double t, const double y[], double *dfdy,
-     double dfdt[], void *params)
-{
-    (void)(t); /* avoid unused parameter warning */
-    struct goodwinParams *p = (struct goodwinParams*)(params); 
-    double r = p->r; 
-    double c = p->c; 
-    double a = p->a; 
-    double b = p->b;
-    gsl_matrix_view dfdy_mat
-    = gsl_matrix_view_array (dfdy, 2, 2);
-    gsl_matrix * m = &dfdy_mat.matrix;
-    gsl_matrix_set (m, 0, 0, -c+r*y[1] );
-    gsl_matrix_set (m, 0, 1, -b*y[1] );
-    gsl_matrix_set (m, 1, 0, r*y[0] );
-    gsl_matrix_set (m, 1, 1, a-b*y[0] );
-    dfdt[0] = 0.0;  // no explicit time dependencies
-    dfdt[1] = 0.0;
-    return GSL_SUCCESS;
-}
-
 int main ( int argc, const char *argv[] )
 {
     goodwinParams params;
@@ -158,13 +126,14 @@ int main ( int argc, const char *argv[] )
     params.Y0 = 4.0;
     params.Nsteps = 100;
     string outfile = "goodwin_prob2_9a.json";
-    char * pathname;
-    pathname = (char*)malloc(sizeof(char)*180);
-    //printf("Before parseArgs , pathname = '%s'\n",pathname);
-    parseArguments( argc, argv, &params, &pathname );
-    //printf("After parseArgs , pathname = '%s'\n",pathname);
-    //cout << " strcmp(pathname,'') = " << strcmp(pathname,"") <<endl;
-    if ( strcmp(pathname,"")!=0 )  outfile= strformat("%s",pathname);
+    runOptions opts = { 0.0, 0, NULL };
+    defaultGridOptions( &opts.grid );
+    char * pathname = NULL;    // set by popt when -o is given
+    parseArguments( argc, argv, &params, &opts, &pathname );
+    if ( pathname != NULL ) {
+        outfile = pathname;
+        free( pathname );
+    }
     if ( params.Nsteps>NMAX ) {
         cout << "Nsteps exceeded maximum.  Resetting Nsteps to  NMAX ="<<NMAX<<endl;
         params.Nsteps = NMAX;
@@ -174,14 +143,50 @@ int main ( int argc, const char *argv[] )
         params.Nsteps = 100;
     }
     
-    gsl_odeiv2_system sys = {func, jac, 2, &params };
-
-    gsl_odeiv2_driver * d =
-    gsl_odeiv2_driver_alloc_y_new (&sys, gsl_odeiv2_step_rk8pd,
-                                    1e-6, 1e-6, 0.0);
+    timeGrid grid;
+    string gridErr;
+    if ( !makeTimeGrid( opts.grid, params.Nsteps, &grid, &gridErr ) ) {
+        fprintf(stderr,"\tgrid: %s\n",gridErr.c_str());
+        exit(-1);
+    }
+    if ( grid.size() >= NMAX ) {
+        fprintf(stderr,"\tgrid: %ld outputs exceeds maximum %d\n",grid.size(),NMAX);
+        exit(-1);
+    }
+    params.Nsteps = grid.size();
     int i;
-    double t = 0.0, t1 = 100.0;
+    double t = grid.tStart;
     double y[2] = {  params.w0,  params.Y0 }; // initial conditions: { wages, output }
+    stepperKind stepper = STEPPER_RK8PD;
+    double epsabs = 1e-6, epsrel = 0.0;
+    if ( opts.autotune > 0.0 ) {
+        auto calibrate = [&params, &grid]( stepperKind kind, double ea, double er, vector<double>* out ) {
+            goodwinIntegrator cal( kind, ea, er );
+            cal.reset( params );
+            double tc = grid.tStart;
+            double yc[2] = { params.w0, params.Y0 };
+            out->clear();
+            for ( long k=1; k <= min( grid.size(), (long)TUNE_OUTPUTS ); k++ ) {
+                if ( cal.apply( &tc, grid.time( k ), yc ) != GSL_SUCCESS ) return false;
+                out->push_back( yc[0] );
+                out->push_back( yc[1] );
+            }
+            return true;
+        };
+        tuneConfig tuned;
+        string err;
+        string tunefile = ( opts.tuneFile != NULL ) ? opts.tuneFile : TUNE_FILE_DEFAULT;
+        if ( !tunedConfig( calibrate, tunefile, "goodwin", goodwinRegime( params ), opts.autotune,
+                           opts.retune != 0, &tuned, &err ) ) {
+            fprintf(stderr,"\tautotune: %s\n",err.c_str());
+            exit(-1);
+        }
+        stepper = tuned.stepper;
+        epsabs = tuned.epsabs;
+        epsrel = tuned.epsrel;
+    }
+    goodwinIntegrator solver( stepper, epsabs, epsrel );
+    solver.reset( params );
     
     //Json::Value allData(Json::arrayValue);
     Json::Value allData;
@@ -205,6 +210,16 @@ int main ( int argc, const char *argv[] )
     //param_obj["Y0"] = chY0;
     param_obj["Y0"] = params.Y0;
     param_obj["Nsteps"] = params.Nsteps;
+    if ( !isDefaultGrid( opts.grid ) ) {
+        param_obj["grid"] = gridSpacingName( grid.spacing );
+        param_obj["t_start"] = grid.tStart;
+        param_obj["t_end"] = grid.tEnd;
+    }
+    if ( opts.autotune > 0.0 ) {
+        param_obj["stepper"] = stepperName( stepper );
+        param_obj["epsabs"] = epsabs;
+        param_obj["epsrel"] = epsrel;
+    }
     Json::Value t_obj;
     Json::Value w_obj;
     Json::Value Y_obj;
@@ -214,8 +229,8 @@ int main ( int argc, const char *argv[] )
    
     for (i = 1; i <= params.Nsteps; i++)
     {
-        double ti =  i * t1 / 1000.0;
-        int status = gsl_odeiv2_driver_apply (d, &t, ti, y);
+        double ti = grid.time( i );
+        int status = solver.apply (&t, ti, y);
 
         if (status != GSL_SUCCESS)
         {
@@ -245,6 +260,5 @@ int main ( int argc, const char *argv[] )
     std::ofstream outputFileStream( outfile );
     writer -> write( allData, &outputFileStream );
     
-    gsl_odeiv2_driver_free (d);
     return 0;
 }
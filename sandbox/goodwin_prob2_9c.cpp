@@ -121,8 +121,8 @@ jac (double t, const double y[], double *dfdy,
     = gsl_matrix_view_array (dfdy, 2, 2);
     gsl_matrix * m = &dfdy_mat.matrix;
     gsl_matrix_set (m, 0, 0, -c+r*y[1] );
-    gsl_matrix_set (m, 0, 1, -b*y[1] );
-    gsl_matrix_set (m, 1, 0, r*y[0] );
+    gsl_matrix_set (m, 0, 1, r*y[0] );
+    gsl_matrix_set (m, 1, 0, -b*y[1] );
     gsl_matrix_set (m, 1, 1, a-b*y[0] );
     dfdt[0] = 0.0;  // no explicit time dependencies
     dfdt[1] = 0.0;
@@ -0,0 +1,110 @@
+/*
+ Benchmark of many short goodwin runs: a fresh GSL driver per run against
+ a reused solverContext from goodwin_solver.h.
+
+ g++ -Wall -O2 -pthread -I../goodwin -c solver_bench.cpp &&
+ g++ -pthread solver_bench.o -lgsl -lgslcblas -o solver_bench
+
+ Usage: ./solver_bench [Nruns] [Nsteps] [threads]    (defaults: 100000 10 1)
+
+ Each run integrates from t = 0 over Nsteps output intervals of 0.1, with
+ a different r per run, as goodwin does:
+   fresh    gsl_odeiv2_driver_alloc_y_new / _free around every run, plus
+            the per-run pathname and date buffers goodwin used to malloc
+   reused   threadSolver().reset() per run, nothing allocated
+ Both must give the same final state in every run, to the last bit: the
+ last line counts the runs that differ, and the exit status is 1 if any
+ do.  The runs/s of the two and their ratio are the before and after of
+ reusing the solver; they and the check only mean something against the
+ real libgsl, whose driver allocation is what reuse saves.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+#include "goodwin.h"
+#include "goodwin_solver.h"
+
+using namespace std;
+
+static void runFresh( goodwinParams p, int nsteps, double* yend )
+{
+    char * pathname = (char*)malloc( 180 );
+    char * chTime = (char*)malloc( 80 );
+    snprintf( pathname, 180, "./sim_data/goodwin_v1_N%d.pd", nsteps );
+    snprintf( chTime, 80, "2026-01-01" );
+    gsl_odeiv2_system sys = { func, jac, 2, &p };
+    gsl_odeiv2_driver * d =
+        gsl_odeiv2_driver_alloc_y_new( &sys, gsl_odeiv2_step_rk8pd, 1e-6, 1e-6, 0.0 );
+    double t = 0.0;
+    double y[2] = { p.w0, p.Y0 };
+    for ( int i=1; i <= nsteps; i++ ) gsl_odeiv2_driver_apply( d, &t, i * 0.1, y );
+    gsl_odeiv2_driver_free( d );
+    free( pathname );
+    free( chTime );
+    yend[0] = y[0];
+    yend[1] = y[1];
+}
+
+static void runReused( const goodwinParams& p, int nsteps, double* yend )
+{
+    solverContext& solver = threadSolver();
+    solver.reset( p );
+    double t = 0.0;
+    double y[2] = { p.w0, p.Y0 };
+    for ( int i=1; i <= nsteps; i++ ) solver.apply( &t, i * 0.1, y );
+    yend[0] = y[0];
+    yend[1] = y[1];
+}
+
+/* runs [first, last) with either method, final state of run k into yend[2k, 2k+1] */
+static void runRange( bool reused, long first, long last, int nsteps, double* yend )
+{
+    goodwinParams p;
+    defaultParams( &p );
+    for ( long k=first; k < last; k++ ) {
+        p.r = 0.5 + ( k % 1000 ) * 1e-3;
+        if ( reused ) runReused( p, nsteps, &yend[2*k] );
+        else runFresh( p, nsteps, &yend[2*k] );
+    }
+}
+
+int main( int argc, char* argv[] )
+{
+    long nruns = ( argc > 1 ) ? atol( argv[1] ) : 100000;
+    int nsteps = ( argc > 2 ) ? atoi( argv[2] ) : 10;
+    int nthreads = ( argc > 3 ) ? atoi( argv[3] ) : 1;
+    if ( nruns < 1 || nsteps < 1 || nthreads < 1 ) {
+        fprintf(stderr, "\tusage: %s [Nruns] [Nsteps] [threads]\n", argv[0]);
+        exit(-1);
+    }
+    vector<double> yend[2];
+    double rate[2];
+    for ( int reused=0; reused < 2; reused++ ) {
+        yend[reused].resize( 2 * nruns );
+        double* out = yend[reused].data();
+        auto start = chrono::steady_clock::now();
+        vector<thread> workers;
+        for ( int id=0; id < nthreads; id++ ) {
+            workers.push_back( thread( [out, id, reused, nruns, nsteps, nthreads]() {
+                runRange( reused, nruns * id / nthreads, nruns * ( id+1 ) / nthreads, nsteps, out );
+            } ) );
+        }
+        for ( auto& w : workers ) w.join();
+        double secs = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+        rate[reused] = nruns / secs;
+        printf("%-8s %8.3f s  %10.4g runs/s\n", reused ? "reused" : "fresh", secs, rate[reused] );
+    }
+    long differ = 0;
+    for ( long k=0; k < nruns; k++ ) {
+        if ( yend[0][2*k] != yend[1][2*k] || yend[0][2*k+1] != yend[1][2*k+1] ) differ++;
+    }
+    printf("reused / fresh runs/s: %.3f\n", rate[1] / rate[0]);
+    printf("final states: %ld of %ld runs differ %s\n", differ, nruns, differ == 0 ? "(identical)" : "(DIFFER)");
+    return differ == 0 ? 0 : 1;
+}
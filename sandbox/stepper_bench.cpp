@@ -0,0 +1,182 @@
+/*
+ Benchmark of the native embedded RK steppers of goodwin_rk.h against
+ GSL's rk8pd on the goodwin model.
+
+ g++ -Wall -O2 -I../goodwin -c stepper_bench.cpp &&
+ g++ stepper_bench.o -lgsl -lgslcblas -o stepper_bench
+
+ Usage: ./stepper_bench [Nruns]      (default 20)
+
+ 1. Convergence order: fixed steps h = 0.2/2^k to t = 20, with the error
+    the largest deviation from a fine vern6 solution at t = 1, 2, ..., 20.
+    The observed order log2(e(h)/e(h/2)) should approach the order of each
+    method before rounding error takes over at ~1e-13.  tsit5 is tuned so
+    its leading error term is small, and looks better than 5 over this range.
+    vern9 reaches 1e-13 by h = 0.05, so its row starts from h = 1: it shows
+    about 8.3 at h = 0.25 .. 0.0625 before the floor.
+ 2. Work--precision: goodwin's run (1000 outputs every 0.1 from w0=3, Y0=4)
+    for epsabs = 1e-3 ... 1e-11.  The error is the largest deviation from
+    a vern6 run at epsabs 1e-14 over all outputs, so methods are compared
+    at equal accuracy, along with right hand side evaluations and time.
+    vern9 against rk8pd is the comparison to read for tight tolerances:
+    both are high order, and rk8pd is what goodwin runs by default.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <chrono>
+
+#include "goodwin.h"
+#include "goodwin_solver.h"
+#include "goodwin_rk.h"
+
+using namespace std;
+
+static const int NOUT = 1000;
+static const double DT_OUT = 0.1;
+
+/* GSL's func with a call counter, for rk8pd evaluation counts */
+static long gslEvals = 0;
+static int countedFunc( double t, const double y[], double f[], void* params )
+{
+    gslEvals++;
+    return func( t, y, f, params );
+}
+
+struct runResult {
+    vector<double> y;    // 2 x NOUT
+    long evals;
+    double secs;         // per run
+};
+
+template <class Tab>
+static runResult runNative( const goodwinParams& p, double eps, int nruns )
+{
+    runResult res;
+    res.y.resize( 2 * NOUT );
+    goodwinRhs rhs = { &p };
+    rkSolver<Tab, 2> solver( 1e-6, eps, 0.0 );
+    auto start = chrono::steady_clock::now();
+    for ( int n=0; n < nruns; n++ ) {
+        solver.reset();
+        double t = 0.0;
+        double y[2] = { p.w0, p.Y0 };
+        for ( int i=1; i <= NOUT; i++ ) {
+            solver.apply( rhs, &t, i * DT_OUT, y );
+            res.y[2*(i-1)] = y[0];
+            res.y[2*(i-1)+1] = y[1];
+        }
+    }
+    res.secs = chrono::duration<double>( chrono::steady_clock::now() - start ).count() / nruns;
+    res.evals = solver.evals() / nruns;
+    return res;
+}
+
+static runResult runRk8pd( goodwinParams p, double eps, int nruns )
+{
+    runResult res;
+    res.y.resize( 2 * NOUT );
+    gsl_odeiv2_system sys = { countedFunc, jac, 2, &p };
+    gsl_odeiv2_driver * d =
+        gsl_odeiv2_driver_alloc_y_new( &sys, gsl_odeiv2_step_rk8pd, 1e-6, eps, 0.0 );
+    gslEvals = 0;
+    auto start = chrono::steady_clock::now();
+    for ( int n=0; n < nruns; n++ ) {
+        gsl_odeiv2_driver_reset_hstart( d, 1e-6 );
+        double t = 0.0;
+        double y[2] = { p.w0, p.Y0 };
+        for ( int i=1; i <= NOUT; i++ ) {
+            gsl_odeiv2_driver_apply( d, &t, i * DT_OUT, y );
+            res.y[2*(i-1)] = y[0];
+            res.y[2*(i-1)+1] = y[1];
+        }
+    }
+    res.secs = chrono::duration<double>( chrono::steady_clock::now() - start ).count() / nruns;
+    res.evals = gslEvals / nruns;
+    gsl_odeiv2_driver_free( d );
+    return res;
+}
+
+static double maxError( const runResult& r, const runResult& ref )
+{
+    double e = 0.0;
+    for ( size_t k=0; k < ref.y.size(); k++ ) e = max( e, fabs( r.y[k] - ref.y[k] ) );
+    return e;
+}
+
+static const int T_ORDER = 20;
+
+/* fixed steps of size h (dividing 1) from t = 0, keeping y at t = 1, 2, ..., T_ORDER */
+template <class Tab>
+static vector<double> fixedRun( const goodwinParams& p, double h )
+{
+    goodwinRhs rhs = { &p };
+    rkSolver<Tab, 2> solver;
+    vector<double> out;
+    double y[2] = { p.w0, p.Y0 }, ynew[2];
+    long perUnit = lround( 1.0 / h );
+    for ( long k=0; k < perUnit * T_ORDER; k++ ) {
+        solver.step( rhs, k * h, h, y, ynew );
+        y[0] = ynew[0];
+        y[1] = ynew[1];
+        if ( ( k+1 ) % perUnit == 0 ) {
+            out.push_back( y[0] );
+            out.push_back( y[1] );
+        }
+    }
+    return out;
+}
+
+template <class Tab>
+static void convergence( const goodwinParams& p, const vector<double>& yref, double h0 = 0.2 )
+{
+    printf("%-6s", Tab::name);
+    double eprev = 0.0;
+    for ( int k=0; k < 7; k++ ) {
+        vector<double> y = fixedRun<Tab>( p, h0 / ( 1 << k ) );
+        double e = 0.0;
+        for ( size_t i=0; i < y.size(); i++ ) e = max( e, fabs( y[i] - yref[i] ) );
+        if ( k > 0 ) printf("  %5.2f", log2( eprev / e ) );
+        eprev = e;
+    }
+    printf("\n");
+}
+
+template <class Tab>
+static void workPrecisionRow( const goodwinParams& p, double eps, int nruns, const runResult& ref )
+{
+    runResult r = runNative<Tab>( p, eps, nruns );
+    printf("%-6s %8.0e %10.3e %9ld %10.1f\n", Tab::name, eps, maxError( r, ref ), r.evals, r.secs * 1e6 );
+}
+
+int main( int argc, char* argv[] )
+{
+    int nruns = ( argc > 1 ) ? atoi( argv[1] ) : 20;
+    if ( nruns < 1 ) nruns = 1;
+    goodwinParams p;
+    defaultParams( &p );
+
+    printf("Observed order, fixed h = 0.2/2^k to t = %d (k = 0..6)\n", T_ORDER);
+    vector<double> yref = fixedRun<vern6Tableau>( p, 0.2 / 4096 );
+    convergence<bs3Tableau>( p, yref );
+    convergence<dp5Tableau>( p, yref );
+    convergence<tsit5Tableau>( p, yref );
+    convergence<vern6Tableau>( p, yref );
+    convergence<vern9Tableau>( p, yref, 1.0 );
+
+    printf("\nWork--precision, %d outputs to t = %g, %d runs each\n", NOUT, NOUT * DT_OUT, nruns);
+    printf("%-6s %8s %10s %9s %10s\n", "method", "epsabs", "max error", "f evals", "us/run");
+    runResult ref = runNative<vern6Tableau>( p, 1e-14, 1 );
+    for ( double eps=1e-3; eps > 1e-12; eps *= 0.01 ) {
+        runResult r = runRk8pd( p, eps, nruns );
+        printf("%-6s %8.0e %10.3e %9ld %10.1f\n", "rk8pd", eps, maxError( r, ref ), r.evals, r.secs * 1e6 );
+        workPrecisionRow<bs3Tableau>( p, eps, nruns, ref );
+        workPrecisionRow<dp5Tableau>( p, eps, nruns, ref );
+        workPrecisionRow<tsit5Tableau>( p, eps, nruns, ref );
+        workPrecisionRow<vern6Tableau>( p, eps, nruns, ref );
+        workPrecisionRow<vern9Tableau>( p, eps, nruns, ref );
+    }
+    return 0;
+}
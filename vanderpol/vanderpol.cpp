@@ -3,8 +3,20 @@
  But designed to use C++ routines, to check a basic compatibility with g++
  compiling,
  
- g++ -Wall -I/usr/include/ -c vanderpol.cpp &&
- g++ -L/usr/local/lib vanderpol.o -lgsl -lgslcblas -o vanderpol
+ g++ -Wall -I/usr/include/ -I../goodwin -c vanderpol.cpp &&
+ g++ -L/usr/local/lib vanderpol.o -lgsl -lgslcblas -lpopt -o vanderpol
+
+ --autotune picks the stepper and tolerance with goodwin_tune.h, keyed
+ on mu, and keeps the choice in ./sim_data/autotune.pd.
+
+ --orbit solves for the limit cycle by Newton shooting (goodwin_orbit.h)
+ after a short transient, and prints its period, Floquet multipliers and
+ --points samples of one period instead of the t = 0..100 trajectory.
+
+ --continue TO follows the limit cycle (or with --branch equilibrium the
+ fixed point at the origin) in mu up to TO with goodwin_cont.h, printing
+ mu, period, state and stability along the branch and the events found.
+ The origin loses stability in a Hopf bifurcation at mu = 0.
 
 */
 
@@ -13,11 +25,19 @@
 #include <gsl/gsl_errno.h>
 #include <gsl/gsl_matrix.h>
 #include <gsl/gsl_odeiv2.h>
+#include <popt.h>
+
+#include "goodwin_rk.h"
+#include "goodwin_tune.h"
+#include "goodwin_orbit.h"
+#include "goodwin_cont.h"
 
 using namespace std;
 
+#define PROGRAM_NAME "vanderpol"
+
 
-int func (double t, const double y[], double f[],
+int vanderpol_func (double t, const double y[], double f[],
       void *params)
 {
     
@@ -30,7 +50,7 @@ int func (double t, const double y[], double f[],
 }
 
 int
-jac (double t, const double y[], double *dfdy,
+vanderpol_jac (double t, const double y[], double *dfdy,
      double dfdt[], void *params)
 {
   (void)(t); /* avoid unused parameter warning */
@@ -47,22 +67,187 @@ jac (double t, const double y[], double *dfdy,
   return GSL_SUCCESS;
 }
 
-int main (void)
+struct runOptions {
+    double autotune;    // accuracy target, 0 for none
+    int retune;
+    char * tuneFile;
+    int orbit;
+    int points;
+    double continueTo;  // NAN for no continuation
+    char * branch;
+};
+
+static void parseArguments( int argc, const char **argv, double* mu, runOptions* opts )
+{
+    poptContext optCon;
+    const struct poptOption optionsTable[] = {
+        POPT_AUTOHELP
+        { "mu", 'm', POPT_ARG_DOUBLE, mu, 0,
+            "Set damping parameter mu (default 10)." },
+        { "autotune", 0, POPT_ARG_DOUBLE, &opts->autotune, 0,
+            "Use the cheapest stepper and tolerance found to keep the relative error within this target." },
+        { "retune", 0, POPT_ARG_NONE, &opts->retune, 0,
+            "Recalibrate --autotune even if the tuning file has a setting for this mu." },
+        { "tune-file", 0, POPT_ARG_STRING, &opts->tuneFile, 0,
+            "Set autotune settings file (default ./sim_data/autotune.pd)." },
+        { "orbit", 0, POPT_ARG_NONE, &opts->orbit, 0,
+            "Solve for the limit cycle and print one period of it." },
+        { "points", 0, POPT_ARG_INT, &opts->points, 0,
+            "Set samples printed over one period with --orbit (default 100)." },
+        { "continue", 0, POPT_ARG_DOUBLE, &opts->continueTo, 0,
+            "Continue the limit cycle in mu up to this value and print the branch." },
+        { "branch", 0, POPT_ARG_STRING, &opts->branch, 0,
+            "Set branch followed by --continue: orbit (default) or equilibrium." },
+        {NULL, 0, 0, NULL, 0, }
+    };
+    optCon = poptGetContext(PROGRAM_NAME, argc, argv, optionsTable, 0);
+    int err = poptGetNextOpt(optCon);
+    if (err != -1) {
+        fprintf(stderr, "\t%s: %s\n",
+            poptBadOption(optCon, POPT_BADOPTION_NOALIAS),
+            poptStrerror(err));
+        exit(-1);
+    }
+    poptFreeContext(optCon);
+}
+
+/* The limit cycle by shooting, from a point reached after a transient of a few periods. */
+static int printOrbit (const gsl_odeiv2_system* sys, double mu, int npts)
+{
+  gsl_set_error_handler_off ();
+  double x[2] = { 1.0, 0.0 };
+  double T;
+  string err;
+  // the relaxation period is about (3 - 2 ln 2) mu for large mu, 2 pi for small
+  if (!estimatePeriod (sys, x, 20.0 + 5.0*mu, 100.0 + 20.0*mu, 0.01, &T, &err))
+    {
+      fprintf (stderr, "\tperiod estimate: %s\n", err.c_str ());
+      return -1;
+    }
+  shootingOptions so;
+  defaultShootingOptions (&so);
+  periodicOrbit orbit;
+  vector<double> pts;
+  if (!findPeriodicOrbit (sys, x, T, so, &orbit, &err))
+    {
+      fprintf (stderr, "\tshooting: %s\n", err.c_str ());
+      return -1;
+    }
+  if (!orbitPoints (sys, orbit, max (npts, 1), &pts))
+    {
+      fprintf (stderr, "\tintegration along the orbit failed\n");
+      return -1;
+    }
+  printf ("# mu=%g , period=%.12g , Newton steps=%d , residual=%.3g\n",
+          mu, orbit.period, orbit.iterations, orbit.residual);
+  printf ("# Floquet multipliers");
+  for (const complex<double>& z : orbit.multipliers)
+    printf (" %.10g%+.3gi", z.real (), z.imag ());
+  printf ("\n");
+  for (int k = 0; k <= max (npts, 1); k++)
+    cout << fixed << setw(12) << k * orbit.period / max (npts, 1)
+         << setw(12) << pts[2*k] << setw(12) << pts[2*k+1] << endl;
+  return 0;
+}
+
+/* The limit cycle, or the origin, continued in mu up to muEnd. */
+static int printContinuation (const gsl_odeiv2_system* sys, double* mu, double muEnd, const char* branchName)
+{
+  gsl_set_error_handler_off ();
+  bool orbits = (branchName == NULL || strcmp (branchName, "orbit") == 0);
+  if (!orbits && strcmp (branchName, "equilibrium") != 0)
+    {
+      fprintf (stderr, "\tbranch: unknown branch '%s' (use orbit or equilibrium)\n", branchName);
+      return -1;
+    }
+  contOptions co;
+  defaultContOptions (&co, muEnd);
+  vector<contPoint> branch;
+  string err;
+  bool ok;
+  if (orbits)
+    {
+      double x[2] = { 1.0, 0.0 };
+      double T;
+      periodicOrbit orbit;
+      if (!estimatePeriod (sys, x, 20.0 + 5.0*fabs (*mu), 100.0 + 20.0*fabs (*mu), 0.01, &T, &err)
+          || !findPeriodicOrbit (sys, x, T, co.shoot, &orbit, &err))
+        {
+          fprintf (stderr, "\tstarting orbit: %s\n", err.c_str ());
+          return -1;
+        }
+      ok = continueOrbits (sys, mu, orbit, co, &branch, &err);
+    }
+  else
+    {
+      double x[2] = { 0.0, 0.0 };
+      ok = continueEquilibria (sys, mu, x, co, &branch, &err);
+    }
+  printf ("# %s continuation in mu from %g , %zu points\n", orbits ? "limit cycle" : "equilibrium",
+          *mu, branch.size ());
+  if (!ok)
+    printf ("# stopped: %s\n", err.c_str ());
+  for (const contPoint& pt : branch)
+    if (!pt.event.empty ())
+      printf ("# %s near mu=%.6g\n", pt.event.c_str (), pt.eventLambda);
+  printf ("#          mu      period          y0          y1  unstable\n");
+  for (const contPoint& pt : branch)
+    printf ("%12.6f%12.6f%12.6f%12.6f%10d\n", pt.lambda, pt.period, pt.x[0], pt.x[1], pt.unstable);
+  return ok ? 0 : -1;
+}
+
+int main (int argc, const char *argv[])
 {
   double mu = 10;
-  gsl_odeiv2_system sys = {func, jac, 2, &mu};
+  runOptions opts = { 0.0, 0, NULL, 0, 100, NAN, NULL };
+  parseArguments (argc, argv, &mu, &opts);
+  gsl_odeiv2_system sys = {vanderpol_func, vanderpol_jac, 2, &mu};
+  if (opts.orbit)
+    return printOrbit (&sys, mu, opts.points);
+  if (!std::isnan (opts.continueTo))
+    return printContinuation (&sys, &mu, opts.continueTo, opts.branch);
 
-  gsl_odeiv2_driver * d =
-    gsl_odeiv2_driver_alloc_y_new (&sys, gsl_odeiv2_step_rk8pd,
-                                  1e-6, 1e-6, 0.0);
   int i;
   double t = 0.0, t1 = 100.0;
   double y[2] = { 1.0, 0.0 };
 
+  stepperKind stepper = STEPPER_RK8PD;
+  double epsabs = 1e-6, epsrel = 0.0;
+  if (opts.autotune > 0.0)
+    {
+      auto calibrate = [&sys, t1] (stepperKind kind, double ea, double er, vector<double>* out) {
+        systemIntegrator<2> cal (&sys, kind, ea, er);
+        double tc = 0.0;
+        double yc[2] = { 1.0, 0.0 };
+        out->clear ();
+        for (int k = 1; k <= min (100, TUNE_OUTPUTS); k++)
+          {
+            if (cal.apply (&tc, k * t1 / 100.0, yc) != GSL_SUCCESS) return false;
+            out->push_back (yc[0]);
+            out->push_back (yc[1]);
+          }
+        return true;
+      };
+      tuneConfig tuned;
+      string err;
+      string tunefile = (opts.tuneFile != NULL) ? opts.tuneFile : TUNE_FILE_DEFAULT;
+      // progress to stderr: stdout is the trajectory
+      if (!tunedConfig (calibrate, tunefile, PROGRAM_NAME, strformat ("mu=%.2g", mu), opts.autotune,
+                        opts.retune != 0, &tuned, &err, stderr))
+        {
+          fprintf (stderr, "\tautotune: %s\n", err.c_str ());
+          exit (-1);
+        }
+      stepper = tuned.stepper;
+      epsabs = tuned.epsabs;
+      epsrel = tuned.epsrel;
+    }
+  systemIntegrator<2> d (&sys, stepper, epsabs, epsrel);
+
   for (i = 1; i <= 100; i++)
     {
       double ti = i * t1 / 100.0;
-      int status = gsl_odeiv2_driver_apply (d, &t, ti, y);
+      int status = d.apply (&t, ti, y);
 
       if (status != GSL_SUCCESS)
         {
@@ -77,7 +262,5 @@ int main (void)
       
     }
 
-  gsl_odeiv2_driver_free (d);
   return 0;
 }
-